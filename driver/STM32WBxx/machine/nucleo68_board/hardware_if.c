@@ -55,6 +55,71 @@ void hardware_later_startup(void)
     hardware_print_info();
 }
 
+#ifdef CONFIG_MSG_SUPERVISOR_WATCHDOG_ENABLE
+static IWDG_HandleTypeDef hardware_iwdg;
+
+/**
+ * @brief   Start the independent watchdog for the service supervisor.
+ *
+ * @retval  None.
+ *
+ * @note    The watchdog is frozen while the core is halted by the debugger.
+ */
+void service_supervisor_watchdog_start(void)
+{
+    __HAL_DBGMCU_FREEZE_IWDG();
+
+    hardware_iwdg.Instance = IWDG;
+    hardware_iwdg.Init.Prescaler = IWDG_PRESCALER_256;
+    hardware_iwdg.Init.Window = IWDG_WINDOW_DISABLE;
+    hardware_iwdg.Init.Reload =
+        CONFIG_MSG_SUPERVISOR_WATCHDOG_TIMEOUT_MS * (LSI_VALUE / 256) / 1000;
+
+    if (HAL_IWDG_Init(&hardware_iwdg) != HAL_OK)
+    {
+        pr_error("Start independent watchdog failed.");
+    }
+}
+
+/**
+ * @brief   Refresh the independent watchdog for the service supervisor.
+ *
+ * @retval  None.
+ */
+void service_supervisor_watchdog_refresh(void)
+{
+    (void)HAL_IWDG_Refresh(&hardware_iwdg);
+}
+#endif
+
+/**
+ * @brief   Get the cycle counter used by the boot profiler.
+ *
+ * @retval  Returns the DWT cycle counter, it runs before the kernel starts
+ *          and while the kernel is locked.
+ */
+uint32_t boot_profile_get_cycles(void)
+{
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief   Get the frequency of the cycle counter used by the boot profiler.
+ *
+ * @retval  Returns the core clock in Hz.
+ */
+uint32_t boot_profile_get_freq(void)
+{
+    return SystemCoreClock;
+}
+
 /**
  * @brief   Display some board info.
  *
@@ -0,0 +1,86 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BOOT_PROFILE_H__
+#define __BOOT_PROFILE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The cycle counter is also used by the benchmarks without the profiler */
+extern uint32_t boot_profile_get_cycles(void);
+extern uint32_t boot_profile_get_freq(void);
+
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+
+/**
+ * @brief   Kind of the boot record entry.
+ */
+typedef enum
+{
+    BOOT_PROFILE_KIND_HOOK = 0,     /* hardware_early/later_startup */
+    BOOT_PROFILE_KIND_OBJECT,       /* Object probe */
+    BOOT_PROFILE_KIND_SERVICE,      /* Service init inside its probe */
+    BOOT_PROFILE_KIND_PHASE,        /* Boot phase or milestone */
+
+    BOOT_PROFILE_KIND_NUM,
+} boot_profile_kind_e;
+
+/**
+ * @brief   Boot record entry.
+ *
+ * @note    The times are in us since boot_profile_begin(), they follow the
+ *          core clock changes, the cycles are the raw cycle counter delta.
+ *          The stack_free is the minimum free stack of the thread which ran
+ *          the span, 0 before the kernel starts.
+ */
+typedef struct
+{
+    const char* name;
+    uint8_t     kind;
+    uint8_t     level;
+    int16_t     ret;
+    uint32_t    start_us;
+    uint32_t    us;
+    uint32_t    cycles;
+    uint32_t    heap_before;
+    uint32_t    heap_after;
+    uint32_t    stack_free;
+} boot_profile_entry_t;
+
+/**
+ * @brief   Boot record, kept until the next reset.
+ */
+typedef struct
+{
+    uint32_t                count;
+    uint32_t                lost;       /* Entries dropped on a full record */
+    boot_profile_entry_t    entry[CONFIG_BOOT_PROFILE_ENTRY_NUM];
+} boot_profile_t;
+
+extern void boot_profile_begin(void);
+extern int32_t boot_profile_enter(const char*           name,
+                                  boot_profile_kind_e   kind,
+                                  uint32_t              level);
+extern void boot_profile_leave(int32_t index, int32_t ret);
+extern const boot_profile_t* boot_profile_get(void);
+extern const char* boot_profile_kind_to_str(uint32_t kind);
+
+#endif
+
+#endif /* __BOOT_PROFILE_H__ */
@@ -53,6 +53,8 @@
 #define EPIPE       32  /* Broken pipe */
 #define EDOM        33  /* Math argument out of domain of func */
 #define ERANGE      34  /* Math result not representable */
+#define EDEADLK     35  /* Resource deadlock would occur */
+#define ETIMEDOUT  110  /* Connection timed out */
 
 #define ENOSUPPORT  101 /* Not support this operation */
 #define EEMPTY      102 /* Device buffer is empty */
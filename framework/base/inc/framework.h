@@ -25,9 +25,16 @@
 #include "framework_conf.h"
 #include "err.h"
 #include "object.h"
+#include "object_pm.h"
 #include "version.h"
 #include "log.h"
+#include "payload.h"
 #include "message.h"
 #include "service.h"
+#include "service_rpc.h"
+#include "service_event.h"
+#include "service_timer.h"
+#include "service_capture.h"
+#include "boot_profile.h"
 
 #endif /* __FRAMEWORK_H__ */
@@ -21,7 +21,19 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "payload.h"
 
+/**
+ * @brief   Message structure.
+ *
+ * @note    The optional payload carries bulk data without copy. The sender
+ *          owns one reference, every queued copy of the message holds its
+ *          own reference which is released after the handler returns.
+ *          The correlation is zero for events, a request carries the ID
+ *          which the reply must echo, see service_rpc.h.
+ *          The timestamp is stamped by the service framework when the
+ *          message is queued, in system timer cycles.
+ */
 typedef struct
 {
     uint32_t    id;
@@ -30,6 +42,10 @@ typedef struct
     uint32_t    param1;
     uint32_t    param2;
     uint32_t    param3;
+
+    payload_t*  payload;
+    uint32_t    correlation;
+    uint32_t    timestamp;
 } __attribute__((packed)) message_t;
 
 #define MSG_ID_SYS_BASE     0x00000100
@@ -38,6 +54,24 @@ typedef struct
 #define MSG_ID_BLE_BASE     0x00000400
 #define MSG_ID_MMI_BASE     0x00000500
 
+/**
+ * Message ID layout, the bits [15:8] select the module base and the
+ * bits [7:0] are the offset inside the module. Only the bases below
+ * MSG_ID_BASE_NUM and the offsets below MSG_ID_OFFSET_NUM are tracked,
+ * the broadcast and unicast of any other ID fail with -EINVAL.
+ */
+#define MSG_ID_BASE_MASK    0x0000ff00
+#define MSG_ID_OFFSET_MASK  0x000000ff
+#define MSG_ID_BASE_NUM     8
+#define MSG_ID_OFFSET_NUM   32
+
+#define msg_id_base_index(id) (((id) & MSG_ID_BASE_MASK) >> 8)
+#define msg_id_offset(id)     ((id) & MSG_ID_OFFSET_MASK)
+#define msg_id_is_valid(id) \
+    (((id) & ~(MSG_ID_BASE_MASK | MSG_ID_OFFSET_MASK)) == 0 && \
+     msg_id_base_index(id) < MSG_ID_BASE_NUM && \
+     msg_id_offset(id) < MSG_ID_OFFSET_NUM)
+
 /**
  * @brief           Notify system startup is completed.
  *
@@ -60,6 +94,28 @@ typedef struct
  */
 #define MSG_ID_SYS_RUN_AUTOMATIC_TEST (MSG_ID_SYS_BASE | 0x02)
 
+/**
+ * @brief           Benchmark the service bus, handlers ignore it.
+ *
+ * @message.id      MSG_ID_SYS_BENCHMARK
+ * @message.param0  Sequence number.
+ * @message.param1  None.
+ * @message.param2  None.
+ * @message.param3  None.
+ */
+#define MSG_ID_SYS_BENCHMARK (MSG_ID_SYS_BASE | 0x03)
+
+/**
+ * @brief           Mailbox token, used by the service framework internally.
+ *
+ * @message.id      MSG_ID_SYS_MAILBOX
+ * @message.param0  Mailbox slot index.
+ * @message.param1  None.
+ * @message.param2  None.
+ * @message.param3  None.
+ */
+#define MSG_ID_SYS_MAILBOX (MSG_ID_SYS_BASE | 0x04)
+
 /**
  * @brief           Set LED type.
  *
@@ -71,6 +127,17 @@ typedef struct
  */
 #define MSG_ID_LED_SETUP (MSG_ID_LED_BASE | 0x01)
 
+/**
+ * @brief           Request LED state, replied with the same ID.
+ *
+ * @message.id      MSG_ID_LED_GET_STATE
+ * @message.param0  led_id_e.
+ * @message.param1  Reply: led_type_e.
+ * @message.param2  Reply: 0 on success, negative error code otherwise.
+ * @message.param3  None.
+ */
+#define MSG_ID_LED_GET_STATE (MSG_ID_LED_BASE | 0x02)
+
 /**
  * @brief           Notify button state.
  *
@@ -82,6 +149,18 @@ typedef struct
  */
 #define MSG_ID_BTN_STATE_NOTIFY (MSG_ID_BTN_BASE | 0x01)
 
+/**
+ * @brief           Button state changed, posted by the button manager
+ *                  callback to the button service.
+ *
+ * @message.id      MSG_ID_BTN_STATE_CHANGE
+ * @message.param0  button_id_e.
+ * @message.param1  button_state_e.
+ * @message.param2  None.
+ * @message.param3  None.
+ */
+#define MSG_ID_BTN_STATE_CHANGE (MSG_ID_BTN_BASE | 0x02)
+
 /**
  * @brief           Notify BLE SHCI ready.
  *
@@ -137,7 +216,30 @@ typedef struct
  */
 #define MSG_ID_MMI_CLIENT_INPUT_NOTIFY (MSG_ID_MMI_BASE | 0x01)
 
+/**
+ * @brief   Message description, the names of unused parameters are NULL.
+ */
+typedef struct
+{
+    uint32_t    id;
+    const char* name;
+    const char* param_name[4];
+} msg_desc_t;
+
+/**
+ * Each module describes its own messages, the descriptions are collected in
+ * the "msg_desc" section and indexed by base and offset at startup.
+ */
+#define DECLARE_MESSAGE_DESC(msg_id, msg_name, param0, param1, param2, param3) \
+    static const msg_desc_t __msg_desc_def_ ## msg_name \
+    __attribute__((used, section("msg_desc"))) = { \
+        .id         = (msg_id), \
+        .name       = #msg_name, \
+        .param_name = { (param0), (param1), (param2), (param3) } }
+
+extern const msg_desc_t* msg_get_desc(uint32_t id);
 extern const char* msg_id_to_str(uint32_t id);
+extern int32_t msg_format(char* buf, size_t size, const message_t* message);
 extern int32_t msg_sys_startup_completed(void);
 
 #endif /* __MESSAGE_H__ */
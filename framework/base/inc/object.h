@@ -84,10 +84,149 @@ typedef struct _object
         .object_data    = (runtime), \
         .object_config  = (config) }
 
+/**
+ * Object levels, the objects are probed level by level.
+ */
+#define OBJECT_LEVEL_CORE           0
+#define OBJECT_LEVEL_EARLY_DRIVER   1
+#define OBJECT_LEVEL_MIDDLEWARE     2
+#define OBJECT_LEVEL_SERVICE        3
+
+/**
+ * The maximum number of objects, the probe engine tracks the dependencies of
+ * an object in a 32 bits mask.
+ */
+#define OBJECT_MAX_NUM 32
+
+/**
+ * @brief   Object dependency entry, the object is probed after the object it
+ *          depends on and skipped if that one fails.
+ */
+typedef struct
+{
+    const char* name;
+    const char* depends;
+} object_dependency_t;
+
+/**
+ * Each module declares the dependencies of its own objects, the entries are
+ * collected in the "object_dep" section and resolved by name in
+ * object_init(). The labels only make the symbol unique.
+ */
+#define DECLARE_OBJECT_DEPENDENCY(object_name, \
+                                  object_label, \
+                                  depends_name, \
+                                  depends_label) \
+    __define_object_dependency(object_name, \
+                               object_label, \
+                               depends_name, \
+                               depends_label)
+
+#define __define_object_dependency(object_name, \
+                                   object_label, \
+                                   depends_name, \
+                                   depends_label) \
+    static const object_dependency_t \
+    __object_dep_ ## object_label ## _ ## depends_label \
+    __attribute__((used, section("object_dep"))) = { \
+        .name       = (object_name), \
+        .depends    = (depends_name) }
+
+/**
+ * @brief   Lazy object entry, the object is not probed by object_init() but
+ *          on its first use, and shut down after idle_ms without users.
+ */
+typedef struct
+{
+    const char* name;
+    uint32_t    idle_ms;            /* 0 to keep it once probed */
+} object_lazy_t;
+
+/**
+ * Each module declares its own lazy objects, the entries are collected in
+ * the "object_lazy" section and resolved by name in object_init(). A lazy
+ * object is probed by object_get(), the users of its API hold it by
+ * object_get() and object_put() so it is not shut down under them. It has no
+ * binding, object_get_binding() refuses it.
+ */
+#define DECLARE_OBJECT_LAZY(object_name, object_label, idle_ms) \
+    __define_object_lazy(object_name, object_label, idle_ms)
+
+#define __define_object_lazy(object_name, object_label, idle_time) \
+    static const object_lazy_t __object_lazy_ ## object_label \
+    __attribute__((used, section("object_lazy"))) = { \
+        .name       = (object_name), \
+        .idle_ms    = (idle_time) }
+
+/**
+ * @brief   Probe state of the object.
+ */
+typedef enum
+{
+    OBJECT_STATE_IDLE = 0,          /* Not probed yet */
+    OBJECT_STATE_PROBING,           /* Probe in progress */
+    OBJECT_STATE_READY,             /* Probe succeed */
+    OBJECT_STATE_FAILED,            /* Probe failed */
+    OBJECT_STATE_SKIPPED,           /* Not probed, a dependency is missing */
+
+    OBJECT_STATE_NUM,
+} object_state_e;
+
+/**
+ * @brief   Runtime state of the object, recorded by object_init().
+ *
+ * @note    The start and end are in system timer cycles since object_init()
+ *          began, the parent is the object it waited for last, so following
+ *          the parents from the last object gives the boot critical path.
+ *          A lazy object stays OBJECT_STATE_IDLE until its first use, and
+ *          goes back to it when shut down for idle.
+ */
+typedef struct
+{
+    volatile object_state_e state;
+    int32_t     ret;
+    uint32_t    level;
+    uint32_t    depends;            /* Mask of the explicit dependencies */
+    uint32_t    start;
+    uint32_t    end;
+    int32_t     parent;             /* Object index, -1 if none */
+    uint32_t    critical;           /* Set if on the boot critical path */
+
+    uint32_t    lazy;               /* Set if probed on first use */
+    uint32_t    idle_ms;            /* Idle time before the shutdown */
+    uint32_t    users;              /* Users holding the lazy object */
+    uint32_t    last_use;           /* Kernel tick of the last use */
+} object_runtime_t;
+
+/**
+ * @brief   Warm restart statistics.
+ *
+ * @note    The reset_us is the full boot for comparison, from main() to the
+ *          startup completed with the boot profiler, the boot probe only
+ *          otherwise.
+ */
+typedef struct
+{
+    uint32_t    count;              /* Objects restarted */
+    uint32_t    shutdown_us;
+    uint32_t    probe_us;
+    uint32_t    reset_us;
+} object_restart_stats_t;
+
+/**
+ * Get the interface of the object as the given type, for example
+ * object_get_typed_intf(CONFIG_MMI_SERVICE_NAME, service_intf_t). The objects
+ * are constant and never move, so the callers may cache the bindings. A lazy
+ * object has no binding, it is used through object_get() and object_put().
+ */
+#define object_get_typed_intf(name, type) \
+    ((const type*)object_get_intf(name))
+
 #define module_core(name, label, probe, shutdown, intf, runtime, config) \
     __define_object(name, label, probe, shutdown, NULL, NULL, \
                     intf, runtime, config, 0)
-#define module_early_driver(name, label, probe, shutdown, intf, runtime, config) \
+#define module_early_driver(name, label, probe, shutdown, \
+                            intf, runtime, config) \
     __define_object(name, label, probe, shutdown, NULL, NULL, \
                     intf, runtime, config, 1)
 #define module_middleware(name, label, probe, shutdown, intf, runtime, config) \
@@ -97,10 +236,41 @@ typedef struct _object
     __define_object(name, label, probe, shutdown, NULL, NULL, \
                     intf, runtime, config, 3)
 
+/**
+ * The same levels for the objects with power hooks, they are suspended in
+ * the reverse order of the probe and resumed in the probe order, see
+ * object_pm.h for the levels passed to the hooks.
+ */
+#define module_core_pm(name, label, probe, shutdown, suspend, resume, \
+                       intf, runtime, config) \
+    __define_object(name, label, probe, shutdown, suspend, resume, \
+                    intf, runtime, config, 0)
+#define module_early_driver_pm(name, label, probe, shutdown, suspend, resume, \
+                               intf, runtime, config) \
+    __define_object(name, label, probe, shutdown, suspend, resume, \
+                    intf, runtime, config, 1)
+#define module_middleware_pm(name, label, probe, shutdown, suspend, resume, \
+                             intf, runtime, config) \
+    __define_object(name, label, probe, shutdown, suspend, resume, \
+                    intf, runtime, config, 2)
+#define module_service_pm(name, label, probe, shutdown, suspend, resume, \
+                          intf, runtime, config) \
+    __define_object(name, label, probe, shutdown, suspend, resume, \
+                    intf, runtime, config, 3)
+
 extern int32_t object_init(void);
 extern int32_t object_deinit(void);
+extern int32_t object_restart(const char* const name,
+                              object_restart_stats_t* stats);
 extern int32_t object_suspend(int32_t level);
 extern int32_t object_resume(int32_t level);
 extern const object* object_get_binding(const char* const name);
+extern const void* object_get_intf(const char* const name);
+extern int32_t object_get(const char* const name);
+extern int32_t object_put(const char* const name);
+extern uint32_t object_get_count(void);
+extern const object* object_get_by_index(uint32_t index);
+extern const object_runtime_t* object_get_runtime(uint32_t index);
+extern int32_t object_get_index(const char* const name);
 
 #endif /* __OBJECT_H__ */
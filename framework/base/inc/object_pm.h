@@ -0,0 +1,138 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OBJECT_PM_H__
+#define __OBJECT_PM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "object.h"
+
+/**
+ * Levels passed to the suspend and resume hooks of the objects.
+ */
+#define OBJECT_PM_LEVEL_RUNTIME 0   /* The object alone, idle for a while */
+#define OBJECT_PM_LEVEL_SLEEP   1   /* The system, the clocks keep running */
+#define OBJECT_PM_LEVEL_STOP    2   /* The system, the clocks are stopped */
+
+/**
+ * @brief   Power state of the object.
+ */
+typedef enum
+{
+    OBJECT_PM_STATE_ACTIVE = 0,
+    OBJECT_PM_STATE_SUSPENDING,
+    OBJECT_PM_STATE_SUSPENDED,
+    OBJECT_PM_STATE_RESUMING,
+    OBJECT_PM_STATE_ERROR,          /* Resume failed, the object is unusable */
+
+    OBJECT_PM_STATE_NUM,
+} object_pm_state_e;
+
+/**
+ * @brief   Runtime power management entry, the object is suspended at the
+ *          runtime level when it has no users for autosuspend_ms.
+ */
+typedef struct
+{
+    const char* name;
+    uint32_t    autosuspend_ms;     /* 0 to suspend on the last put */
+} object_pm_desc_t;
+
+/**
+ * Each module declares its own runtime power managed objects, the entries
+ * are collected in the "object_pm" section and resolved by name when
+ * object_init() finishes. The users of the object API hold it active by
+ * object_pm_get() and object_pm_put().
+ */
+#define DECLARE_OBJECT_PM(object_name, object_label, autosuspend_ms) \
+    __define_object_pm(object_name, object_label, autosuspend_ms)
+
+#define __define_object_pm(object_name, object_label, autosuspend_time) \
+    static const object_pm_desc_t __object_pm_ ## object_label \
+    __attribute__((used, section("object_pm"))) = { \
+        .name           = (object_name), \
+        .autosuspend_ms = (autosuspend_time) }
+
+/**
+ * @brief   Power management state of the object.
+ *
+ * @note    The latencies are the last and the worst time spent in the
+ *          suspend and resume hooks, in system timer cycles.
+ */
+typedef struct
+{
+    volatile object_pm_state_e state;
+    uint32_t    runtime;            /* Set if declared by DECLARE_OBJECT_PM */
+    uint32_t    system;             /* Set if suspended by object_suspend() */
+    uint32_t    usage;              /* Users holding the object active */
+    uint32_t    autosuspend_ms;
+    uint32_t    last_busy;          /* Time of the last put in ms */
+
+    uint32_t    suspend_count;
+    uint32_t    resume_count;
+    uint32_t    error_count;
+    uint32_t    suspend_cycles;
+    uint32_t    resume_cycles;
+    uint32_t    suspend_max_cycles;
+    uint32_t    resume_max_cycles;
+} object_pm_t;
+
+/**
+ * @brief   Idle sleep statistics of the tickless idle.
+ */
+typedef struct
+{
+    uint32_t    sleep_count;
+    uint32_t    deep_count;         /* Sleeps with every managed object down */
+    uint32_t    sleep_ticks;        /* Ticks actually slept */
+} object_pm_sleep_stats_t;
+
+/* The state machine, it only calls the hooks of the given object */
+extern void object_pm_reset(object_pm_t* pm);
+extern int32_t object_pm_suspend_one(const object*  obj,
+                                     object_pm_t*   pm,
+                                     int32_t        level);
+extern int32_t object_pm_resume_one(const object*   obj,
+                                    object_pm_t*    pm,
+                                    int32_t         level);
+extern int32_t object_pm_runtime_get(const object* obj, object_pm_t* pm);
+extern int32_t object_pm_runtime_put(const object*  obj,
+                                     object_pm_t*   pm,
+                                     uint32_t       now_ms);
+extern int32_t object_pm_runtime_idle(const object* obj,
+                                      object_pm_t*  pm,
+                                      uint32_t      now_ms);
+
+/* The objects of the system */
+extern int32_t object_pm_start(void);
+extern void object_pm_restart(uint32_t index);
+extern int32_t object_pm_get(const char* const name);
+extern int32_t object_pm_put(const char* const name);
+extern const object_pm_t* object_pm_get_by_index(uint32_t index);
+extern const object_pm_sleep_stats_t* object_pm_get_sleep_stats(void);
+extern const char* object_pm_state_to_str(uint32_t state);
+
+/* The tickless idle hooks, see configPRE_SLEEP_PROCESSING */
+extern void object_pm_sleep_enter(uint32_t* idle_ticks);
+extern void object_pm_sleep_exit(uint32_t idle_ticks);
+extern void object_pm_sleep_account(uint32_t ticks);
+extern void object_pm_sleep_prepare(uint32_t deep);
+extern void object_pm_sleep_finish(uint32_t deep);
+
+#endif /* __OBJECT_PM_H__ */
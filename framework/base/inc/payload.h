@@ -0,0 +1,49 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PAYLOAD_H__
+#define __PAYLOAD_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct _payload_t;
+typedef struct _payload_t payload_t;
+
+/**
+ * @brief   Payload pool statistics definitions.
+ */
+typedef struct
+{
+    uint32_t    alloc_count;        /* Blocks allocated */
+    uint32_t    free_count;         /* Blocks returned to the pool */
+    uint32_t    fail_count;         /* Allocations failed on exhaustion */
+    uint32_t    oversize_count;     /* Allocations larger than the block */
+    uint32_t    in_use;             /* Blocks in use */
+    uint32_t    in_use_max;         /* Peak blocks in use */
+} payload_stats_t;
+
+extern payload_t* payload_alloc(uint32_t size);
+extern payload_t* payload_hold(payload_t* payload);
+extern void payload_release(payload_t* payload);
+extern void* payload_get_data(const payload_t* payload);
+extern uint32_t payload_get_size(const payload_t* payload);
+extern uint32_t payload_get_capacity(void);
+extern const payload_stats_t* payload_get_stats(void);
+
+#endif /* __PAYLOAD_H__ */
@@ -23,10 +23,116 @@
 #include <stdint.h>
 #include "cmsis_os.h"
 #include "object.h"
+#include "message.h"
+#include "service_trace.h"
+#include "service_supervisor.h"
 
 struct _service_t;
 typedef struct _service_t service_t;
 
+/**
+ * The maximum number of services, the broadcast engine tracks the blocking
+ * subscribers in a 32 bits mask.
+ */
+#define SERVICE_MAX_NUM 32
+
+/**
+ * Thread flags reserved by the service framework, the service thread sleeps
+ * on SERVICE_FLAG_MESSAGE, a requester sleeps on SERVICE_FLAG_REPLY and a
+ * sender waiting for queue capacity sleeps on SERVICE_FLAG_CREDIT.
+ */
+#define SERVICE_FLAG_MESSAGE    0x00000001
+#define SERVICE_FLAG_REPLY      0x00000002
+#define SERVICE_FLAG_CREDIT     0x00000004
+
+/**
+ * @brief   Message lanes of the service, the higher lane is always handled
+ *          first.
+ */
+typedef enum
+{
+    SERVICE_LANE_NORMAL = 0,
+    SERVICE_LANE_URGENT,
+
+    SERVICE_LANE_NUM,
+} service_lane_e;
+
+/**
+ * @brief   Service lane statistics definitions.
+ */
+typedef struct
+{
+    uint32_t    enqueue_count;      /* Messages put into the lane */
+    uint32_t    handle_count;       /* Messages handled from the lane */
+    uint32_t    latency_max;        /* Maximum queue latency in cycles */
+    uint64_t    latency_sum;        /* Total queue latency in cycles */
+} service_lane_stats_t;
+
+/**
+ * @brief   Service statistics definitions.
+ */
+typedef struct
+{
+    uint32_t    enqueue_count;      /* Messages put into the queue */
+    uint32_t    wakeup_count;       /* Thread wakeups */
+    uint32_t    handle_count;       /* Messages handled */
+    uint32_t    drop_count;         /* Messages dropped on overflow */
+    uint32_t    batch_max;          /* Maximum messages in one batch */
+    uint32_t    coalesce_count;     /* Messages replaced in the mailbox */
+    uint32_t    credit_wait_count;  /* Senders which waited for credits */
+    uint32_t    credit_fail_count;  /* Credit waits which timed out */
+
+    service_lane_stats_t lane[SERVICE_LANE_NUM];
+} service_stats_t;
+
+/**
+ * @brief   Broadcast statistics definitions.
+ */
+typedef struct
+{
+    uint32_t    broadcast_count;    /* Broadcast calls */
+    uint32_t    enqueue_count;      /* Messages delivered to subscribers */
+    uint32_t    filter_count;       /* Deliveries skipped by subscription */
+    uint32_t    drop_count;         /* Deliveries dropped on overflow */
+    uint32_t    latency_max;        /* Maximum send latency in ticks */
+} service_broadcast_stats_t;
+
+/**
+ * @brief   Execution backend of the service.
+ */
+typedef enum
+{
+    SERVICE_BACKEND_THREAD = 0,     /* Dedicated thread */
+    SERVICE_BACKEND_POOL,           /* Shared worker pool */
+
+    SERVICE_BACKEND_NUM,
+} service_backend_e;
+
+/**
+ * @brief   Sender waiting for the credits of a service lane, it lives on the
+ *          stack of the waiting thread.
+ */
+typedef struct _service_credit_waiter_t
+{
+    struct _service_credit_waiter_t* next;
+    osThreadId_t    thread_id;
+    service_lane_e  lane;
+    uint32_t        count;
+} service_credit_waiter_t;
+
+/**
+ * @brief   Static memory of the service, emitted by DECLARE_SERVICE_STATIC.
+ */
+typedef struct
+{
+    StaticTask_t*   thread_cb;
+    void*           stack;
+    uint32_t        stack_size;
+    StaticQueue_t*  queue_cb;
+    message_t*      queue_mem[SERVICE_LANE_NUM];
+    uint32_t        msg_count[SERVICE_LANE_NUM];
+} service_static_mem_t;
+
 /**
  * @brief   Service handle definitions.
  */
@@ -34,22 +140,131 @@ typedef struct _service_t
 {
     const object*       owner;
     osThreadId_t        thread_id;
-    osMessageQueueId_t  queue_id;
+    osMessageQueueId_t  queue_id[SERVICE_LANE_NUM];
     void*               priv;
+    uint32_t            scheduled;
+    volatile uint32_t   stopping;   /* Set while the queues are torn down */
+    volatile uint32_t   users;      /* Senders using the queues */
+
+    const service_static_mem_t* static_mem;
+
+    uint32_t            reserved[SERVICE_LANE_NUM];
+    service_credit_waiter_t* volatile waiter;
+
+    uint32_t            subscription[MSG_ID_BASE_NUM];
+    service_stats_t     stats;
+    service_supervisor_t supervisor;
+#ifdef CONFIG_MSG_TRACE_ENABLE
+    service_trace_t     trace;
+#endif
 
     int32_t (* init)(const object* obj);
     int32_t (* deinit)(const object* obj);
     void (* message_handler)(const object* obj, const message_t* const message);
 } service_t;
 
+/**
+ * @brief   Message subscription entry, covers the IDs from first to last.
+ */
+typedef struct
+{
+    uint32_t    first;
+    uint32_t    last;
+} service_subscription_t;
+
+#define SERVICE_SUBSCRIBE(msg_id) \
+    { (msg_id), (msg_id) }
+#define SERVICE_SUBSCRIBE_RANGE(first_msg_id, last_msg_id) \
+    { (first_msg_id), (last_msg_id) }
+
+/**
+ * @brief   Message coalescing entry, a pending message with the same ID and
+ *          key is replaced in place by the newer one.
+ */
+typedef struct
+{
+    uint32_t    id;
+    uint32_t    key_param;
+} service_coalesce_t;
+
+#define SERVICE_COALESCE_KEY_NONE 0xffffffff
+
+#define SERVICE_COALESCE(msg_id) \
+    { (msg_id), SERVICE_COALESCE_KEY_NONE }
+#define SERVICE_COALESCE_BY_PARAM(msg_id, param_index) \
+    { (msg_id), (param_index) }
+
+/**
+ * @brief   Mailbox slot, holds the latest pending message of a key.
+ */
+typedef struct
+{
+    message_t   message;
+    uint32_t    pending;
+    uint32_t    queued;             /* Set once its token is queued */
+    uint32_t    lane;               /* Lane of the latest token */
+    uint32_t    seq;                /* Bumped when the slot is taken */
+} service_mailbox_slot_t;
+
+/**
+ * @brief   Behavior when the service queue is full.
+ */
+typedef enum
+{
+    SERVICE_OVERFLOW_DROP_NEWEST = 0,   /* Drop the message being sent */
+    SERVICE_OVERFLOW_DROP_OLDEST,       /* Drop the oldest queued message */
+    SERVICE_OVERFLOW_BLOCK,             /* Block the sender within budget */
+
+    SERVICE_OVERFLOW_NUM,
+} service_overflow_policy_e;
+
 /**
  * @brief   Service configuration structure.
+ *
+ * @note    The service only receives the broadcast messages which are listed
+ *          in the subscription table, unicast messages are always delivered.
+ *          The block_budget_ms is only used by SERVICE_OVERFLOW_BLOCK, zero
+ *          means CONFIG_MSG_SEND_BLOCK_TIMEOUT_MS.
+ *          After a wakeup the service thread handles up to batch_count
+ *          pending messages without blocking, the optional batch_begin and
+ *          batch_end hooks are called around each batch.
+ *          A SERVICE_BACKEND_POOL service has no thread of its own, it is
+ *          run by the shared worker threads one batch at a time and never
+ *          on two workers at once, the thread_attr is ignored.
+ *          Every lane has its own queue, the urgent queue holds
+ *          urgent_msg_count messages, zero means CONFIG_MSG_URGENT_COUNT.
+ *          The messages listed in the coalesce table are kept in the mailbox
+ *          instead of the queue, only one message per ID and key is pending
+ *          and the queue just carries a token for it. The mailbox needs one
+ *          slot per distinct key.
+ *          Handling one message should take at most handler_budget_ms, zero
+ *          means CONFIG_MSG_HANDLER_BUDGET_MS, the supervisor reports the
+ *          handlers which overrun it.
  */
 typedef struct
 {
-    osThreadAttr_t          thread_attr;
-    osMessageQueueAttr_t    queue_attr;
-    uint32_t                msg_count;
+    service_backend_e               backend;
+    osThreadAttr_t                  thread_attr;
+    osMessageQueueAttr_t            queue_attr;
+    uint32_t                        msg_count;
+    uint32_t                        urgent_msg_count;
+
+    const service_subscription_t*   subscription;
+    uint32_t                        subscription_count;
+
+    service_overflow_policy_e       overflow_policy;
+    uint32_t                        block_budget_ms;
+
+    uint32_t                        batch_count;
+    void (* batch_begin)(const object* obj);
+    void (* batch_end)(const object* obj);
+
+    const service_coalesce_t*       coalesce;
+    uint32_t                        coalesce_count;
+    service_mailbox_slot_t*         mailbox;
+    uint32_t                        mailbox_count;
+
+    uint32_t                        handler_budget_ms;
 } service_config_t;
 
 /**
@@ -67,12 +282,33 @@ extern const service_intf_t service_intf;
 extern int32_t service_probe(const object* obj);
 extern int32_t service_shutdown(const object* obj);
 extern osThreadId_t service_get_thread_id(const object* obj);
-extern osMessageQueueId_t service_get_queue_id(const object* obj);
+extern osMessageQueueId_t service_get_queue_id(const object*   obj,
+                                               service_lane_e  lane);
 extern void* service_get_priv_data(const object* obj);
 extern service_t* service_get_svc(const object* obj);
+extern uint32_t service_get_count(void);
+extern service_t* service_get_svc_by_index(uint32_t index);
+extern const service_broadcast_stats_t* service_get_broadcast_stats(void);
+extern osThreadId_t service_get_pool_worker(uint32_t index);
 extern int32_t service_broadcast_message(const message_t* message);
 extern int32_t service_unicast_message(const service_t* svc,
                                        const message_t* message);
+extern int32_t service_broadcast_message_prio(const message_t*  message,
+                                              service_lane_e    lane);
+extern int32_t service_unicast_message_prio(const service_t*   svc,
+                                            const message_t*   message,
+                                            service_lane_e     lane);
+extern uint32_t service_get_credit(const service_t* svc, service_lane_e lane);
+extern int32_t service_reserve_credit(const service_t*  svc,
+                                      service_lane_e    lane,
+                                      uint32_t          count,
+                                      uint32_t          timeout_ms);
+extern int32_t service_release_credit(const service_t*  svc,
+                                      service_lane_e    lane,
+                                      uint32_t          count);
+extern int32_t service_unicast_message_credit(const service_t*  svc,
+                                              const message_t*  message,
+                                              service_lane_e    lane);
 
 #define DECLARE_SERVICE(service_name, \
                         service_label, \
@@ -86,6 +322,69 @@ extern int32_t service_unicast_message(const service_t* svc,
                      priv_data, \
                      &service_intf, \
                      service_config, \
+                     NULL, \
+                     init_fn, \
+                     deinit_fn, \
+                     message_handler_fn)
+
+/**
+ * Same as DECLARE_SERVICE, but the thread control block, the stack and the
+ * queue storage are emitted as static arrays, so the service never allocates
+ * from the heap. The sizes are taken from the config_prefix_BACKEND,
+ * config_prefix_THREAD_STACK_SIZE and config_prefix_MSG_COUNT options, which
+ * the service configuration must use too. A SERVICE_BACKEND_POOL service has
+ * no stack. The urgent lane holds CONFIG_MSG_URGENT_COUNT messages.
+ */
+#define DECLARE_SERVICE_STATIC(service_name, \
+                               service_label, \
+                               priv_data, \
+                               service_config, \
+                               init_fn, \
+                               deinit_fn, \
+                               message_handler_fn, \
+                               config_prefix) \
+    __define_service_static(service_name, \
+                            service_label, \
+                            priv_data, \
+                            service_config, \
+                            init_fn, \
+                            deinit_fn, \
+                            message_handler_fn, \
+                            (config_prefix ## _BACKEND == \
+                             SERVICE_BACKEND_POOL) ? \
+                            0 : config_prefix ## _THREAD_STACK_SIZE, \
+                            config_prefix ## _MSG_COUNT)
+
+#define __define_service_static(service_name, \
+                                service_label, \
+                                priv_data, \
+                                service_config, \
+                                init_fn, \
+                                deinit_fn, \
+                                message_handler_fn, \
+                                thread_stack_size, \
+                                queue_msg_count) \
+    static StaticTask_t __service_tcb_ ## service_label; \
+    static uint64_t __service_stack_ ## service_label \
+        [(thread_stack_size) / 8 ? (thread_stack_size) / 8 : 1]; \
+    static StaticQueue_t __service_qcb_ ## service_label[SERVICE_LANE_NUM]; \
+    static message_t __service_mq_ ## service_label[queue_msg_count]; \
+    static message_t __service_urgent_mq_ ## service_label \
+        [CONFIG_MSG_URGENT_COUNT]; \
+    static const service_static_mem_t __service_static_ ## service_label = { \
+        .thread_cb  = &__service_tcb_ ## service_label, \
+        .stack      = __service_stack_ ## service_label, \
+        .stack_size = (thread_stack_size), \
+        .queue_cb   = __service_qcb_ ## service_label, \
+        .queue_mem  = { __service_mq_ ## service_label, \
+                        __service_urgent_mq_ ## service_label }, \
+        .msg_count  = { (queue_msg_count), CONFIG_MSG_URGENT_COUNT } }; \
+    __define_service(service_name, \
+                     service_label, \
+                     priv_data, \
+                     &service_intf, \
+                     service_config, \
+                     &__service_static_ ## service_label, \
                      init_fn, \
                      deinit_fn, \
                      message_handler_fn)
@@ -95,6 +394,7 @@ extern int32_t service_unicast_message(const service_t* svc,
                          priv_data, \
                          intf, \
                          service_config, \
+                         static_memory, \
                          init_fn, \
                          deinit_fn, \
                          message_handler_fn) \
@@ -102,7 +402,14 @@ extern int32_t service_unicast_message(const service_t* svc,
     __attribute__((used, section("module_service"))) = { \
         .owner              = NULL, \
         .thread_id          = NULL, \
-        .queue_id           = NULL, \
+        .queue_id           = { NULL }, \
+        .scheduled          = 0, \
+        .stopping           = 0, \
+        .users              = 0, \
+        .static_mem         = (static_memory), \
+        .reserved           = { 0 }, \
+        .waiter             = NULL, \
+        .subscription       = { 0 }, \
         .init               = (init_fn), \
         .deinit             = (deinit_fn), \
         .message_handler    = (message_handler_fn), \
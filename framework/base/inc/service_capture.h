@@ -0,0 +1,95 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SERVICE_CAPTURE_H__
+#define __SERVICE_CAPTURE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+#include "service.h"
+
+#ifdef CONFIG_MSG_CAPTURE_ENABLE
+
+/**
+ * Source and target of a capture record, a service is given by its index.
+ */
+#define SERVICE_CAPTURE_THREAD      0xfd    /* Thread outside any handler */
+#define SERVICE_CAPTURE_ISR         0xfe    /* Interrupt */
+#define SERVICE_CAPTURE_BROADCAST   0xff    /* Target of a broadcast */
+
+/**
+ * @brief   Capture record, the binary layout is shared with the host tool
+ *          tools/msg_capture, all fields are little endian.
+ *
+ * @note    The payload is not captured, the replayed messages carry none.
+ *          The timestamp is counted in milliseconds from the kernel tick,
+ *          so it only wraps after 49 days, the system timer cycles wrap
+ *          after about a minute.
+ */
+typedef struct
+{
+    uint32_t    timestamp;          /* Milliseconds since the start */
+    uint32_t    id;
+    uint8_t     source;
+    uint8_t     target;
+    uint8_t     lane;
+    uint8_t     reserved;
+    uint32_t    param[4];
+} __attribute__((packed)) service_capture_record_t;
+
+/**
+ * @brief   Capture state definitions.
+ */
+typedef enum
+{
+    SERVICE_CAPTURE_STATE_IDLE = 0,
+    SERVICE_CAPTURE_STATE_RECORD,
+    SERVICE_CAPTURE_STATE_REPLAY,
+
+    SERVICE_CAPTURE_STATE_NUM,
+} service_capture_state_e;
+
+/**
+ * @brief   Replay result definitions.
+ */
+typedef struct
+{
+    uint32_t    sent;               /* Messages sent */
+    uint32_t    failed;             /* Messages the service bus rejected */
+    uint32_t    handled;            /* Messages handled by the targets */
+    uint32_t    elapsed_ms;         /* From the first send to the last handle */
+} service_capture_result_t;
+
+extern void service_capture_record(const service_t*    svc,
+                                   const message_t*    message,
+                                   service_lane_e      lane);
+extern int32_t service_capture_start(void);
+extern int32_t service_capture_stop(void);
+extern service_capture_state_e service_capture_get_state(void);
+extern uint32_t service_capture_get_count(void);
+extern uint32_t service_capture_get_lost(void);
+extern const service_capture_record_t* service_capture_get(uint32_t index);
+extern int32_t service_capture_load(uint32_t                          index,
+                                    const service_capture_record_t*   record);
+extern int32_t service_capture_replay(uint32_t                    scale,
+                                      service_capture_result_t*   result);
+
+#endif
+
+#endif /* __SERVICE_CAPTURE_H__ */
@@ -0,0 +1,46 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SERVICE_EVENT_H__
+#define __SERVICE_EVENT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+#include "service.h"
+
+/**
+ * @brief   Event channel statistics definitions.
+ */
+typedef struct
+{
+    uint32_t    post_count;         /* Events accepted by the ring */
+    uint32_t    full_count;         /* Events dropped on a full ring */
+    uint32_t    dispatch_count;     /* Events delivered to the service bus */
+    uint32_t    fail_count;         /* Events the service bus rejected */
+    uint32_t    depth_max;          /* Maximum ring depth seen */
+} service_event_stats_t;
+
+extern int32_t service_event_post(const service_t*    svc,
+                                  const message_t*    message,
+                                  service_lane_e      lane);
+extern uint32_t service_event_is_ready(void);
+extern uint32_t service_event_is_dispatcher(void);
+extern const service_event_stats_t* service_event_get_stats(void);
+
+#endif /* __SERVICE_EVENT_H__ */
@@ -0,0 +1,63 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SERVICE_RPC_H__
+#define __SERVICE_RPC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+#include "service.h"
+
+/**
+ * @brief   Reply callback, it runs in the context of the replier.
+ *
+ * @param   reply Pointer to the reply message, the payload is released
+ *          after the callback returns.
+ * @param   user_ctx User context of the request.
+ */
+typedef void (*service_reply_clbk_t)(const message_t*  reply,
+                                     const void*       user_ctx);
+
+/**
+ * @brief   Request statistics definitions.
+ */
+typedef struct
+{
+    uint32_t    request_count;      /* Requests sent */
+    uint32_t    reply_count;        /* Replies delivered */
+    uint32_t    timeout_count;      /* Requests timed out or cancelled */
+    uint32_t    stale_count;        /* Replies without a waiting request */
+    uint32_t    busy_count;         /* Requests failed without free slot */
+} service_rpc_stats_t;
+
+extern int32_t service_request_message(const service_t* svc,
+                                       const message_t* request,
+                                       message_t*       reply,
+                                       uint32_t         timeout_ms);
+extern int32_t service_request_message_async(const service_t*      svc,
+                                             const message_t*      request,
+                                             service_reply_clbk_t  clbk,
+                                             const void*           user_ctx,
+                                             uint32_t*             correlation);
+extern int32_t service_cancel_request(uint32_t correlation);
+extern int32_t service_reply_message(const message_t* request,
+                                     const message_t* reply);
+extern const service_rpc_stats_t* service_rpc_get_stats(void);
+
+#endif /* __SERVICE_RPC_H__ */
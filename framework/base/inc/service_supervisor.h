@@ -0,0 +1,64 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SERVICE_SUPERVISOR_H__
+#define __SERVICE_SUPERVISOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cmsis_os.h"
+#include "object.h"
+
+/**
+ * @brief   Handler supervision state of a service.
+ *
+ * @note    The busy_id is the message in the handler, zero if idle. It is
+ *          written last on entry, so the supervisor never sees a message
+ *          with a stale start time.
+ */
+typedef struct
+{
+    volatile uint32_t   busy_id;
+    volatile uint32_t   busy_since;     /* Handler start, timer cycles */
+    osThreadId_t        busy_thread;    /* Thread running the handler */
+    uint32_t            flagged;        /* Report state of the handler */
+
+    uint32_t            overrun_count;  /* Handlers over the budget */
+    uint32_t            overrun_max;    /* Longest overrun in cycles */
+    uint32_t            overrun_id;     /* Message of the last overrun */
+} service_supervisor_t;
+
+/**
+ * @brief   Supervisor statistics definitions.
+ */
+typedef struct
+{
+    uint32_t    check_count;        /* Periodic checks */
+    uint32_t    overrun_count;      /* Overruns of all services */
+    uint32_t    stuck_count;        /* Checks which found a stuck handler */
+    uint32_t    refresh_count;      /* Watchdog refreshes */
+} service_supervisor_stats_t;
+
+extern void service_supervisor_enter(const object* obj, uint32_t id);
+extern void service_supervisor_leave(const object* obj);
+extern uint32_t service_supervisor_get_budget_ms(const object* obj);
+extern const service_supervisor_stats_t* service_supervisor_get_stats(void);
+extern void service_supervisor_watchdog_start(void);
+extern void service_supervisor_watchdog_refresh(void);
+
+#endif /* __SERVICE_SUPERVISOR_H__ */
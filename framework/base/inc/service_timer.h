@@ -0,0 +1,70 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SERVICE_TIMER_H__
+#define __SERVICE_TIMER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+#include "service.h"
+
+/**
+ * Timer keys are unique system-wide and never zero. A module builds its keys
+ * from its message base, so the keys of different modules never collide.
+ */
+#define SERVICE_TIMER_KEY(base, index) \
+    (((base) & MSG_ID_BASE_MASK) | ((index) & MSG_ID_OFFSET_MASK))
+
+/**
+ * @brief   Timer callback, it runs in the timer thread.
+ *
+ * @param   key Timer key.
+ * @param   user_ctx User context of the timer.
+ */
+typedef void (*service_timer_clbk_t)(uint32_t key, const void* user_ctx);
+
+/**
+ * @brief   Timer statistics definitions.
+ */
+typedef struct
+{
+    uint32_t    armed;              /* Timers currently armed */
+    uint32_t    armed_max;          /* Maximum timers armed at once */
+    uint32_t    fire_count;         /* Timers expired */
+    uint32_t    cascade_count;      /* Timers moved down the wheel */
+    uint32_t    busy_count;         /* Arms failed without free timer */
+} service_timer_stats_t;
+
+extern int32_t service_post_delayed(const service_t*   svc,
+                                    const message_t*   message,
+                                    uint32_t           delay_ms,
+                                    uint32_t           key);
+extern int32_t service_post_periodic(const service_t*  svc,
+                                     const message_t*  message,
+                                     uint32_t          period_ms,
+                                     uint32_t          key);
+extern int32_t service_timer_start(uint32_t                key,
+                                   uint32_t                delay_ms,
+                                   uint32_t                period_ms,
+                                   service_timer_clbk_t    clbk,
+                                   const void*             user_ctx);
+extern int32_t service_timer_cancel(uint32_t key);
+extern const service_timer_stats_t* service_timer_get_stats(void);
+
+#endif /* __SERVICE_TIMER_H__ */
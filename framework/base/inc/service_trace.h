@@ -0,0 +1,74 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SERVICE_TRACE_H__
+#define __SERVICE_TRACE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef CONFIG_MSG_TRACE_ENABLE
+
+/**
+ * The bucket n of the histogram counts the values in [2^n, 2^(n+1)) us,
+ * the bucket 0 also counts 0 us and the last bucket counts the rest.
+ */
+#define SERVICE_TRACE_BUCKET_NUM 16
+
+/**
+ * @brief   Trace metric definitions, the values are in system timer cycles.
+ */
+typedef struct
+{
+    uint32_t    min;
+    uint32_t    max;
+    uint64_t    sum;
+    uint32_t    histogram[SERVICE_TRACE_BUCKET_NUM];
+} service_trace_metric_t;
+
+/**
+ * @brief   Trace entry of a message ID.
+ */
+typedef struct
+{
+    uint32_t                id;
+    uint32_t                count;
+    service_trace_metric_t  queue;      /* From enqueue to dequeue */
+    service_trace_metric_t  handler;    /* Handler duration */
+} service_trace_entry_t;
+
+/**
+ * @brief   Trace of a service, the entries are taken by the message IDs in
+ *          the order they are seen.
+ */
+typedef struct
+{
+    service_trace_entry_t   entry[CONFIG_MSG_TRACE_ID_NUM];
+    uint32_t                overflow_count;
+} service_trace_t;
+
+extern void service_trace_record(service_trace_t*  trace,
+                                 uint32_t          id,
+                                 uint32_t          queue_cycles,
+                                 uint32_t          handler_cycles);
+extern void service_trace_reset(service_trace_t* trace);
+extern uint32_t service_trace_cycles_to_us(uint32_t cycles);
+
+#endif
+
+#endif /* __SERVICE_TRACE_H__ */
@@ -0,0 +1,272 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "framework.h"
+
+/**
+ * @brief   Get the cycle counter used by the boot profiler.
+ *
+ * @retval  Returns the cycle counter.
+ *
+ * @note    The default is the system timer of the kernel, which does not run
+ *          before the kernel starts nor while the kernel is locked. The
+ *          benchmarks of the man-machine service use it too.
+ */
+__weak uint32_t boot_profile_get_cycles(void)
+{
+    /**
+     * This function should not be modified, when the callback is needed,
+     * please override it on product layer.
+     */
+    return osKernelGetSysTimerCount();
+}
+
+/**
+ * @brief   Get the frequency of the cycle counter used by the boot profiler.
+ *
+ * @retval  Returns the frequency in Hz.
+ */
+__weak uint32_t boot_profile_get_freq(void)
+{
+    /**
+     * This function should not be modified, when the callback is needed,
+     * please override it on product layer.
+     */
+    return osKernelGetSysTimerFreq();
+}
+
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+
+/**
+ * @brief   Boot clock, converts the cycle counter to us piece by piece, so a
+ *          core clock change only blurs the span which contains it.
+ */
+typedef struct
+{
+    uint32_t    last;
+    uint32_t    remainder;
+    uint32_t    us;
+} boot_profile_clock_t;
+
+static boot_profile_clock_t boot_profile_clock;
+
+static boot_profile_t boot_profile;
+
+/**
+ * @brief   Enter the critical section, nothing to do before the kernel
+ *          starts since only main() runs.
+ *
+ * @retval  Returns 1 if the section is entered.
+ */
+static inline uint32_t boot_profile_lock(void)
+{
+    if (osKernelGetState() != osKernelRunning)
+    {
+        return 0;
+    }
+
+    taskENTER_CRITICAL();
+
+    return 1;
+}
+
+/**
+ * @brief   Exit the critical section.
+ *
+ * @param   locked The value returned by boot_profile_lock().
+ *
+ * @retval  None.
+ */
+static inline void boot_profile_unlock(uint32_t locked)
+{
+    if (locked)
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief   Advance the boot clock, must be called in the critical section.
+ *
+ * @param   now Current cycle counter.
+ *
+ * @retval  Returns the us since boot_profile_begin().
+ */
+static uint32_t boot_profile_update_us(uint32_t now)
+{
+    uint32_t cycles_per_us = boot_profile_get_freq() / 1000000;
+    uint32_t cycles;
+
+    if (!cycles_per_us)
+    {
+        cycles_per_us = 1;
+    }
+
+    cycles = now - boot_profile_clock.last + boot_profile_clock.remainder;
+
+    boot_profile_clock.us += cycles / cycles_per_us;
+    boot_profile_clock.remainder = cycles % cycles_per_us;
+    boot_profile_clock.last = now;
+
+    return boot_profile_clock.us;
+}
+
+/**
+ * @brief   Get the free stack of the calling thread.
+ *
+ * @retval  Returns the minimum free stack in bytes, 0 before the kernel
+ *          starts.
+ */
+static inline uint32_t boot_profile_get_stack_free(void)
+{
+    if (osKernelGetState() != osKernelRunning)
+    {
+        return 0;
+    }
+
+    return osThreadGetStackSpace(osThreadGetId());
+}
+
+/**
+ * @brief   Start the boot record, it is called first in main().
+ *
+ * @retval  None.
+ */
+void boot_profile_begin(void)
+{
+    (void)memset(&boot_profile, 0, sizeof(boot_profile));
+    (void)memset(&boot_profile_clock, 0, sizeof(boot_profile_clock));
+
+    boot_profile_clock.last = boot_profile_get_cycles();
+}
+
+/**
+ * @brief   Open a boot record entry.
+ *
+ * @param   name Entry name, it must stay valid until the next reset.
+ * @param   kind Entry kind.
+ * @param   level Object level, 0 if not an object.
+ *
+ * @retval  Returns the entry index, negative error code otherwise.
+ */
+int32_t boot_profile_enter(const char*          name,
+                           boot_profile_kind_e  kind,
+                           uint32_t             level)
+{
+    boot_profile_entry_t* entry;
+    uint32_t heap = xPortGetFreeHeapSize();
+    uint32_t locked;
+    uint32_t index;
+
+    locked = boot_profile_lock();
+
+    if (boot_profile.count >= CONFIG_BOOT_PROFILE_ENTRY_NUM)
+    {
+        boot_profile.lost++;
+
+        boot_profile_unlock(locked);
+
+        return -EFULL;
+    }
+
+    index = boot_profile.count++;
+    entry = &boot_profile.entry[index];
+
+    entry->name = name;
+    entry->kind = (uint8_t)kind;
+    entry->level = (uint8_t)level;
+    entry->ret = 0;
+    entry->heap_before = heap;
+    entry->cycles = boot_profile_get_cycles();
+    entry->start_us = boot_profile_update_us(entry->cycles);
+
+    boot_profile_unlock(locked);
+
+    return (int32_t)index;
+}
+
+/**
+ * @brief   Close a boot record entry.
+ *
+ * @param   index The index returned by boot_profile_enter().
+ * @param   ret Result of the span.
+ *
+ * @retval  None.
+ */
+void boot_profile_leave(int32_t index, int32_t ret)
+{
+    boot_profile_entry_t* entry;
+    uint32_t now;
+    uint32_t locked;
+
+    if (index < 0 || index >= (int32_t)boot_profile.count)
+    {
+        return;
+    }
+
+    entry = &boot_profile.entry[index];
+
+    entry->stack_free = boot_profile_get_stack_free();
+    entry->heap_after = xPortGetFreeHeapSize();
+    entry->ret = (int16_t)ret;
+
+    locked = boot_profile_lock();
+
+    now = boot_profile_get_cycles();
+
+    entry->cycles = now - entry->cycles;
+    entry->us = boot_profile_update_us(now) - entry->start_us;
+
+    boot_profile_unlock(locked);
+}
+
+/**
+ * @brief   Get the boot record.
+ *
+ * @retval  Boot record for reference.
+ */
+const boot_profile_t* boot_profile_get(void)
+{
+    return &boot_profile;
+}
+
+/**
+ * @brief   Convert the entry kind to string.
+ *
+ * @param   kind Entry kind.
+ *
+ * @retval  Returns the kind name.
+ */
+const char* boot_profile_kind_to_str(uint32_t kind)
+{
+    static const char* const kind_str[BOOT_PROFILE_KIND_NUM] =
+    {
+        "hook", "object", "service", "phase",
+    };
+
+    if (kind >= BOOT_PROFILE_KIND_NUM)
+    {
+        return "unknown";
+    }
+
+    return kind_str[kind];
+}
+
+#endif
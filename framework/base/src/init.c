@@ -74,23 +74,50 @@ static void init_thread(void* argument)
 {
     osStatus_t stat;
     int32_t ret;
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    int32_t profile;
+#endif
 
     (void)argument;
 
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    profile = boot_profile_enter("object init", BOOT_PROFILE_KIND_PHASE, 0);
+#endif
+
     ret = object_init();
     if (ret)
     {
         pr_error("Some objects initialize failed.");
     }
 
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    boot_profile_leave(profile, ret);
+
+    profile = boot_profile_enter("hardware later startup",
+                                 BOOT_PROFILE_KIND_HOOK,
+                                 0);
+#endif
+
     hardware_later_startup();
 
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    boot_profile_leave(profile, 0);
+
+    profile = boot_profile_enter("startup completed",
+                                 BOOT_PROFILE_KIND_PHASE,
+                                 0);
+#endif
+
     ret = msg_sys_startup_completed();
     if (ret)
     {
         pr_error("Sys startup failed, ret %d.");
     }
 
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    boot_profile_leave(profile, ret);
+#endif
+
     stat = osThreadTerminate(osThreadGetId());
     if (stat != osOK)
     {
@@ -108,9 +135,22 @@ int main(int argc, char* argv[])
 {
     osThreadId_t thread_id;
     osStatus_t stat;
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    int32_t profile;
+
+    boot_profile_begin();
+
+    profile = boot_profile_enter("hardware early startup",
+                                 BOOT_PROFILE_KIND_HOOK,
+                                 0);
+#endif
 
     hardware_early_startup();
 
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    boot_profile_leave(profile, 0);
+#endif
+
     stat = osKernelInitialize();
     if (stat != osOK)
     {
@@ -16,44 +16,216 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include "cmsis_os.h"
 #include "framework.h"
 
-typedef struct
-{
-    uint32_t    id;
-    const char* name;
-} msg_id_str_mapping_t;
+extern msg_desc_t msg_desc$$Base[];
+extern msg_desc_t msg_desc$$Limit[];
+
+/**
+ * @brief   Index of the message descriptions by base and offset, it keeps
+ *          the position in the "msg_desc" section plus one, zero means not
+ *          described.
+ */
+static uint8_t msg_desc_index[MSG_ID_BASE_NUM][MSG_ID_OFFSET_NUM];
+
+DECLARE_MESSAGE_DESC(MSG_ID_SYS_STARTUP_COMPLETED,
+                     SYS_STARTUP_COMPLETED,
+                     NULL, NULL, NULL, NULL);
+DECLARE_MESSAGE_DESC(MSG_ID_SYS_RUN_AUTOMATIC_TEST,
+                     SYS_RUN_AUTOMATIC_TEST,
+                     NULL, NULL, NULL, NULL);
+DECLARE_MESSAGE_DESC(MSG_ID_SYS_BENCHMARK,
+                     SYS_BENCHMARK,
+                     "sequence", NULL, NULL, NULL);
+DECLARE_MESSAGE_DESC(MSG_ID_SYS_MAILBOX,
+                     SYS_MAILBOX,
+                     "slot", NULL, NULL, NULL);
+DECLARE_MESSAGE_DESC(MSG_ID_BLE_SHCI_READY,
+                     BLE_SHCI_READY,
+                     NULL, NULL, NULL, NULL);
+DECLARE_MESSAGE_DESC(MSG_ID_BLE_ADV_TIMEOUT,
+                     BLE_ADV_TIMEOUT,
+                     NULL, NULL, NULL, NULL);
+DECLARE_MESSAGE_DESC(MSG_ID_BLE_HCI_CONNECTED,
+                     BLE_HCI_CONNECTED,
+                     NULL, NULL, NULL, NULL);
+DECLARE_MESSAGE_DESC(MSG_ID_BLE_HCI_DISCONNECTED,
+                     BLE_HCI_DISCONNECTED,
+                     NULL, NULL, NULL, NULL);
 
-static const msg_id_str_mapping_t msg_id_str_mapping[] =
+/**
+ * @brief   Get the message description.
+ *
+ * @param   id Message ID.
+ *
+ * @retval  Message description for reference or NULL if not described.
+ */
+const msg_desc_t* msg_get_desc(uint32_t id)
 {
-    { MSG_ID_SYS_STARTUP_COMPLETED,   "SYS_STARTUP_COMPLETED"   },
-    { MSG_ID_SYS_RUN_AUTOMATIC_TEST,  "SYS_RUN_AUTOMATIC_TEST"  },
-    { MSG_ID_LED_SETUP,               "LED_SETUP"               },
-    { MSG_ID_BTN_STATE_NOTIFY,        "BTN_STATE_NOTIFY"        },
-    { MSG_ID_BLE_SHCI_READY,          "BLE_SHCI_READY"          },
-    { MSG_ID_BLE_ADV_TIMEOUT,         "BLE_ADV_TIMEOUT"         },
-    { MSG_ID_BLE_HCI_CONNECTED,       "BLE_HCI_CONNECTED"       },
-    { MSG_ID_BLE_HCI_DISCONNECTED,    "BLE_HCI_DISCONNECTED"    },
-    { MSG_ID_MMI_CLIENT_INPUT_NOTIFY, "MMI_CLIENT_INPUT_NOTIFY" },
-};
+    uint8_t index;
 
+    if (!msg_id_is_valid(id))
+    {
+        return NULL;
+    }
+
+    index = msg_desc_index[msg_id_base_index(id)][msg_id_offset(id)];
+    if (!index)
+    {
+        return NULL;
+    }
+
+    return &msg_desc$$Base[index - 1];
+}
+
+/**
+ * @brief   Convert the message ID to string.
+ *
+ * @param   id Message ID.
+ *
+ * @retval  Returns the message name.
+ */
 const char* msg_id_to_str(uint32_t id)
 {
+    const msg_desc_t* desc = msg_get_desc(id);
+
+    if (!desc)
+    {
+        return "MSG_ID_UNKNOW";
+    }
+
+    return desc->name;
+}
+
+/**
+ * @brief   Format the message with the parameter names of its description.
+ *
+ * @param   buf Output buffer.
+ * @param   size Output buffer size.
+ * @param   message Pointer to the message structure.
+ *
+ * @retval  Returns the formatted length, negative error code otherwise.
+ */
+int32_t msg_format(char* buf, size_t size, const message_t* message)
+{
+    const msg_desc_t* desc;
+    const uint32_t params[4] =
+    {
+        message->param0,
+        message->param1,
+        message->param2,
+        message->param3,
+    };
+    int32_t length;
+    int32_t ret;
     uint32_t i;
 
-    for (i = 0; i < sizeof(msg_id_str_mapping) / sizeof(msg_id_str_mapping[0]); i++)
+    if (!buf || !size)
     {
-        if (msg_id_str_mapping[i].id == id)
+        return -EINVAL;
+    }
+
+    desc = msg_get_desc(message->id);
+    if (!desc)
+    {
+        return snprintf(buf,
+                        size,
+                        "MSG_ID_UNKNOW(0x%x) 0x%x, 0x%x, 0x%x, 0x%x",
+                        message->id,
+                        params[0],
+                        params[1],
+                        params[2],
+                        params[3]);
+    }
+
+    length = snprintf(buf, size, "%s(0x%x)", desc->name, message->id);
+
+    for (i = 0; i < 4 && length >= 0 && (size_t)length < size; i++)
+    {
+        if (!desc->param_name[i])
+        {
+            continue;
+        }
+
+        ret = snprintf(buf + length,
+                       size - length,
+                       " %s=0x%x",
+                       desc->param_name[i],
+                       params[i]);
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        length += ret;
+    }
+
+    return length;
+}
+
+/**
+ * @brief   Index the message descriptions.
+ *
+ * @param   obj Pointer to the message registry object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t msg_registry_probe(const object* obj)
+{
+    const msg_desc_t* desc;
+    uint8_t* index;
+    uint32_t count = msg_desc$$Limit - msg_desc$$Base;
+    uint32_t i;
+
+    (void)memset(msg_desc_index, 0, sizeof(msg_desc_index));
+
+    if (count > UINT8_MAX)
+    {
+        pr_error("Object <%s> has too many messages %d.", obj->name, count);
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        desc = &msg_desc$$Base[i];
+
+        if (!msg_id_is_valid(desc->id))
+        {
+            pr_error("Object <%s> invalid message %s(0x%x).",
+                     obj->name,
+                     desc->name,
+                     desc->id);
+            return -EINVAL;
+        }
+
+        index = &msg_desc_index[msg_id_base_index(desc->id)]
+                               [msg_id_offset(desc->id)];
+        if (*index)
         {
-            return msg_id_str_mapping[i].name;
+            pr_error("Object <%s> duplicate message %s(0x%x).",
+                     obj->name,
+                     desc->name,
+                     desc->id);
+            return -EEXIST;
         }
+
+        *index = (uint8_t)(i + 1);
     }
 
-    return "MSG_ID_UNKNOW";
+    pr_info("Object <%s> probe succeed.", obj->name);
+
+    return 0;
 }
 
+module_core(CONFIG_MSG_REGISTRY_NAME,
+            CONFIG_MSG_REGISTRY_LABEL,
+            msg_registry_probe,
+            NULL,
+            NULL, NULL, NULL);
+
 int32_t msg_sys_startup_completed(void)
 {
     message_t message;
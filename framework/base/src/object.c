@@ -19,8 +19,8 @@
 #include <stddef.h>
 #include <string.h>
 
-#include "object.h"
-#include "err.h"
+#include "cmsis_os.h"
+#include "framework.h"
 
 extern object module_object_0$$Base[];
 extern object module_object_0$$Limit[];
@@ -30,6 +30,10 @@ extern object module_object_2$$Base[];
 extern object module_object_2$$Limit[];
 extern object module_object_3$$Base[];
 extern object module_object_3$$Limit[];
+extern object_dependency_t object_dep$$Base[];
+extern object_dependency_t object_dep$$Limit[];
+extern object_lazy_t object_lazy$$Base[];
+extern object_lazy_t object_lazy$$Limit[];
 
 /**
  * @brief   Define object levels.
@@ -49,51 +53,981 @@ static object* object_levels[] =
 #define OBJECT_LEVELS_NUM (sizeof(object_levels) / sizeof(object_levels[0]))
 
 /**
- * @brief   Execute all the object initialization functions at a given level.
+ * Thread flags of the probe coordinator, a worker sets OBJECT_FLAG_PROBED
+ * after each probe and OBJECT_FLAG_EXIT before it exits.
+ */
+#define OBJECT_FLAG_PROBED  0x00010000
+#define OBJECT_FLAG_EXIT    0x00020000
+
+#define OBJECT_PROBE_EXIT   0xffffffff
+
+#define OBJECT_LAZY_TIMER_KEY SERVICE_TIMER_KEY(MSG_ID_SYS_BASE, 1)
+
+/**
+ * @brief   Probe engine structure.
+ */
+typedef struct
+{
+    uint32_t            count;
+    uint32_t            base;
+    uint32_t            worker_num;
+    uint32_t            boot_cycles;    /* Object probe time of the boot */
+    osThreadId_t        coordinator_id;
+    osMessageQueueId_t  queue_id;
+    osMutexId_t         lazy_mutex;
+    object_runtime_t    runtime[OBJECT_MAX_NUM];
+} object_probe_t;
+
+static object_probe_t object_probe;
+
+static StaticSemaphore_t object_lazy_mutex_cb;
+
+/**
+ * @brief   Attributes structure for the lazy object mutex, a lazy probe may
+ *          use another lazy object, so it is recursive.
+ */
+const osMutexAttr_t object_lazy_mutex_attr =
+{
+    .name       = CONFIG_OBJECT_LAZY_MUTEX_NAME,
+    .attr_bits  = osMutexRecursive | osMutexPrioInherit,
+    .cb_mem     = &object_lazy_mutex_cb,
+    .cb_size    = sizeof(object_lazy_mutex_cb),
+};
+
+/**
+ * @brief   Attributes structure for the probe worker threads.
+ */
+const osThreadAttr_t object_probe_worker_attr =
+{
+    .name       = CONFIG_OBJECT_PROBE_THREAD_NAME,
+    .attr_bits  = osThreadDetached,
+    .cb_mem     = NULL,
+    .cb_size    = 0,
+    .stack_mem  = NULL,
+    .stack_size = CONFIG_OBJECT_PROBE_THREAD_STACK_SIZE,
+    .priority   = CONFIG_OBJECT_PROBE_THREAD_PRIORITY,
+};
+
+/**
+ * @brief   Name index entry.
+ */
+typedef struct
+{
+    uint32_t        hash;
+    uint32_t        index;
+    const object*   obj;
+} object_index_entry_t;
+
+/**
+ * @brief   Name index of the objects, sorted by hash.
+ */
+typedef struct
+{
+    uint32_t                count;
+    object_index_entry_t    entry[OBJECT_MAX_NUM];
+} object_index_t;
+
+static object_index_t object_index;
+
+/**
+ * @brief   Hash the object name, 32 bits FNV-1a.
  *
- * @param   level Object level.
+ * @param   name Object name.
+ *
+ * @retval  Returns the hash.
+ */
+static uint32_t object_hash(const char* name)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    while (*name)
+    {
+        hash ^= (uint8_t)*name++;
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief   Build the name index, the objects never move, so it is built
+ *          once by object_init() or on an earlier lookup.
+ *
+ * @retval  None.
+ *
+ * @note    Both happen in main() or the init thread before the other threads
+ *          run, so no lock is needed. The objects beyond OBJECT_MAX_NUM are
+ *          not indexed, object_init() reports them.
+ */
+static void object_index_build(void)
+{
+    object_index_entry_t entry;
+    uint32_t count;
+    uint32_t i;
+    uint32_t j;
+
+    count = object_get_count();
+
+    /* Insertion sort, there are only a few dozen objects */
+    for (i = 0; i < count; i++)
+    {
+        entry.obj = object_get_by_index(i);
+        entry.hash = object_hash(entry.obj->name);
+        entry.index = i;
+
+        for (j = i; j > 0 && object_index.entry[j - 1].hash > entry.hash; j--)
+        {
+            object_index.entry[j] = object_index.entry[j - 1];
+        }
+
+        object_index.entry[j] = entry;
+    }
+
+    object_index.count = count;
+}
+
+/**
+ * @brief   Find the name index entry of the object.
+ *
+ * @param   name Object name.
+ *
+ * @retval  Index entry for reference or NULL if not found.
+ */
+static const object_index_entry_t* object_index_find(const char* const name)
+{
+    const object_index_entry_t* entry;
+    uint32_t hash = object_hash(name);
+    uint32_t low = 0;
+    uint32_t high;
+    uint32_t mid;
+
+    if (!object_index.count)
+    {
+        object_index_build();
+    }
+
+    /* Find the first entry whose hash is not less than the hash */
+    high = object_index.count;
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+
+        if (object_index.entry[mid].hash < hash)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    for (entry = &object_index.entry[low];
+         entry < &object_index.entry[object_index.count] &&
+         entry->hash == hash;
+         entry++)
+    {
+        if (!strcmp(name, entry->obj->name))
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief   Get the index of the object by name.
+ *
+ * @param   name Object name.
+ *
+ * @retval  Returns the object index, negative error code otherwise.
+ */
+static int32_t object_find_index(const char* const name)
+{
+    const object_index_entry_t* entry = object_index_find(name);
+
+    return entry ? (int32_t)entry->index : -ENOENT;
+}
+
+/**
+ * @brief   Reset the runtime states and resolve the declared dependencies.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    An object may only depend on the objects of its own or a lower
+ *          level, because every level waits for the lower ones anyway. An
+ *          unknown or upward dependency makes the object skipped. The objects
+ *          beyond OBJECT_MAX_NUM are reported one by one and never probed,
+ *          the others still boot.
  */
-static int32_t object_do_one_initcall(int32_t level)
+static int32_t object_probe_prepare(void)
 {
+    const object_dependency_t* dep;
+    const object_lazy_t* lazy;
     const object* obj;
+    object_runtime_t* rt;
+    uint32_t level;
+    uint32_t index;
+    int32_t name_index;
+    int32_t depends_index;
+    int32_t ret = 0;
+
+    (void)memset(object_probe.runtime, 0, sizeof(object_probe.runtime));
+
+    /* Build the index before any worker can look an object up */
+    if (!object_index.count)
+    {
+        object_index_build();
+    }
+
+    object_probe.count = 0;
+
+    for (level = 0; level < OBJECT_LEVELS_NUM; level += 2)
+    {
+        for (obj = object_levels[level]; obj < object_levels[level + 1];
+             obj++)
+        {
+            if (object_probe.count >= OBJECT_MAX_NUM)
+            {
+                pr_error("Object <%s> exceeds the limit %d, not probed.",
+                         obj->name,
+                         OBJECT_MAX_NUM);
+                ret = -ENOMEM;
+                continue;
+            }
+
+            rt = &object_probe.runtime[object_probe.count++];
+            rt->level = level / 2;
+            rt->parent = -1;
+        }
+    }
+
+    for (dep = object_dep$$Base; dep < object_dep$$Limit; dep++)
+    {
+        name_index = object_find_index(dep->name);
+        if (name_index < 0)
+        {
+            continue;
+        }
+
+        rt = &object_probe.runtime[name_index];
+
+        depends_index = object_find_index(dep->depends);
+        if (depends_index < 0 ||
+            object_probe.runtime[depends_index].level > rt->level ||
+            depends_index == name_index)
+        {
+            pr_error("Object <%s> depends on <%s> invalid.",
+                     dep->name,
+                     dep->depends);
+
+            rt->state = OBJECT_STATE_SKIPPED;
+            rt->ret = -EINVAL;
+            continue;
+        }
+
+        rt->depends |= 1UL << depends_index;
+    }
+
+    for (lazy = object_lazy$$Base; lazy < object_lazy$$Limit; lazy++)
+    {
+        name_index = object_find_index(lazy->name);
+        if (name_index < 0)
+        {
+            pr_error("Lazy object <%s> not found.", lazy->name);
+            continue;
+        }
+
+        rt = &object_probe.runtime[name_index];
+        rt->lazy = 1;
+        rt->idle_ms = lazy->idle_ms;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief   Get the system timer cycles since object_init() began.
+ *
+ * @retval  Returns the cycles.
+ */
+static inline uint32_t object_probe_now(void)
+{
+    return osKernelGetSysTimerCount() - object_probe.base;
+}
+
+/**
+ * @brief   Probe one object and record the result.
+ *
+ * @param   index Object index.
+ *
+ * @retval  None.
+ */
+static void object_probe_one(uint32_t index)
+{
+    const object* obj = object_get_by_index(index);
+    object_runtime_t* rt = &object_probe.runtime[index];
+    int32_t ret = 0;
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    int32_t profile;
+
+    profile = boot_profile_enter(obj->name,
+                                 BOOT_PROFILE_KIND_OBJECT,
+                                 rt->level);
+#endif
+
+    rt->start = object_probe_now();
+
+    if (obj->probe)
+    {
+        ret = obj->probe(obj);
+    }
+
+    rt->end = object_probe_now();
+
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    boot_profile_leave(profile, ret);
+#endif
+    rt->ret = ret;
+    rt->state = ret ? OBJECT_STATE_FAILED : OBJECT_STATE_READY;
+
+    if (ret)
+    {
+        pr_error("Object <%s> probe failed, ret %d.", obj->name, ret);
+    }
+}
+
+/**
+ * @brief   Probe worker thread, probes the objects put into the queue.
+ *
+ * @param   argument None.
+ *
+ * @retval  None.
+ */
+static void object_probe_worker_thread(void* argument)
+{
+    uint32_t index;
+
+    (void)argument;
+
+    while (osMessageQueueGet(object_probe.queue_id,
+                             &index,
+                             NULL,
+                             osWaitForever) == osOK)
+    {
+        if (index == OBJECT_PROBE_EXIT)
+        {
+            break;
+        }
+
+        object_probe_one(index);
+
+        (void)osThreadFlagsSet(object_probe.coordinator_id,
+                               OBJECT_FLAG_PROBED);
+    }
+
+    (void)osThreadFlagsSet(object_probe.coordinator_id, OBJECT_FLAG_EXIT);
+
+    osThreadExit();
+}
+
+/**
+ * @brief   Start the probe workers.
+ *
+ * @retval  None.
+ *
+ * @note    Without workers the objects are probed one by one by the caller.
+ */
+static void object_probe_start_workers(void)
+{
+    uint32_t i;
+
+    object_probe.coordinator_id = osThreadGetId();
+    object_probe.queue_id = NULL;
+    object_probe.worker_num = 0;
+
+    if (!CONFIG_OBJECT_PROBE_WORKER_NUM)
+    {
+        return;
+    }
+
+    object_probe.queue_id = osMessageQueueNew(OBJECT_MAX_NUM,
+                                              sizeof(uint32_t),
+                                              NULL);
+    if (!object_probe.queue_id)
+    {
+        pr_error("Create probe queue failed, probe serially.");
+        return;
+    }
+
+    for (i = 0; i < CONFIG_OBJECT_PROBE_WORKER_NUM; i++)
+    {
+        if (!osThreadNew(object_probe_worker_thread,
+                         NULL,
+                         &object_probe_worker_attr))
+        {
+            pr_error("Create thread <%s> failed.",
+                     object_probe_worker_attr.name);
+            break;
+        }
+
+        object_probe.worker_num++;
+    }
+
+    /* Probe serially if no worker is running */
+    if (!object_probe.worker_num)
+    {
+        (void)osMessageQueueDelete(object_probe.queue_id);
+        object_probe.queue_id = NULL;
+    }
+}
+
+/**
+ * @brief   Stop the probe workers, they exit once the queue is drained.
+ *
+ * @retval  None.
+ */
+static void object_probe_stop_workers(void)
+{
+    uint32_t index = OBJECT_PROBE_EXIT;
+    uint32_t i;
+
+    if (!object_probe.queue_id)
+    {
+        return;
+    }
+
+    for (i = 0; i < object_probe.worker_num; i++)
+    {
+        if (osMessageQueuePut(object_probe.queue_id,
+                              &index,
+                              0,
+                              0) != osOK)
+        {
+            break;
+        }
+
+        (void)osThreadFlagsWait(OBJECT_FLAG_EXIT,
+                                osFlagsWaitAny,
+                                osWaitForever);
+    }
+
+    (void)osMessageQueueDelete(object_probe.queue_id);
+    object_probe.queue_id = NULL;
+}
+
+/**
+ * @brief   Probe the objects of a level whose dependencies are ready and skip
+ *          the ones whose dependencies failed.
+ *
+ * @param   level Object level.
+ * @param   barrier Index of the object which ended the lower levels, -1 if
+ *          none.
+ * @param   pending Returns the number of objects not probed yet.
+ * @param   probing Returns the number of objects being probed by workers.
+ *
+ * @retval  Returns the number of objects which changed state.
+ */
+static uint32_t object_probe_schedule(uint32_t  level,
+                                      int32_t   barrier,
+                                      uint32_t* pending,
+                                      uint32_t* probing)
+{
+    object_runtime_t* rt;
+    object_runtime_t* dep;
+    uint32_t progress = 0;
+    uint32_t blocked;
+    uint32_t index;
+    uint32_t i;
+    int32_t parent;
+
+    *pending = 0;
+    *probing = 0;
+
+    for (index = 0; index < object_probe.count; index++)
+    {
+        rt = &object_probe.runtime[index];
+
+        if (rt->level != level || rt->lazy)
+        {
+            continue;
+        }
+
+        if (rt->state == OBJECT_STATE_PROBING)
+        {
+            (*pending)++;
+            (*probing)++;
+            continue;
+        }
+
+        if (rt->state != OBJECT_STATE_IDLE)
+        {
+            continue;
+        }
+
+        blocked = 0;
+        parent = barrier;
+
+        for (i = 0; i < object_probe.count; i++)
+        {
+            if (!(rt->depends & (1UL << i)))
+            {
+                continue;
+            }
+
+            dep = &object_probe.runtime[i];
+
+            /* A lazy dependency is probed when it is used */
+            if (dep->lazy)
+            {
+                continue;
+            }
+
+            if (dep->state == OBJECT_STATE_FAILED ||
+                dep->state == OBJECT_STATE_SKIPPED)
+            {
+                rt->state = OBJECT_STATE_SKIPPED;
+                rt->ret = -ENODEV;
+                rt->parent = (int32_t)i;
+
+                pr_error("Object <%s> skipped, depends on <%s>.",
+                         object_get_by_index(index)->name,
+                         object_get_by_index(i)->name);
+                break;
+            }
+
+            if (dep->state != OBJECT_STATE_READY)
+            {
+                blocked = 1;
+            }
+            else if (parent < 0 ||
+                     dep->end > object_probe.runtime[parent].end)
+            {
+                parent = (int32_t)i;
+            }
+        }
+
+        if (rt->state == OBJECT_STATE_SKIPPED)
+        {
+            progress++;
+            continue;
+        }
+
+        if (blocked)
+        {
+            (*pending)++;
+            continue;
+        }
+
+        rt->parent = parent;
+        rt->state = OBJECT_STATE_PROBING;
+        progress++;
+
+        /* The core and early driver objects touch the shared clock and bus
+         * registers without any lock, they are probed one by one */
+        if (level >= OBJECT_LEVEL_MIDDLEWARE && object_probe.queue_id &&
+            osMessageQueuePut(object_probe.queue_id, &index, 0, 0) == osOK)
+        {
+            (*pending)++;
+            (*probing)++;
+        }
+        else
+        {
+            object_probe_one(index);
+        }
+    }
+
+    return progress;
+}
+
+/**
+ * @brief   Mark the objects on the boot critical path and report it.
+ *
+ * @retval  None.
+ */
+static void object_probe_report(void)
+{
+    const object_runtime_t* rt;
+    uint32_t cycles_per_us = osKernelGetSysTimerFreq() / 1000000;
+    uint64_t probe_sum = 0;
+    uint32_t wall = 0;
+    int32_t last = -1;
+    int32_t index;
+
+    for (index = 0; index < (int32_t)object_probe.count; index++)
+    {
+        rt = &object_probe.runtime[index];
+
+        if (rt->state != OBJECT_STATE_READY &&
+            rt->state != OBJECT_STATE_FAILED)
+        {
+            continue;
+        }
+
+        probe_sum += rt->end - rt->start;
+
+        if (last < 0 || rt->end > object_probe.runtime[last].end)
+        {
+            last = index;
+        }
+    }
+
+    if (last < 0)
+    {
+        return;
+    }
+
+    wall = object_probe.runtime[last].end;
+
+    pr_info("Boot probe took %u us, %u us of probes, critical path:",
+            wall / cycles_per_us,
+            (uint32_t)(probe_sum / cycles_per_us));
+
+    /* Walk back from the last object, every object waited for its parent */
+    for (index = last; index >= 0; index = rt->parent)
+    {
+        rt = &object_probe.runtime[index];
+        object_probe.runtime[index].critical = 1;
+
+        pr_info("  <%s> level %u, start %u us, probe %u us.",
+                object_get_by_index(index)->name,
+                rt->level,
+                rt->start / cycles_per_us,
+                (rt->end - rt->start) / cycles_per_us);
+    }
+}
+
+/**
+ * @brief   Shut down the lazy objects which stayed idle long enough.
+ *
+ * @param   key Timer key.
+ * @param   user_ctx None.
+ *
+ * @retval  None.
+ *
+ * @note    It runs on the timer thread, so it never waits for the mutex, a
+ *          busy lazy object is checked again on the next period.
+ */
+static void object_lazy_check(uint32_t key, const void* user_ctx)
+{
+    const object* obj;
+    object_runtime_t* rt;
+    uint32_t now = osKernelGetTickCount();
+    uint32_t index;
     int32_t ret;
 
-    for (obj = object_levels[level]; obj < object_levels[level + 1];
-         obj++)
-    {
-        if (obj && obj->probe)
+    (void)key;
+    (void)user_ctx;
+
+    if (osMutexAcquire(object_probe.lazy_mutex, 0) != osOK)
+    {
+        return;
+    }
+
+    for (index = 0; index < object_probe.count; index++)
+    {
+        rt = &object_probe.runtime[index];
+
+        if (!rt->lazy || !rt->idle_ms || rt->users ||
+            rt->state != OBJECT_STATE_READY ||
+            now - rt->last_use < rt->idle_ms * osKernelGetTickFreq() / 1000)
+        {
+            continue;
+        }
+
+        obj = object_get_by_index(index);
+
+        ret = obj->shutdown ? obj->shutdown(obj) : 0;
+        if (ret)
+        {
+            pr_error("Lazy object <%s> shutdown failed, ret %d.",
+                     obj->name,
+                     ret);
+            continue;
+        }
+
+        rt->state = OBJECT_STATE_IDLE;
+
+        pr_info("Lazy object <%s> shut down after %u ms idle.",
+                obj->name,
+                rt->idle_ms);
+    }
+
+    (void)osMutexRelease(object_probe.lazy_mutex);
+}
+
+/**
+ * @brief   Start the lazy object support after the boot probe.
+ *
+ * @retval  None.
+ */
+static void object_lazy_start(void)
+{
+    uint32_t index;
+    int32_t ret;
+
+    if (!object_probe.lazy_mutex)
+    {
+        object_probe.lazy_mutex = osMutexNew(&object_lazy_mutex_attr);
+        if (!object_probe.lazy_mutex)
+        {
+            pr_error("Create mutex <%s> failed.",
+                     object_lazy_mutex_attr.name);
+            return;
+        }
+    }
+
+    for (index = 0; index < object_probe.count; index++)
+    {
+        if (object_probe.runtime[index].lazy &&
+            object_probe.runtime[index].idle_ms)
+        {
+            ret = service_timer_start(OBJECT_LAZY_TIMER_KEY,
+                                      CONFIG_OBJECT_LAZY_CHECK_PERIOD_MS,
+                                      CONFIG_OBJECT_LAZY_CHECK_PERIOD_MS,
+                                      object_lazy_check,
+                                      NULL);
+            if (ret)
+            {
+                pr_error("Start lazy object check failed, ret %d.", ret);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * @brief   Probe the lazy object if it is not probed yet.
+ *
+ * @param   index Object index.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The caller holds the lazy mutex.
+ */
+static int32_t object_lazy_probe(uint32_t index)
+{
+    object_runtime_t* rt = &object_probe.runtime[index];
+    object_runtime_t* dep;
+    uint32_t i;
+    int32_t ret;
+
+    if (rt->state == OBJECT_STATE_READY ||
+        rt->state == OBJECT_STATE_FAILED ||
+        rt->state == OBJECT_STATE_SKIPPED)
+    {
+        return rt->ret;
+    }
+
+    for (i = 0; i < object_probe.count; i++)
+    {
+        if (!(rt->depends & (1UL << i)))
+        {
+            continue;
+        }
+
+        dep = &object_probe.runtime[i];
+
+        ret = dep->lazy ? object_lazy_probe(i) : dep->ret;
+        if (ret || dep->state != OBJECT_STATE_READY)
+        {
+            pr_error("Lazy object <%s> skipped, depends on <%s>.",
+                     object_get_by_index(index)->name,
+                     object_get_by_index(i)->name);
+            return -ENODEV;
+        }
+
+        /* A lazy dependency stays while a lazy user of it is probed */
+        dep->last_use = osKernelGetTickCount();
+    }
+
+    rt->state = OBJECT_STATE_PROBING;
+
+    object_probe_one(index);
+
+    return rt->ret;
+}
+
+/**
+ * @brief   Use the object, probe it first if it is lazy.
+ *
+ * @param   index Object index.
+ * @param   users Number of users to add.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t object_lazy_use(uint32_t index, uint32_t users)
+{
+    object_runtime_t* rt = &object_probe.runtime[index];
+    int32_t ret;
+
+    if (!rt->lazy)
+    {
+        return (rt->state == OBJECT_STATE_READY) ? 0 : -ENODEV;
+    }
+
+    if (!object_probe.lazy_mutex || xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
+
+    if (osMutexAcquire(object_probe.lazy_mutex, osWaitForever) != osOK)
+    {
+        return -EPERM;
+    }
+
+    ret = object_lazy_probe(index);
+    if (!ret)
+    {
+        rt->users += users;
+        rt->last_use = osKernelGetTickCount();
+    }
+
+    (void)osMutexRelease(object_probe.lazy_mutex);
+
+    return ret;
+}
+
+/**
+ * @brief   Execute all the object initialization functions.
+ *
+ * @param   None.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The levels are still probed in order. The core and early driver
+ *          levels are probed one by one, inside the middleware and service
+ *          levels the objects whose dependencies are ready are probed
+ *          concurrently by CONFIG_OBJECT_PROBE_WORKER_NUM workers. A failed
+ *          object only skips the objects which declare a dependency on it,
+ *          directly or not.
+ *          The lazy objects are left for their first use, a dependency on
+ *          a lazy object does not hold back the boot.
+ */
+int32_t object_init(void)
+{
+    object_runtime_t* rt;
+    uint32_t level;
+    uint32_t pending;
+    uint32_t probing;
+    uint32_t progress;
+    uint32_t index;
+    int32_t barrier = -1;
+    int32_t ret;
+
+    /* The objects beyond the limit are left out, the others still boot */
+    ret = object_probe_prepare();
+
+    object_probe.base = osKernelGetSysTimerCount();
+
+    object_probe_start_workers();
+
+    for (level = 0; level < OBJECT_LEVELS_NUM / 2; level++)
+    {
+        while (1)
+        {
+            progress = object_probe_schedule(level,
+                                             barrier,
+                                             &pending,
+                                             &probing);
+            if (!pending)
+            {
+                break;
+            }
+
+            if (probing)
+            {
+                (void)osThreadFlagsWait(OBJECT_FLAG_PROBED,
+                                        osFlagsWaitAny,
+                                        osWaitForever);
+                continue;
+            }
+
+            if (!progress)
+            {
+                /* The rest depend on each other in a cycle */
+                for (index = 0; index < object_probe.count; index++)
+                {
+                    rt = &object_probe.runtime[index];
+
+                    if (rt->level == level && !rt->lazy &&
+                        rt->state == OBJECT_STATE_IDLE)
+                    {
+                        rt->state = OBJECT_STATE_SKIPPED;
+                        rt->ret = -EDEADLK;
+
+                        pr_error("Object <%s> skipped, dependency cycle.",
+                                 object_get_by_index(index)->name);
+                    }
+                }
+                break;
+            }
+        }
+
+        /* The next level waits for the last object probed so far */
+        for (index = 0; index < object_probe.count; index++)
         {
-            ret = obj->probe(obj);
-            if (ret)
+            rt = &object_probe.runtime[index];
+
+            if (rt->level == level &&
+                (rt->state == OBJECT_STATE_READY ||
+                 rt->state == OBJECT_STATE_FAILED) &&
+                (barrier < 0 || rt->end > object_probe.runtime[barrier].end))
             {
-                return ret;
+                barrier = (int32_t)index;
             }
         }
     }
 
-    return 0;
+    object_probe.boot_cycles = object_probe_now();
+
+    object_probe_stop_workers();
+
+    object_probe_report();
+
+    object_lazy_start();
+
+    (void)object_pm_start();
+
+    for (index = 0; index < object_probe.count; index++)
+    {
+        if (object_probe.runtime[index].ret)
+        {
+            return object_probe.runtime[index].ret;
+        }
+    }
+
+    return ret;
 }
 
 /**
- * @brief   Execute all the object initialization functions.
+ * @brief   Check if an object has to wait for others before its shutdown.
  *
- * @param   None.
+ * @param   index Object index.
+ * @param   remaining Mask of the objects not shut down yet.
  *
- * @retval  Returns 0 on success, negative error code otherwise.
+ * @retval  Returns 1 if an object still running depends on it or sits on a
+ *          higher level, 0 otherwise.
  */
-int32_t object_init(void)
+static uint32_t object_shutdown_blocked(uint32_t index, uint32_t remaining)
 {
-    uint32_t level;
-    int32_t ret;
+    const object_runtime_t* rt = &object_probe.runtime[index];
+    const object_runtime_t* user;
+    uint32_t i;
 
-    for (level = 0; level < OBJECT_LEVELS_NUM; level += 2)
+    for (i = 0; i < object_probe.count; i++)
     {
-        ret = object_do_one_initcall(level);
-        if (ret)
+        if (i == index || !(remaining & (1UL << i)))
+        {
+            continue;
+        }
+
+        user = &object_probe.runtime[i];
+
+        if ((user->depends & (1UL << index)) || user->level > rt->level)
         {
-            return ret;
+            return 1;
         }
     }
 
@@ -101,31 +1035,88 @@ int32_t object_init(void)
 }
 
 /**
- * @brief   Execute all the object de-initialization functions at a given level.
+ * @brief   Shut down the probed objects in the reverse order of the probe.
  *
- * @param   level Object level.
+ * @param   mask Mask of the objects to shut down.
+ * @param   ret Returns 0 on success, negative error code otherwise.
  *
- * @retval  Returns 0 on success, negative error code otherwise.
+ * @retval  Returns the mask of the objects shut down, the loop stops at the
+ *          first failure, the failed object and the ones it depends on are
+ *          left running.
+ *
+ * @note    The caller holds the lazy mutex. An object goes down only after
+ *          the ones of the higher levels and the ones which depend on it, so
+ *          the dependencies are torn down in reverse topological order
+ *          whatever the declaration order.
  */
-static int32_t object_do_one_deinitcall(int32_t level)
+static uint32_t object_shutdown_mask(uint32_t mask, int32_t* ret)
 {
     const object* obj;
-    int32_t ret;
+    object_runtime_t* rt;
+    uint32_t remaining;
+    uint32_t progress;
+    uint32_t done = 0;
+    uint32_t index;
+
+    *ret = 0;
+
+    remaining = mask & ((object_probe.count < 32) ?
+                        ((1UL << object_probe.count) - 1) : 0xffffffff);
 
-    for (obj = object_levels[level]; obj < object_levels[level + 1];
-         obj++)
+    while (remaining)
     {
-        if (obj && obj->shutdown)
+        progress = 0;
+
+        for (index = object_probe.count; index > 0; index--)
         {
-            ret = obj->shutdown(obj);
-            if (ret)
+            if (!(remaining & (1UL << (index - 1))) ||
+                object_shutdown_blocked(index - 1, remaining))
+            {
+                continue;
+            }
+
+            rt = &object_probe.runtime[index - 1];
+
+            if (rt->state == OBJECT_STATE_READY)
+            {
+                obj = object_get_by_index(index - 1);
+
+                *ret = obj->shutdown ? obj->shutdown(obj) : 0;
+                if (*ret)
+                {
+                    pr_error("Object <%s> shutdown failed, ret %d.",
+                             obj->name,
+                             *ret);
+                    return done;
+                }
+            }
+
+            rt->state = OBJECT_STATE_IDLE;
+            rt->ret = 0;
+            remaining &= ~(1UL << (index - 1));
+            done |= 1UL << (index - 1);
+            progress++;
+        }
+
+        if (!progress)
+        {
+            /* Only a dependency cycle blocks all, it was never probed */
+            for (index = object_probe.count; index > 0; index--)
             {
-                return ret;
+                if (remaining & (1UL << (index - 1)))
+                {
+                    break;
+                }
             }
+
+            object_probe.runtime[index - 1].state = OBJECT_STATE_IDLE;
+            object_probe.runtime[index - 1].ret = 0;
+            remaining &= ~(1UL << (index - 1));
+            done |= 1UL << (index - 1);
         }
     }
 
-    return 0;
+    return done;
 }
 
 /**
@@ -134,157 +1125,502 @@ static int32_t object_do_one_deinitcall(int32_t level)
  * @param   None.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The objects are shut down in the reverse order of the probe, only
+ *          the probed ones, they are idle afterwards.
  */
 int32_t object_deinit(void)
 {
-    uint32_t level;
+    uint32_t mask;
     int32_t ret;
 
-    for (level = OBJECT_LEVELS_NUM - 2; level == 0; level -= 2)
+    if (object_probe.lazy_mutex)
     {
-        ret = object_do_one_deinitcall(level);
-        if (ret)
-        {
-            return ret;
-        }
+        (void)osMutexAcquire(object_probe.lazy_mutex, osWaitForever);
     }
 
-    return 0;
+    mask = (object_probe.count < 32) ?
+           ((1UL << object_probe.count) - 1) : 0xffffffff;
+
+    (void)object_shutdown_mask(mask, &ret);
+
+    if (object_probe.lazy_mutex)
+    {
+        (void)osMutexRelease(object_probe.lazy_mutex);
+    }
+
+    return ret;
 }
 
 /**
- * @brief   Execute all the object suspend functions at a given level.
+ * @brief   Probe the idle objects again in the order of their dependencies.
  *
- * @param   level Object level.
- * @param   suspend_level Suspend level.
+ * @param   mask Mask of the objects to probe.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The caller holds the lazy mutex. The lazy objects are left idle
+ *          for their next use, as at boot.
  */
-static int32_t object_do_one_suspendcall(int32_t level, int32_t suspend_level)
+static int32_t object_reprobe_mask(uint32_t mask)
 {
-    const object* obj;
-    int32_t ret;
+    object_runtime_t* rt;
+    object_runtime_t* dep;
+    uint32_t progress;
+    uint32_t waiting;
+    uint32_t index;
+    uint32_t i;
+    int32_t ret = 0;
 
-    for (obj = object_levels[level]; obj < object_levels[level + 1];
-         obj++)
+    do
     {
-        if (obj && obj->suspend)
+        progress = 0;
+        waiting = 0;
+
+        for (index = 0; index < object_probe.count; index++)
         {
-            ret = obj->suspend(obj, suspend_level);
-            if (ret)
+            rt = &object_probe.runtime[index];
+
+            if (!(mask & (1UL << index)) || rt->lazy ||
+                rt->state != OBJECT_STATE_IDLE)
+            {
+                continue;
+            }
+
+            for (i = 0; i < object_probe.count; i++)
             {
-                return ret;
+                dep = &object_probe.runtime[i];
+
+                if (!(rt->depends & (1UL << i)) || dep->lazy ||
+                    dep->state == OBJECT_STATE_READY)
+                {
+                    continue;
+                }
+
+                break;
+            }
+
+            if (i < object_probe.count)
+            {
+                dep = &object_probe.runtime[i];
+
+                if (dep->state == OBJECT_STATE_IDLE)
+                {
+                    waiting++;
+                    continue;
+                }
+
+                rt->state = OBJECT_STATE_SKIPPED;
+                rt->ret = -ENODEV;
+                progress++;
+
+                pr_error("Object <%s> skipped, depends on <%s>.",
+                         object_get_by_index(index)->name,
+                         object_get_by_index(i)->name);
+                continue;
             }
+
+            rt->state = OBJECT_STATE_PROBING;
+
+            object_probe_one(index);
+
+            object_pm_restart(index);
+
+            progress++;
         }
     }
+    while (waiting && progress);
 
-    return 0;
+    for (index = 0; index < object_probe.count; index++)
+    {
+        rt = &object_probe.runtime[index];
+
+        if (!(mask & (1UL << index)) || rt->lazy)
+        {
+            continue;
+        }
+
+        if (rt->state == OBJECT_STATE_IDLE)
+        {
+            rt->state = OBJECT_STATE_SKIPPED;
+            rt->ret = -EDEADLK;
+
+            pr_error("Object <%s> skipped, dependency cycle.",
+                     object_get_by_index(index)->name);
+        }
+
+        if (rt->ret && !ret)
+        {
+            ret = rt->ret;
+        }
+    }
+
+    return ret;
 }
 
 /**
- * @brief   Execute all the object suspend functions.
+ * @brief   Get the time of the full boot, for the comparison with a warm
+ *          restart.
  *
- * @param   suspend_level Suspend level.
+ * @retval  Returns the time in us.
  *
- * @retval  Returns 0 on success, negative error code otherwise.
+ * @note    It is the time from main() to the startup completed with the boot
+ *          profiler, the object probe time only otherwise.
  */
-int32_t object_suspend(int32_t suspend_level)
+static uint32_t object_get_boot_us(void)
 {
-    uint32_t level;
-    int32_t ret;
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    const boot_profile_t* profile = boot_profile_get();
+    uint32_t boot_us = 0;
+    uint32_t i;
 
-    for (level = OBJECT_LEVELS_NUM - 2; level == 0; level -= 2)
+    for (i = 0; i < profile->count; i++)
     {
-        ret = object_do_one_suspendcall(level, suspend_level);
-        if (ret)
+        if (profile->entry[i].start_us + profile->entry[i].us > boot_us)
         {
-            return ret;
+            boot_us = profile->entry[i].start_us + profile->entry[i].us;
         }
     }
 
-    return 0;
+    return boot_us;
+#else
+    return object_probe.boot_cycles / (osKernelGetSysTimerFreq() / 1000000);
+#endif
 }
 
 /**
- * @brief   Execute all the object resume functions at a given level.
+ * @brief   Restart the objects without a reset.
  *
- * @param   level Object level.
- * @param   resume_level Resume level.
+ * @param   name Object name, NULL for all the middleware and services.
+ * @param   stats Returns the restart statistics, NULL if not needed.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The named object is restarted with the objects which depend on
+ *          it, directly or not. They are shut down in the reverse order of
+ *          the probe and probed again in the order of their dependencies.
+ *          The core and early driver objects are never restarted, so the
+ *          clocks and the debug console keep running. It must not be called
+ *          from a thread owned by a restarted object.
  */
-static int32_t object_do_one_resumecall(int32_t level, int32_t resume_level)
+int32_t object_restart(const char* const name, object_restart_stats_t* stats)
 {
-    const object* obj;
+    object_restart_stats_t result;
+    uint32_t cycles_per_us = osKernelGetSysTimerFreq() / 1000000;
+    uint32_t mask = 0;
+    uint32_t done;
+    uint32_t grown;
+    uint32_t start;
+    uint32_t index;
+    int32_t object_index;
     int32_t ret;
+    int32_t err;
+
+    if (!object_probe.lazy_mutex || xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
 
-    for (obj = object_levels[level]; obj < object_levels[level + 1];
-         obj++)
+    if (name)
     {
-        if (obj && obj->resume)
+        object_index = object_find_index(name);
+        if (object_index < 0)
         {
-            ret = obj->resume(obj, resume_level);
-            if (ret)
+            return object_index;
+        }
+
+        mask = 1UL << object_index;
+
+        /* Add the objects which depend on the restarted ones */
+        do
+        {
+            grown = 0;
+
+            for (index = 0; index < object_probe.count; index++)
+            {
+                if (!(mask & (1UL << index)) &&
+                    (object_probe.runtime[index].depends & mask))
+                {
+                    mask |= 1UL << index;
+                    grown = 1;
+                }
+            }
+        }
+        while (grown);
+    }
+    else
+    {
+        for (index = 0; index < object_probe.count; index++)
+        {
+            if (object_probe.runtime[index].level >= OBJECT_LEVEL_MIDDLEWARE)
             {
-                return ret;
+                mask |= 1UL << index;
             }
         }
     }
 
-    return 0;
+    for (index = 0; index < object_probe.count; index++)
+    {
+        if ((mask & (1UL << index)) &&
+            object_probe.runtime[index].level < OBJECT_LEVEL_MIDDLEWARE)
+        {
+            pr_error("Object <%s> is kept alive, it can not be restarted.",
+                     object_get_by_index(index)->name);
+            return -EPERM;
+        }
+    }
+
+    (void)memset(&result, 0, sizeof(result));
+
+    (void)osMutexAcquire(object_probe.lazy_mutex, osWaitForever);
+
+    start = osKernelGetSysTimerCount();
+    done = object_shutdown_mask(mask, &ret);
+    result.shutdown_us = (osKernelGetSysTimerCount() - start) / cycles_per_us;
+
+    start = osKernelGetSysTimerCount();
+    err = object_reprobe_mask(done);
+    result.probe_us = (osKernelGetSysTimerCount() - start) / cycles_per_us;
+
+    (void)osMutexRelease(object_probe.lazy_mutex);
+
+    for (index = 0; index < object_probe.count; index++)
+    {
+        result.count += (done & (1UL << index)) ? 1 : 0;
+    }
+
+    result.reset_us = object_get_boot_us();
+
+    pr_info("Restart %u objects took %u us, shutdown %u us, probe %u us, "
+            "full boot %u us.",
+            result.count,
+            result.shutdown_us + result.probe_us,
+            result.shutdown_us,
+            result.probe_us,
+            result.reset_us);
+
+    if (stats)
+    {
+        *stats = result;
+    }
+
+    return ret ? ret : err;
 }
 
 /**
- * @brief   Execute all the object resume functions.
+ * @brief   Get the object handle.
  *
- * @param   resume_level Resume level.
+ * @param   name Object name.
  *
- * @retval  Returns 0 on success, negative error code otherwise.
+ * @retval  Object handle for reference or NULL in case of error.
+ *
+ * @note    The name is looked up by binary search in the hash index, the
+ *          handle never changes, so the callers may cache it.
+ *          A lazy object is refused, a cached binding could outlive its idle
+ *          shutdown, its users hold it by object_get() and object_put().
+ */
+const object* object_get_binding(const char* const name)
+{
+    const object_index_entry_t* entry;
+
+    if (!name)
+    {
+        return NULL;
+    }
+
+    entry = object_index_find(name);
+    if (!entry || !entry->obj->object_intf)
+    {
+        return NULL;
+    }
+
+    if (object_probe.runtime[entry->index].lazy)
+    {
+        return NULL;
+    }
+
+    return entry->obj;
+}
+
+/**
+ * @brief   Get the interface of the object.
+ *
+ * @param   name Object name.
+ *
+ * @retval  Object interface for reference or NULL in case of error.
+ *
+ * @note    Use object_get_typed_intf() to get it with the type checked by
+ *          the caller, see object.h.
+ */
+const void* object_get_intf(const char* const name)
+{
+    const object* obj = object_get_binding(name);
+
+    return obj ? obj->object_intf : NULL;
+}
+
+/**
+ * @brief   Get the number of objects.
+ *
+ * @retval  Returns the number of objects.
+ *
+ * @note    The objects beyond OBJECT_MAX_NUM are not counted, they are never
+ *          probed and object_init() reports them.
  */
-int32_t object_resume(int32_t resume_level)
+uint32_t object_get_count(void)
 {
     uint32_t level;
-    int32_t ret;
+    uint32_t count = 0;
 
     for (level = 0; level < OBJECT_LEVELS_NUM; level += 2)
     {
-        ret = object_do_one_resumecall(level, resume_level);
-        if (ret)
-        {
-            return ret;
-        }
+        count += object_levels[level + 1] - object_levels[level];
     }
 
-    return 0;
+    return (count > OBJECT_MAX_NUM) ? OBJECT_MAX_NUM : count;
 }
 
 /**
- * @brief   Get the object handle.
+ * @brief   Get the object handle by index, the objects are indexed in probe
+ *          level order.
  *
- * @param   name Object name.
+ * @param   index Object index.
  *
  * @retval  Object handle for reference or NULL in case of error.
  */
-const object* object_get_binding(const char* const name)
+const object* object_get_by_index(uint32_t index)
 {
     uint32_t level;
-    const object* obj;
-    const object* start;
-    const object* end;
+    uint32_t count;
 
     for (level = 0; level < OBJECT_LEVELS_NUM; level += 2)
     {
-        start = object_levels[level];
-        end = object_levels[level + 1];
-
-        for (obj = start; obj < end; obj++)
+        count = object_levels[level + 1] - object_levels[level];
+        if (index < count)
         {
-            if (obj && obj->object_intf && !strcmp(name, obj->name))
-            {
-                return obj;
-            }
+            return &object_levels[level][index];
         }
+
+        index -= count;
     }
 
     return NULL;
 }
+
+/**
+ * @brief   Get the runtime state of the object recorded by object_init().
+ *
+ * @param   index Object index.
+ *
+ * @retval  Runtime state for reference or NULL in case of error.
+ */
+const object_runtime_t* object_get_runtime(uint32_t index)
+{
+    if (index >= object_probe.count)
+    {
+        return NULL;
+    }
+
+    return &object_probe.runtime[index];
+}
+
+/**
+ * @brief   Get the object index.
+ *
+ * @param   name Object name.
+ *
+ * @retval  Returns the object index, negative error code otherwise.
+ */
+int32_t object_get_index(const char* const name)
+{
+    if (!name)
+    {
+        return -EINVAL;
+    }
+
+    return object_find_index(name);
+}
+
+/**
+ * @brief   Hold the object, a lazy object is probed on the first hold.
+ *
+ * @param   name Object name.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    A held lazy object is never shut down for idle, its idle time
+ *          starts when the last holder calls object_put().
+ */
+int32_t object_get(const char* const name)
+{
+    int32_t index;
+
+    if (!name)
+    {
+        return -EINVAL;
+    }
+
+    index = object_find_index(name);
+    if (index < 0)
+    {
+        return index;
+    }
+
+    return object_lazy_use((uint32_t)index, 1);
+}
+
+/**
+ * @brief   Release the object held by object_get().
+ *
+ * @param   name Object name.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t object_put(const char* const name)
+{
+    object_runtime_t* rt;
+    int32_t index;
+    int32_t ret = 0;
+
+    if (!name)
+    {
+        return -EINVAL;
+    }
+
+    index = object_find_index(name);
+    if (index < 0)
+    {
+        return index;
+    }
+
+    rt = &object_probe.runtime[index];
+
+    if (!rt->lazy)
+    {
+        return 0;
+    }
+
+    if (!object_probe.lazy_mutex || xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
+
+    if (osMutexAcquire(object_probe.lazy_mutex, osWaitForever) != osOK)
+    {
+        return -EPERM;
+    }
+
+    if (rt->users)
+    {
+        rt->users--;
+        rt->last_use = osKernelGetTickCount();
+    }
+    else
+    {
+        ret = -EINVAL;
+    }
+
+    (void)osMutexRelease(object_probe.lazy_mutex);
+
+    return ret;
+}
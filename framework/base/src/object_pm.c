@@ -0,0 +1,819 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "cmsis_os.h"
+#include "framework.h"
+
+extern object_pm_desc_t object_pm$$Base[];
+extern object_pm_desc_t object_pm$$Limit[];
+
+#define OBJECT_PM_TIMER_KEY SERVICE_TIMER_KEY(MSG_ID_SYS_BASE, 2)
+
+/**
+ * @brief   Power management handle definition.
+ */
+typedef struct
+{
+    osMutexId_t             mutex;
+    uint32_t                deep;       /* Set during a deep sleep */
+    object_pm_sleep_stats_t sleep;
+    object_pm_t             pm[OBJECT_MAX_NUM];
+} object_pm_handle_t;
+
+static object_pm_handle_t object_pm_handle;
+
+static StaticSemaphore_t object_pm_mutex_cb;
+
+/**
+ * @brief   Attributes structure for the power management mutex, a hook may
+ *          get another object, so it is recursive.
+ */
+const osMutexAttr_t object_pm_mutex_attr =
+{
+    .name       = CONFIG_OBJECT_PM_MUTEX_NAME,
+    .attr_bits  = osMutexRecursive | osMutexPrioInherit,
+    .cb_mem     = &object_pm_mutex_cb,
+    .cb_size    = sizeof(object_pm_mutex_cb),
+};
+
+/**
+ * @brief   Reset the power management state, the object is active.
+ *
+ * @param   pm Pointer to the power management state.
+ *
+ * @retval  None.
+ */
+void object_pm_reset(object_pm_t* pm)
+{
+    (void)memset(pm, 0, sizeof(object_pm_t));
+
+    pm->state = OBJECT_PM_STATE_ACTIVE;
+}
+
+/**
+ * @brief   Suspend the active object.
+ *
+ * @param   obj Pointer to the object.
+ * @param   pm Pointer to the power management state of the object.
+ * @param   level Suspend level.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The object stays active if its hook fails.
+ */
+int32_t object_pm_suspend_one(const object* obj, object_pm_t* pm, int32_t level)
+{
+    uint32_t start;
+    uint32_t cycles;
+    int32_t ret;
+
+    if (pm->state == OBJECT_PM_STATE_SUSPENDED)
+    {
+        return 0;
+    }
+
+    if (pm->state != OBJECT_PM_STATE_ACTIVE)
+    {
+        return -EBUSY;
+    }
+
+    pm->state = OBJECT_PM_STATE_SUSPENDING;
+
+    start = osKernelGetSysTimerCount();
+    ret = obj->suspend ? obj->suspend(obj, level) : 0;
+    cycles = osKernelGetSysTimerCount() - start;
+
+    if (ret)
+    {
+        pm->state = OBJECT_PM_STATE_ACTIVE;
+        pm->error_count++;
+
+        return ret;
+    }
+
+    pm->state = OBJECT_PM_STATE_SUSPENDED;
+    pm->suspend_count++;
+    pm->suspend_cycles = cycles;
+    if (cycles > pm->suspend_max_cycles)
+    {
+        pm->suspend_max_cycles = cycles;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Resume the suspended object.
+ *
+ * @param   obj Pointer to the object.
+ * @param   pm Pointer to the power management state of the object.
+ * @param   level Resume level, the same as the suspend one.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The object is in error if its hook fails, it is not in a known
+ *          state any more.
+ */
+int32_t object_pm_resume_one(const object* obj, object_pm_t* pm, int32_t level)
+{
+    uint32_t start;
+    uint32_t cycles;
+    int32_t ret;
+
+    if (pm->state == OBJECT_PM_STATE_ACTIVE)
+    {
+        return 0;
+    }
+
+    if (pm->state != OBJECT_PM_STATE_SUSPENDED)
+    {
+        return (pm->state == OBJECT_PM_STATE_ERROR) ? -EIO : -EBUSY;
+    }
+
+    pm->state = OBJECT_PM_STATE_RESUMING;
+
+    start = osKernelGetSysTimerCount();
+    ret = obj->resume ? obj->resume(obj, level) : 0;
+    cycles = osKernelGetSysTimerCount() - start;
+
+    if (ret)
+    {
+        pm->state = OBJECT_PM_STATE_ERROR;
+        pm->error_count++;
+
+        return ret;
+    }
+
+    pm->state = OBJECT_PM_STATE_ACTIVE;
+    pm->resume_count++;
+    pm->resume_cycles = cycles;
+    if (cycles > pm->resume_max_cycles)
+    {
+        pm->resume_max_cycles = cycles;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Take a user of the object, resume it if runtime suspended.
+ *
+ * @param   obj Pointer to the object.
+ * @param   pm Pointer to the power management state of the object.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t object_pm_runtime_get(const object* obj, object_pm_t* pm)
+{
+    int32_t ret;
+
+    if (pm->system)
+    {
+        return -EBUSY;
+    }
+
+    ret = object_pm_resume_one(obj, pm, OBJECT_PM_LEVEL_RUNTIME);
+    if (ret)
+    {
+        return ret;
+    }
+
+    pm->usage++;
+
+    return 0;
+}
+
+/**
+ * @brief   Release a user of the object, the last user starts the
+ *          autosuspend delay, or suspends it at once without a delay.
+ *
+ * @param   obj Pointer to the object.
+ * @param   pm Pointer to the power management state of the object.
+ * @param   now_ms Current time in ms.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t object_pm_runtime_put(const object*  obj,
+                              object_pm_t*   pm,
+                              uint32_t       now_ms)
+{
+    if (!pm->usage)
+    {
+        return -EINVAL;
+    }
+
+    pm->usage--;
+    pm->last_busy = now_ms;
+
+    if (!pm->usage && !pm->autosuspend_ms)
+    {
+        return object_pm_suspend_one(obj, pm, OBJECT_PM_LEVEL_RUNTIME);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Suspend the object if it has no user for its autosuspend delay.
+ *
+ * @param   obj Pointer to the object.
+ * @param   pm Pointer to the power management state of the object.
+ * @param   now_ms Current time in ms.
+ *
+ * @retval  Returns 0 if suspended, -EBUSY if it has to stay active, other
+ *          negative error code if the suspend failed.
+ */
+int32_t object_pm_runtime_idle(const object* obj,
+                               object_pm_t*  pm,
+                               uint32_t      now_ms)
+{
+    if (!pm->runtime || pm->usage || pm->state != OBJECT_PM_STATE_ACTIVE ||
+        now_ms - pm->last_busy < pm->autosuspend_ms)
+    {
+        return -EBUSY;
+    }
+
+    return object_pm_suspend_one(obj, pm, OBJECT_PM_LEVEL_RUNTIME);
+}
+
+/**
+ * @brief   Get the current time in ms.
+ *
+ * @retval  Returns the time in ms.
+ */
+static inline uint32_t object_pm_now_ms(void)
+{
+    return (uint32_t)((uint64_t)osKernelGetTickCount() * 1000 /
+                      osKernelGetTickFreq());
+}
+
+/**
+ * @brief   Check if the object is probed, only those are power managed.
+ *
+ * @param   index Object index.
+ *
+ * @retval  Returns 1 if probed, 0 otherwise.
+ */
+static inline uint32_t object_pm_is_ready(uint32_t index)
+{
+    const object_runtime_t* rt = object_get_runtime(index);
+
+    return (rt && rt->state == OBJECT_STATE_READY) ? 1 : 0;
+}
+
+/**
+ * @brief   Suspend the runtime managed objects which stayed idle long enough.
+ *
+ * @param   key Timer key.
+ * @param   user_ctx None.
+ *
+ * @retval  None.
+ *
+ * @note    It runs on the timer thread, so it never waits for the mutex, a
+ *          busy object is checked again on the next period.
+ */
+static void object_pm_autosuspend(uint32_t key, const void* user_ctx)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+    uint32_t now = object_pm_now_ms();
+    uint32_t index;
+    int32_t ret;
+
+    (void)key;
+    (void)user_ctx;
+
+    if (osMutexAcquire(handle->mutex, 0) != osOK)
+    {
+        return;
+    }
+
+    for (index = 0; index < object_get_count(); index++)
+    {
+        if (!object_pm_is_ready(index))
+        {
+            continue;
+        }
+
+        ret = object_pm_runtime_idle(object_get_by_index(index),
+                                     &handle->pm[index],
+                                     now);
+        if (ret && ret != -EBUSY)
+        {
+            pr_error("Object <%s> autosuspend failed, ret %d.",
+                     object_get_by_index(index)->name,
+                     ret);
+        }
+    }
+
+    (void)osMutexRelease(handle->mutex);
+}
+
+/**
+ * @brief   Start the power management after the objects are probed.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    Every probed object starts active, a runtime managed one is
+ *          suspended after its autosuspend delay unless it is used.
+ */
+int32_t object_pm_start(void)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+    const object_pm_desc_t* desc;
+    const object* obj;
+    uint32_t runtime = 0;
+    uint32_t index;
+    int32_t object_index;
+    int32_t ret;
+
+    if (!handle->mutex)
+    {
+        handle->mutex = osMutexNew(&object_pm_mutex_attr);
+        if (!handle->mutex)
+        {
+            pr_error("Create mutex <%s> failed.", object_pm_mutex_attr.name);
+            return -ENOMEM;
+        }
+    }
+
+    (void)osMutexAcquire(handle->mutex, osWaitForever);
+
+    for (index = 0; index < OBJECT_MAX_NUM; index++)
+    {
+        object_pm_reset(&handle->pm[index]);
+    }
+
+    for (desc = object_pm$$Base; desc < object_pm$$Limit; desc++)
+    {
+        object_index = object_get_index(desc->name);
+        if (object_index < 0)
+        {
+            pr_warning("Power managed object <%s> not found.", desc->name);
+            continue;
+        }
+
+        obj = object_get_by_index((uint32_t)object_index);
+        if (!obj->suspend || !obj->resume)
+        {
+            pr_warning("Power managed object <%s> has no suspend or resume.",
+                       obj->name);
+        }
+
+        handle->pm[object_index].runtime = 1;
+        handle->pm[object_index].autosuspend_ms = desc->autosuspend_ms;
+        handle->pm[object_index].last_busy = object_pm_now_ms();
+
+        runtime++;
+    }
+
+    (void)osMutexRelease(handle->mutex);
+
+    if (!runtime)
+    {
+        return 0;
+    }
+
+    ret = service_timer_start(OBJECT_PM_TIMER_KEY,
+                              CONFIG_OBJECT_PM_CHECK_PERIOD_MS,
+                              CONFIG_OBJECT_PM_CHECK_PERIOD_MS,
+                              object_pm_autosuspend,
+                              NULL);
+    if (ret)
+    {
+        pr_error("Start object autosuspend failed, ret %d.", ret);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief   Reset the power state of the object probed again by a warm
+ *          restart, its users went away with its shutdown.
+ *
+ * @param   index Object index.
+ *
+ * @retval  None.
+ */
+void object_pm_restart(uint32_t index)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+    object_pm_t* pm;
+    uint32_t runtime;
+    uint32_t autosuspend_ms;
+
+    if (index >= OBJECT_MAX_NUM || !handle->mutex)
+    {
+        return;
+    }
+
+    (void)osMutexAcquire(handle->mutex, osWaitForever);
+
+    pm = &handle->pm[index];
+    runtime = pm->runtime;
+    autosuspend_ms = pm->autosuspend_ms;
+
+    object_pm_reset(pm);
+
+    pm->runtime = runtime;
+    pm->autosuspend_ms = autosuspend_ms;
+    pm->last_busy = object_pm_now_ms();
+
+    (void)osMutexRelease(handle->mutex);
+}
+
+/**
+ * @brief   Hold the object active, it is resumed if runtime suspended.
+ *
+ * @param   name Object name.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    An object without DECLARE_OBJECT_PM is always active, it only
+ *          has to be probed.
+ */
+int32_t object_pm_get(const char* const name)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+    int32_t index;
+    int32_t ret;
+
+    if (!name)
+    {
+        return -EINVAL;
+    }
+
+    index = object_get_index(name);
+    if (index < 0)
+    {
+        return index;
+    }
+
+    if (!object_pm_is_ready((uint32_t)index))
+    {
+        return -ENODEV;
+    }
+
+    if (!handle->pm[index].runtime)
+    {
+        return 0;
+    }
+
+    if (!handle->mutex || xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
+
+    if (osMutexAcquire(handle->mutex, osWaitForever) != osOK)
+    {
+        return -EPERM;
+    }
+
+    ret = object_pm_runtime_get(object_get_by_index((uint32_t)index),
+                                &handle->pm[index]);
+
+    (void)osMutexRelease(handle->mutex);
+
+    return ret;
+}
+
+/**
+ * @brief   Release the object held by object_pm_get().
+ *
+ * @param   name Object name.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t object_pm_put(const char* const name)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+    int32_t index;
+    int32_t ret;
+
+    if (!name)
+    {
+        return -EINVAL;
+    }
+
+    index = object_get_index(name);
+    if (index < 0)
+    {
+        return index;
+    }
+
+    if (!handle->pm[index].runtime)
+    {
+        return 0;
+    }
+
+    if (!handle->mutex || xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
+
+    if (osMutexAcquire(handle->mutex, osWaitForever) != osOK)
+    {
+        return -EPERM;
+    }
+
+    ret = object_pm_runtime_put(object_get_by_index((uint32_t)index),
+                                &handle->pm[index],
+                                object_pm_now_ms());
+
+    (void)osMutexRelease(handle->mutex);
+
+    return ret;
+}
+
+/**
+ * @brief   Suspend the system, the objects are suspended in the reverse
+ *          order of their probe.
+ *
+ * @param   suspend_level Suspend level.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The runtime suspended objects are left as they are. If an object
+ *          fails to suspend, the ones already suspended are resumed and the
+ *          system stays active.
+ */
+int32_t object_suspend(int32_t suspend_level)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+    object_pm_t* pm;
+    uint32_t index;
+    uint32_t i;
+    int32_t ret = 0;
+
+    if (!handle->mutex || xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
+
+    if (osMutexAcquire(handle->mutex, osWaitForever) != osOK)
+    {
+        return -EPERM;
+    }
+
+    for (index = object_get_count(); index > 0; index--)
+    {
+        pm = &handle->pm[index - 1];
+
+        if (!object_pm_is_ready(index - 1) || pm->system ||
+            pm->state == OBJECT_PM_STATE_SUSPENDED)
+        {
+            continue;
+        }
+
+        ret = object_pm_suspend_one(object_get_by_index(index - 1),
+                                    pm,
+                                    suspend_level);
+        if (ret)
+        {
+            pr_error("Object <%s> suspend failed, ret %d.",
+                     object_get_by_index(index - 1)->name,
+                     ret);
+            break;
+        }
+
+        pm->system = 1;
+    }
+
+    if (ret)
+    {
+        for (i = index; i < object_get_count(); i++)
+        {
+            pm = &handle->pm[i];
+
+            if (pm->system)
+            {
+                (void)object_pm_resume_one(object_get_by_index(i),
+                                           pm,
+                                           suspend_level);
+                pm->system = 0;
+            }
+        }
+    }
+
+    (void)osMutexRelease(handle->mutex);
+
+    return ret;
+}
+
+/**
+ * @brief   Resume the system, the objects are resumed in the order of their
+ *          probe.
+ *
+ * @param   resume_level Resume level, the same as the suspend one.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    Only the objects suspended by object_suspend() are resumed, the
+ *          runtime suspended ones wait for their next user. A failed object
+ *          does not stop the others from resuming.
+ */
+int32_t object_resume(int32_t resume_level)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+    object_pm_t* pm;
+    uint32_t index;
+    int32_t ret = 0;
+    int32_t err;
+
+    if (!handle->mutex || xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
+
+    if (osMutexAcquire(handle->mutex, osWaitForever) != osOK)
+    {
+        return -EPERM;
+    }
+
+    for (index = 0; index < object_get_count(); index++)
+    {
+        pm = &handle->pm[index];
+
+        if (!pm->system)
+        {
+            continue;
+        }
+
+        pm->system = 0;
+
+        err = object_pm_resume_one(object_get_by_index(index),
+                                   pm,
+                                   resume_level);
+        if (err)
+        {
+            pr_error("Object <%s> resume failed, ret %d.",
+                     object_get_by_index(index)->name,
+                     err);
+
+            ret = ret ? ret : err;
+        }
+    }
+
+    (void)osMutexRelease(handle->mutex);
+
+    return ret;
+}
+
+/**
+ * @brief   Get the power management state of the object.
+ *
+ * @param   index Object index.
+ *
+ * @retval  Power management state for reference or NULL in case of error.
+ */
+const object_pm_t* object_pm_get_by_index(uint32_t index)
+{
+    if (index >= object_get_count())
+    {
+        return NULL;
+    }
+
+    return &object_pm_handle.pm[index];
+}
+
+/**
+ * @brief   Get the idle sleep statistics.
+ *
+ * @retval  Sleep statistics for reference.
+ */
+const object_pm_sleep_stats_t* object_pm_get_sleep_stats(void)
+{
+    return &object_pm_handle.sleep;
+}
+
+/**
+ * @brief   Convert the power state to string.
+ *
+ * @param   state Power state.
+ *
+ * @retval  Returns the state name.
+ */
+const char* object_pm_state_to_str(uint32_t state)
+{
+    static const char* const state_str[OBJECT_PM_STATE_NUM] =
+    {
+        "active", "suspending", "suspended", "resuming", "error",
+    };
+
+    return (state < OBJECT_PM_STATE_NUM) ? state_str[state] : "unknown";
+}
+
+/**
+ * @brief   Tickless idle hook before the core sleeps.
+ *
+ * @param   idle_ticks Expected idle ticks, set it to 0 to skip the sleep.
+ *
+ * @retval  None.
+ *
+ * @note    It runs with the interrupts masked, the sleep is deep when every
+ *          runtime managed object is suspended. The hooks are only called
+ *          if CONFIG_OBJECT_PM_TICKLESS_IDLE_ENABLE is defined, which needs
+ *          the board to override object_pm_sleep_prepare().
+ */
+void object_pm_sleep_enter(uint32_t* idle_ticks)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+    uint32_t deep = 1;
+    uint32_t index;
+
+    for (index = 0; index < object_get_count(); index++)
+    {
+        if (handle->pm[index].runtime && object_pm_is_ready(index) &&
+            handle->pm[index].state != OBJECT_PM_STATE_SUSPENDED)
+        {
+            deep = 0;
+            break;
+        }
+    }
+
+    handle->deep = deep;
+    handle->sleep.sleep_count++;
+    handle->sleep.deep_count += deep;
+
+    object_pm_sleep_prepare(deep);
+}
+
+/**
+ * @brief   Tickless idle hook after the core wakes up.
+ *
+ * @param   idle_ticks Expected idle ticks.
+ *
+ * @retval  None.
+ */
+void object_pm_sleep_exit(uint32_t idle_ticks)
+{
+    object_pm_handle_t* handle = &object_pm_handle;
+
+    (void)idle_ticks;
+
+    object_pm_sleep_finish(handle->deep);
+}
+
+/**
+ * @brief   Account the ticks slept, see traceINCREASE_TICK_COUNT.
+ *
+ * @param   ticks Ticks the kernel steps over after the sleep.
+ *
+ * @retval  None.
+ *
+ * @note    An early wake-up sleeps fewer ticks than the expected idle ticks,
+ *          so only the stepped ticks are counted.
+ */
+void object_pm_sleep_account(uint32_t ticks)
+{
+    object_pm_handle.sleep.sleep_ticks += ticks;
+}
+
+/**
+ * @brief   Prepare the board for the idle sleep.
+ *
+ * @param   deep Set if every runtime managed object is suspended.
+ *
+ * @retval  None.
+ */
+__weak void object_pm_sleep_prepare(uint32_t deep)
+{
+    /**
+     * This function should not be modified, when the callback is needed,
+     * please override it on product layer.
+     */
+    (void)deep;
+}
+
+/**
+ * @brief   Restore the board after the idle sleep.
+ *
+ * @param   deep Set if the sleep was prepared as a deep one.
+ *
+ * @retval  None.
+ */
+__weak void object_pm_sleep_finish(uint32_t deep)
+{
+    /**
+     * This function should not be modified, when the callback is needed,
+     * please override it on product layer.
+     */
+    (void)deep;
+}
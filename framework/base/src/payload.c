@@ -0,0 +1,322 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "framework.h"
+
+/**
+ * @brief   Payload block definition, the data follows the header.
+ */
+struct _payload_t
+{
+    uint32_t    ref_count;
+    uint32_t    size;
+    uint32_t    data[];
+};
+
+/**
+ * @brief   Payload pool handle definition.
+ */
+typedef struct
+{
+    osMemoryPoolId_t    pool_id;
+    payload_stats_t     stats;
+} payload_handle_t;
+
+static payload_handle_t payload_handle;
+
+/**
+ * @brief   Attributes structure for payload pool.
+ */
+const osMemoryPoolAttr_t payload_pool_attr =
+{
+    .name       = CONFIG_MSG_PAYLOAD_POOL_NAME,
+    .attr_bits  = 0,
+    .cb_mem     = NULL,
+    .cb_size    = 0,
+    .mp_mem     = NULL,
+    .mp_size    = 0,
+};
+
+/**
+ * @brief   Enter the critical section from thread or interrupt.
+ *
+ * @retval  Returns the interrupt mask to restore.
+ */
+static inline uint32_t payload_lock(void)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        return taskENTER_CRITICAL_FROM_ISR();
+    }
+
+    taskENTER_CRITICAL();
+
+    return 0;
+}
+
+/**
+ * @brief   Exit the critical section from thread or interrupt.
+ *
+ * @param   isrm The interrupt mask returned by payload_lock().
+ *
+ * @retval  None.
+ */
+static inline void payload_unlock(uint32_t isrm)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        taskEXIT_CRITICAL_FROM_ISR(isrm);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief   Allocate a payload block, the reference count starts from 1.
+ *
+ * @param   size Payload size in bytes.
+ *
+ * @retval  Payload handle for reference or NULL in case of error.
+ *
+ * @note    It never blocks, so it can be called from interrupt.
+ */
+payload_t* payload_alloc(uint32_t size)
+{
+    payload_t* payload;
+    uint32_t isrm;
+
+    if (size > CONFIG_MSG_PAYLOAD_BLOCK_SIZE)
+    {
+        payload_handle.stats.oversize_count++;
+        return NULL;
+    }
+
+    if (!payload_handle.pool_id)
+    {
+        return NULL;
+    }
+
+    payload = osMemoryPoolAlloc(payload_handle.pool_id, 0);
+
+    isrm = payload_lock();
+
+    if (!payload)
+    {
+        payload_handle.stats.fail_count++;
+    }
+    else
+    {
+        payload_handle.stats.alloc_count++;
+        payload_handle.stats.in_use++;
+
+        if (payload_handle.stats.in_use > payload_handle.stats.in_use_max)
+        {
+            payload_handle.stats.in_use_max = payload_handle.stats.in_use;
+        }
+    }
+
+    payload_unlock(isrm);
+
+    if (payload)
+    {
+        payload->ref_count = 1;
+        payload->size = size;
+    }
+
+    return payload;
+}
+
+/**
+ * @brief   Take a new reference to the payload.
+ *
+ * @param   payload Pointer to the payload handle.
+ *
+ * @retval  Returns the payload handle.
+ */
+payload_t* payload_hold(payload_t* payload)
+{
+    uint32_t isrm;
+
+    if (payload)
+    {
+        isrm = payload_lock();
+        payload->ref_count++;
+        payload_unlock(isrm);
+    }
+
+    return payload;
+}
+
+/**
+ * @brief   Drop a reference to the payload, the last one frees the block.
+ *
+ * @param   payload Pointer to the payload handle.
+ *
+ * @retval  None.
+ */
+void payload_release(payload_t* payload)
+{
+    uint32_t ref_count;
+    uint32_t isrm;
+    osStatus_t stat;
+
+    if (!payload)
+    {
+        return;
+    }
+
+    isrm = payload_lock();
+
+    ref_count = --payload->ref_count;
+    if (!ref_count)
+    {
+        payload_handle.stats.free_count++;
+        payload_handle.stats.in_use--;
+    }
+
+    payload_unlock(isrm);
+
+    if (!ref_count)
+    {
+        stat = osMemoryPoolFree(payload_handle.pool_id, payload);
+        if (stat != osOK)
+        {
+            pr_error("Free payload 0x%x failed, stat %d.", payload, stat);
+        }
+    }
+}
+
+/**
+ * @brief   Get the payload data.
+ *
+ * @param   payload Pointer to the payload handle.
+ *
+ * @retval  Returns the payload data.
+ */
+void* payload_get_data(const payload_t* payload)
+{
+    return (void*)payload->data;
+}
+
+/**
+ * @brief   Get the payload size.
+ *
+ * @param   payload Pointer to the payload handle.
+ *
+ * @retval  Returns the payload size in bytes.
+ */
+uint32_t payload_get_size(const payload_t* payload)
+{
+    return payload->size;
+}
+
+/**
+ * @brief   Get the maximum payload size of one block.
+ *
+ * @retval  Returns the block size in bytes.
+ */
+uint32_t payload_get_capacity(void)
+{
+    return CONFIG_MSG_PAYLOAD_BLOCK_SIZE;
+}
+
+/**
+ * @brief   Get the payload pool statistics.
+ *
+ * @retval  Returns the payload pool statistics.
+ */
+const payload_stats_t* payload_get_stats(void)
+{
+    return &payload_handle.stats;
+}
+
+/**
+ * @brief   Probe the payload pool.
+ *
+ * @param   obj Pointer to the payload pool object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t payload_probe(const object* obj)
+{
+    payload_handle_t* handle = (payload_handle_t*)obj->object_data;
+
+    (void)memset(handle, 0, sizeof(payload_handle_t));
+
+    handle->pool_id = osMemoryPoolNew(CONFIG_MSG_PAYLOAD_BLOCK_COUNT,
+                                      sizeof(payload_t) +
+                                      CONFIG_MSG_PAYLOAD_BLOCK_SIZE,
+                                      &payload_pool_attr);
+    if (!handle->pool_id)
+    {
+        pr_error("Object <%s> create memory pool <%s> failed.",
+                 obj->name,
+                 payload_pool_attr.name);
+        return -ENOMEM;
+    }
+
+    pr_info("Object <%s> probe succeed.", obj->name);
+
+    return 0;
+}
+
+/**
+ * @brief   Remove the payload pool.
+ *
+ * @param   obj Pointer to the payload pool object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t payload_shutdown(const object* obj)
+{
+    payload_handle_t* handle = (payload_handle_t*)obj->object_data;
+    osStatus_t stat;
+
+    if (handle->stats.in_use)
+    {
+        pr_error("Object <%s> still has %d payloads in use.",
+                 obj->name,
+                 handle->stats.in_use);
+        return -EBUSY;
+    }
+
+    stat = osMemoryPoolDelete(handle->pool_id);
+    if (stat != osOK)
+    {
+        pr_error("Object <%s> delete memory pool failed, stat %d.",
+                 obj->name,
+                 stat);
+        return -EIO;
+    }
+
+    handle->pool_id = NULL;
+
+    pr_info("Object <%s> shutdown succeed.", obj->name);
+
+    return 0;
+}
+
+module_core(CONFIG_MSG_PAYLOAD_NAME,
+            CONFIG_MSG_PAYLOAD_LABEL,
+            payload_probe,
+            payload_shutdown,
+            NULL, &payload_handle, NULL);
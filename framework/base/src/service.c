@@ -20,383 +20,2348 @@
 #include "cmsis_os.h"
 #include "framework.h"
 
+extern service_t module_service$$Base[];
+extern service_t module_service$$Limit[];
+
+/**
+ * @brief   Broadcast statistics.
+ */
+static service_broadcast_stats_t service_broadcast_stats;
+
+/**
+ * @brief   Worker pool shared by the SERVICE_BACKEND_POOL services.
+ */
+typedef struct
+{
+    osMessageQueueId_t  ready_id;
+    osThreadId_t        worker_id[CONFIG_SERVICE_POOL_WORKER_NUM];
+} service_pool_t;
+
+static service_pool_t service_pool;
+
+/**
+ * @brief   Static memory of the worker pool.
+ */
+static StaticTask_t service_pool_worker_cb[CONFIG_SERVICE_POOL_WORKER_NUM];
+static uint64_t service_pool_worker_stack[CONFIG_SERVICE_POOL_WORKER_NUM]
+    [CONFIG_SERVICE_POOL_THREAD_STACK_SIZE / 8];
+static StaticQueue_t service_pool_queue_cb;
+static service_t* service_pool_queue_mem[SERVICE_MAX_NUM];
+
+/**
+ * @brief   Attributes structure for the worker pool threads.
+ */
+const osThreadAttr_t service_pool_worker_attr =
+{
+    .name       = CONFIG_SERVICE_POOL_THREAD_NAME,
+    .attr_bits  = osThreadDetached,
+    .cb_mem     = NULL,
+    .cb_size    = sizeof(StaticTask_t),
+    .stack_mem  = NULL,
+    .stack_size = CONFIG_SERVICE_POOL_THREAD_STACK_SIZE,
+    .priority   = CONFIG_SERVICE_POOL_THREAD_PRIORITY,
+};
+
+/**
+ * @brief   Attributes structure for the worker pool ready queue.
+ */
+const osMessageQueueAttr_t service_pool_queue_attr =
+{
+    .name       = CONFIG_SERVICE_POOL_QUEUE_NAME,
+    .attr_bits  = 0,
+    .cb_mem     = &service_pool_queue_cb,
+    .cb_size    = sizeof(service_pool_queue_cb),
+    .mq_mem     = service_pool_queue_mem,
+    .mq_size    = sizeof(service_pool_queue_mem),
+};
+
+/**
+ * @brief   Enter the critical section from thread or interrupt.
+ *
+ * @retval  Returns the interrupt mask to restore.
+ */
+static inline uint32_t service_lock(void)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        return taskENTER_CRITICAL_FROM_ISR();
+    }
+
+    taskENTER_CRITICAL();
+
+    return 0;
+}
+
+/**
+ * @brief   Exit the critical section from thread or interrupt.
+ *
+ * @param   isrm The interrupt mask returned by service_lock().
+ *
+ * @retval  None.
+ */
+static inline void service_unlock(uint32_t isrm)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        taskEXIT_CRITICAL_FROM_ISR(isrm);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief   Convert milliseconds to kernel ticks.
+ *
+ * @param   millisec Time in milliseconds.
+ *
+ * @retval  Returns the kernel ticks.
+ */
+static inline uint32_t service_ms_to_ticks(uint32_t millisec)
+{
+    return millisec * osKernelGetTickFreq() / 1000;
+}
+
+/**
+ * @brief   Start using the queues of the service as a sender.
+ *
+ * @param   svc Pointer to the service handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    A stopping service takes no new sender, service_deinit() waits
+ *          for the senders inside before the queues are deleted.
+ */
+static int32_t service_enter(service_t* svc)
+{
+    uint32_t isrm;
+
+    isrm = service_lock();
+
+    if (svc->stopping)
+    {
+        service_unlock(isrm);
+        return -EPERM;
+    }
+
+    svc->users++;
+
+    service_unlock(isrm);
+
+    return 0;
+}
+
+/**
+ * @brief   Stop using the queues of the service as a sender.
+ *
+ * @param   svc Pointer to the service handle.
+ *
+ * @retval  None.
+ */
+static void service_leave(service_t* svc)
+{
+    uint32_t isrm;
+
+    isrm = service_lock();
+
+    svc->users--;
+
+    service_unlock(isrm);
+}
+
+/**
+ * @brief   Get the coalescing key of the message.
+ *
+ * @param   message Pointer to the message structure.
+ * @param   key_param Index of the parameter used as key.
+ *
+ * @retval  Returns the key.
+ */
+static inline uint32_t service_get_coalesce_key(const message_t*    message,
+                                                uint32_t            key_param)
+{
+    switch (key_param)
+    {
+    case 0:
+        return message->param0;
+    case 1:
+        return message->param1;
+    case 2:
+        return message->param2;
+    case 3:
+        return message->param3;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief   Find the coalescing entry of the message.
+ *
+ * @param   config Pointer to the configuration space.
+ * @param   id Message ID.
+ *
+ * @retval  Coalescing entry for reference or NULL if not coalesced.
+ */
+static const service_coalesce_t*
+service_find_coalesce(const service_config_t* const config, uint32_t id)
+{
+    uint32_t i;
+
+    for (i = 0; i < config->coalesce_count; i++)
+    {
+        if (config->coalesce[i].id == id)
+        {
+            return &config->coalesce[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief   Post the message into the mailbox of the service.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   coalesce Pointer to the coalescing entry of the message.
+ * @param   message Message structure to post, its payload is already held.
+ * @param   lane Message lane.
+ * @param   index Returns the slot index which needs a token.
+ * @param   seq Returns the sequence of the slot for the commit.
+ *
+ * @retval  Returns 0 if a pending message was replaced, 1 if a new slot was
+ *          taken and a token must be queued, 2 if an urgent message replaced
+ *          a normal one and an urgent token must be queued, negative error
+ *          code otherwise.
+ *
+ * @note    Only a slot whose token is queued takes replacements, so a slot
+ *          dropped by service_mailbox_commit() never held another message.
+ */
+static int32_t service_mailbox_post(service_t*                  svc,
+                                    const service_coalesce_t*   coalesce,
+                                    const message_t*            message,
+                                    service_lane_e              lane,
+                                    uint32_t*                   index,
+                                    uint32_t*                   seq)
+{
+    const service_config_t* config =
+        (const service_config_t*)svc->owner->object_config;
+    service_mailbox_slot_t* slot;
+    payload_t* stale;
+    uint32_t key = service_get_coalesce_key(message, coalesce->key_param);
+    uint32_t free_index = config->mailbox_count;
+    uint32_t promote;
+    uint32_t isrm;
+    uint32_t i;
+
+    isrm = service_lock();
+
+    for (i = 0; i < config->mailbox_count; i++)
+    {
+        slot = &config->mailbox[i];
+
+        if (!slot->pending)
+        {
+            if (free_index == config->mailbox_count)
+            {
+                free_index = i;
+            }
+            continue;
+        }
+
+        if (slot->queued && slot->message.id == message->id &&
+            service_get_coalesce_key(&slot->message,
+                                     coalesce->key_param) == key)
+        {
+            stale = slot->message.payload;
+            slot->message = *message;
+            svc->stats.coalesce_count++;
+
+            /* The urgent message must not wait behind the normal lane */
+            promote = (lane == SERVICE_LANE_URGENT &&
+                       slot->lane != SERVICE_LANE_URGENT);
+            if (promote)
+            {
+                slot->lane = lane;
+            }
+
+            *index = i;
+            *seq = slot->seq;
+
+            service_unlock(isrm);
+
+            payload_release(stale);
+
+            return promote ? 2 : 0;
+        }
+    }
+
+    if (free_index == config->mailbox_count)
+    {
+        service_unlock(isrm);
+        return -ENOSPC;
+    }
+
+    slot = &config->mailbox[free_index];
+    slot->message = *message;
+    slot->pending = 1;
+    slot->queued = 0;
+    slot->lane = lane;
+    slot->seq++;
+
+    *index = free_index;
+    *seq = slot->seq;
+
+    service_unlock(isrm);
+
+    return 1;
+}
+
+/**
+ * @brief   Finish the post of a mailbox slot once its token is queued or
+ *          failed.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   index Mailbox slot index.
+ * @param   seq Sequence of the slot returned by service_mailbox_post().
+ * @param   filled Set if the post took a new slot, clear if it promoted one.
+ * @param   ok Set if the token was queued.
+ *
+ * @retval  None.
+ *
+ * @note    A failed new slot is dropped, a failed promotion leaves the
+ *          message to the normal token. Nothing is done once the consumer
+ *          took the slot, it may already be reused.
+ */
+static void service_mailbox_commit(service_t*  svc,
+                                   uint32_t    index,
+                                   uint32_t    seq,
+                                   uint32_t    filled,
+                                   uint32_t    ok)
+{
+    const service_config_t* config =
+        (const service_config_t*)svc->owner->object_config;
+    service_mailbox_slot_t* slot = &config->mailbox[index];
+    payload_t* stale = NULL;
+    uint32_t isrm;
+
+    isrm = service_lock();
+
+    if (slot->pending && slot->seq == seq)
+    {
+        if (!filled)
+        {
+            if (!ok)
+            {
+                slot->lane = SERVICE_LANE_NORMAL;
+            }
+        }
+        else if (ok)
+        {
+            slot->queued = 1;
+        }
+        else
+        {
+            stale = slot->message.payload;
+            slot->pending = 0;
+        }
+    }
+
+    service_unlock(isrm);
+
+    payload_release(stale);
+}
+
+/**
+ * @brief   Take the pending message out of the mailbox slot.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   index Mailbox slot index.
+ * @param   message Returns the pending message, it owns the payload.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_mailbox_take(service_t*  svc,
+                                    uint32_t    index,
+                                    message_t*  message)
+{
+    const service_config_t* config =
+        (const service_config_t*)svc->owner->object_config;
+    service_mailbox_slot_t* slot;
+    uint32_t isrm;
+
+    if (index >= config->mailbox_count)
+    {
+        return -EINVAL;
+    }
+
+    slot = &config->mailbox[index];
+
+    isrm = service_lock();
+
+    if (!slot->pending)
+    {
+        service_unlock(isrm);
+        return -EEMPTY;
+    }
+
+    *message = slot->message;
+    slot->pending = 0;
+
+    service_unlock(isrm);
+
+    return 0;
+}
+
+/**
+ * @brief   Discard a message taken from the service queue.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   message Pointer to the message structure.
+ *
+ * @retval  None.
+ *
+ * @note    A mailbox token frees the slot it refers to.
+ */
+static void service_discard_message(service_t* svc, const message_t* message)
+{
+    message_t pending;
+
+    if (message->id == MSG_ID_SYS_MAILBOX)
+    {
+        if (!service_mailbox_take(svc, message->param0, &pending))
+        {
+            payload_release(pending.payload);
+        }
+        return;
+    }
+
+    payload_release(message->payload);
+}
+
+/**
+ * @brief   Get the free credits of the lane, the free space of its queue
+ *          which is not reserved.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   lane Message lane.
+ *
+ * @retval  Returns the number of free credits.
+ */
+static inline uint32_t service_get_free_credit(const service_t*    svc,
+                                               service_lane_e      lane)
+{
+    uint32_t space = osMessageQueueGetSpace(svc->queue_id[lane]);
+
+    return (space > svc->reserved[lane]) ? (space - svc->reserved[lane]) : 0;
+}
+
+/**
+ * @brief   Wake up the senders whose credits are available again.
+ *
+ * @param   svc Pointer to the service handle.
+ *
+ * @retval  None.
+ */
+static void service_notify_credit(service_t* svc)
+{
+    service_credit_waiter_t* waiter;
+    uint32_t isrm;
+
+    if (!svc->waiter)
+    {
+        return;
+    }
+
+    isrm = service_lock();
+
+    for (waiter = svc->waiter; waiter; waiter = waiter->next)
+    {
+        if (service_get_free_credit(svc, waiter->lane) >= waiter->count)
+        {
+            (void)osThreadFlagsSet(waiter->thread_id, SERVICE_FLAG_CREDIT);
+        }
+    }
+
+    service_unlock(isrm);
+}
+
+/**
+ * @brief   Give back the reserved credits of the lane.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   lane Message lane.
+ * @param   count Number of credits.
+ *
+ * @retval  None.
+ */
+static void service_put_credit(service_t*      svc,
+                               service_lane_e  lane,
+                               uint32_t        count)
+{
+    uint32_t isrm;
+
+    isrm = service_lock();
+
+    svc->reserved[lane] -= (count < svc->reserved[lane]) ?
+                           count : svc->reserved[lane];
+
+    service_unlock(isrm);
+
+    service_notify_credit(svc);
+}
+
+/**
+ * @brief   Take the credits of the lane without waiting.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   lane Message lane.
+ * @param   count Number of credits.
+ * @param   queued Message to queue with the credit, NULL to reserve the
+ *          credits instead.
+ * @param   credited Set if the message spends a credit reserved before.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    Every put into the queue goes through here, so the reserved space
+ *          is never taken by the other senders.
+ */
+static int32_t service_try_credit(service_t*       svc,
+                                  service_lane_e   lane,
+                                  uint32_t         count,
+                                  const message_t* queued,
+                                  uint32_t         credited)
+{
+    int32_t ret = -EFULL;
+    uint32_t isrm;
+
+    isrm = service_lock();
+
+    if (credited && svc->reserved[lane])
+    {
+        svc->reserved[lane]--;
+    }
+    else if (service_get_free_credit(svc, lane) < count)
+    {
+        service_unlock(isrm);
+        return -EFULL;
+    }
+
+    if (!queued)
+    {
+        svc->reserved[lane] += count;
+        ret = 0;
+    }
+    else if (osMessageQueuePut(svc->queue_id[lane], queued, 0, 0) == osOK)
+    {
+        ret = 0;
+    }
+
+    service_unlock(isrm);
+
+    return ret;
+}
+
+/**
+ * @brief   Replace the oldest message of the full lane with a new one.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   lane Message lane.
+ * @param   queued Message to queue.
+ * @param   oldest Returns the message taken out of the lane.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The oldest message is only taken when the freed slot is not
+ *          reserved, the take and the put are done under one lock, so no
+ *          other sender can steal the slot in between.
+ */
+static int32_t service_drop_credit(service_t*       svc,
+                                   service_lane_e   lane,
+                                   const message_t* queued,
+                                   message_t*       oldest)
+{
+    osMessageQueueId_t queue_id = svc->queue_id[lane];
+    int32_t ret = -EFULL;
+    uint32_t isrm;
+
+    isrm = service_lock();
+
+    if (osMessageQueueGetCount(queue_id) &&
+        osMessageQueueGetSpace(queue_id) + 1 > svc->reserved[lane] &&
+        osMessageQueueGet(queue_id, oldest, NULL, 0) == osOK)
+    {
+        ret = (osMessageQueuePut(queue_id, queued, 0, 0) == osOK) ?
+              0 : -EFULL;
+    }
+
+    service_unlock(isrm);
+
+    return ret;
+}
+
+/**
+ * @brief   Get the service whose own thread is the calling thread.
+ *
+ * @retval  Service handle for reference or NULL if none.
+ */
+static service_t* service_get_self(void)
+{
+    osThreadId_t thread_id = osThreadGetId();
+    service_t* svc;
+    uint32_t i;
+
+    for (i = 0; i < service_get_count(); i++)
+    {
+        svc = service_get_svc_by_index(i);
+        if (svc->thread_id && svc->thread_id == thread_id)
+        {
+            return svc;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief   Wake up the credit waits of a thread on all the services.
+ *
+ * @param   thread_id Thread ID.
+ *
+ * @retval  Returns the number of waits of the thread.
+ */
+static uint32_t service_wake_waits(osThreadId_t thread_id)
+{
+    const service_credit_waiter_t* waiter;
+    uint32_t count = 0;
+    uint32_t isrm;
+    uint32_t i;
+
+    isrm = service_lock();
+
+    for (i = 0; i < service_get_count(); i++)
+    {
+        for (waiter = service_get_svc_by_index(i)->waiter;
+             waiter;
+             waiter = waiter->next)
+        {
+            if (waiter->thread_id == thread_id)
+            {
+                (void)osThreadFlagsSet(waiter->thread_id,
+                                       SERVICE_FLAG_CREDIT);
+                count++;
+            }
+        }
+    }
+
+    service_unlock(isrm);
+
+    return count;
+}
+
+/**
+ * @brief   Take the credits of the lane, wait until they are available.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   lane Message lane.
+ * @param   count Number of credits.
+ * @param   queued Message to queue with the credit, NULL to reserve the
+ *          credits instead.
+ * @param   timeout Ticks to wait, osWaitForever to wait without limit.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The sender sleeps on SERVICE_FLAG_CREDIT, the service wakes it up
+ *          when it takes a message from the lane and enough credits are free.
+ *          The wait also ends when the service of the sender's own thread
+ *          stops, so its thread is never terminated in the middle.
+ */
+static int32_t service_wait_credit(service_t*       svc,
+                                   service_lane_e   lane,
+                                   uint32_t         count,
+                                   const message_t* queued,
+                                   uint32_t         timeout)
+{
+    service_credit_waiter_t waiter;
+    service_credit_waiter_t** pprev;
+    const service_t* self;
+    uint32_t start_tick;
+    uint32_t elapsed;
+    uint32_t isrm;
+    int32_t ret;
+
+    ret = service_try_credit(svc, lane, count, queued, 0);
+    if (!ret || !timeout)
+    {
+        return ret;
+    }
+
+    self = service_get_self();
+    if (self && self->stopping)
+    {
+        return -EPERM;
+    }
+
+    svc->stats.credit_wait_count++;
+
+    waiter.thread_id = osThreadGetId();
+    waiter.lane = lane;
+    waiter.count = count;
+
+    isrm = service_lock();
+
+    waiter.next = svc->waiter;
+    svc->waiter = &waiter;
+
+    service_unlock(isrm);
+
+    start_tick = osKernelGetTickCount();
+
+    while (1)
+    {
+        /* A wakeup after the clear is kept, so the check can not miss it */
+        (void)osThreadFlagsClear(SERVICE_FLAG_CREDIT);
+
+        /* service_deinit() wakes the waiters up to leave */
+        if (svc->stopping || (self && self->stopping))
+        {
+            ret = -EPERM;
+            break;
+        }
+
+        ret = service_try_credit(svc, lane, count, queued, 0);
+        if (!ret)
+        {
+            break;
+        }
+
+        elapsed = osKernelGetTickCount() - start_tick;
+        if (timeout != osWaitForever && elapsed >= timeout)
+        {
+            svc->stats.credit_fail_count++;
+            ret = -ETIMEDOUT;
+            break;
+        }
+
+        (void)osThreadFlagsWait(SERVICE_FLAG_CREDIT,
+                                osFlagsWaitAny,
+                                (timeout == osWaitForever) ?
+                                osWaitForever : (timeout - elapsed));
+    }
+
+    isrm = service_lock();
+
+    for (pprev = (service_credit_waiter_t**)&svc->waiter;
+         *pprev;
+         pprev = &(*pprev)->next)
+    {
+        if (*pprev == &waiter)
+        {
+            *pprev = waiter.next;
+            break;
+        }
+    }
+
+    service_unlock(isrm);
+
+    return ret;
+}
+
+/**
+ * @brief   Get the next message of the service, the urgent lane first.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   message Returns the message.
+ * @param   lane Returns the lane of the message.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_get_message(service_t*       svc,
+                                   message_t*       message,
+                                   service_lane_e*  lane)
+{
+    int32_t i;
+
+    for (i = SERVICE_LANE_NUM - 1; i >= 0; i--)
+    {
+        if (osMessageQueueGet(svc->queue_id[i], message, NULL, 0) == osOK)
+        {
+            *lane = (service_lane_e)i;
+
+            service_notify_credit(svc);
+
+            return 0;
+        }
+    }
+
+    return -EEMPTY;
+}
+
+/**
+ * @brief   Account the queue latency of the handled message.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   message Pointer to the handled message.
+ * @param   lane Lane of the message.
+ *
+ * @retval  None.
+ */
+static inline void service_account_latency(service_t*       svc,
+                                           const message_t* message,
+                                           service_lane_e   lane)
+{
+    service_lane_stats_t* stats = &svc->stats.lane[lane];
+    uint32_t latency = osKernelGetSysTimerCount() - message->timestamp;
+
+    stats->handle_count++;
+    stats->latency_sum += latency;
+
+    if (latency > stats->latency_max)
+    {
+        stats->latency_max = latency;
+    }
+}
+
+/**
+ * @brief   Handle one batch of pending messages of the service.
+ *
+ * @param   obj Pointer to the service object handle.
+ *
+ * @retval  Returns the number of messages taken from the queues.
+ */
+static uint32_t service_dispatch(const object* obj)
+{
+    service_t* svc = (service_t*)obj->object_data;
+    service_intf_t* intf = (service_intf_t*)obj->object_intf;
+    const service_config_t* config =
+        (const service_config_t*)obj->object_config;
+    uint32_t batch_count = config->batch_count ? config->batch_count : 1;
+    uint32_t count;
+    message_t message;
+    service_lane_e lane;
+#ifdef CONFIG_MSG_TRACE_ENABLE
+    uint32_t dequeue;
+#endif
+
+    if (service_get_message(svc, &message, &lane))
+    {
+        return 0;
+    }
+
+    svc->stats.wakeup_count++;
+
+    if (config->batch_begin)
+    {
+        config->batch_begin(obj);
+    }
+
+    /* Drain the pending messages without blocking */
+    count = 0;
+    do
+    {
+        /* A token stands for the latest message in the mailbox slot */
+        if (message.id != MSG_ID_SYS_MAILBOX ||
+            !service_mailbox_take(svc, message.param0, &message))
+        {
+            svc->stats.handle_count++;
+
+            service_account_latency(svc, &message, lane);
+
+#ifdef CONFIG_MSG_TRACE_ENABLE
+            dequeue = osKernelGetSysTimerCount();
+#endif
+
+            service_supervisor_enter(obj, message.id);
+
+            if (intf->message_handler)
+            {
+                intf->message_handler(obj, &message);
+            }
+
+            service_supervisor_leave(obj);
+
+#ifdef CONFIG_MSG_TRACE_ENABLE
+            service_trace_record(&svc->trace,
+                                 message.id,
+                                 dequeue - message.timestamp,
+                                 osKernelGetSysTimerCount() - dequeue);
+#endif
+
+            payload_release(message.payload);
+        }
+
+        if (++count >= batch_count)
+        {
+            break;
+        }
+    }
+    while (!service_get_message(svc, &message, &lane));
+
+    if (count > svc->stats.batch_max)
+    {
+        svc->stats.batch_max = count;
+    }
+
+    if (config->batch_end)
+    {
+        config->batch_end(obj);
+    }
+
+    return count;
+}
+
+/**
+ * @brief   Service routine thread, processing message loops.
+ *
+ * @param   argument Pointer to the service object handle.
+ *
+ * @retval  None.
+ *
+ * @note    The thread sleeps on SERVICE_FLAG_MESSAGE, the senders set it
+ *          after queuing a message into any lane.
+ */
+static void service_routine_thread(void* argument)
+{
+    const object* obj = (const object*)argument;
+
+    while (1)
+    {
+        if (!service_dispatch(obj))
+        {
+            (void)osThreadFlagsWait(SERVICE_FLAG_MESSAGE,
+                                    osFlagsWaitAny,
+                                    osWaitForever);
+        }
+    }
+}
+
+/**
+ * @brief   Check if the service has pending messages.
+ *
+ * @param   svc Pointer to the service handle.
+ *
+ * @retval  Returns 1 if pending, 0 otherwise.
+ */
+static inline uint32_t service_has_message(const service_t* svc)
+{
+    uint32_t lane;
+
+    for (lane = SERVICE_LANE_NORMAL; lane < SERVICE_LANE_NUM; lane++)
+    {
+        if (svc->queue_id[lane] && osMessageQueueGetCount(svc->queue_id[lane]))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Put the pool service into the ready queue if it is not there.
+ *
+ * @param   svc Pointer to the service handle.
+ *
+ * @retval  None.
+ *
+ * @note    The service stays scheduled until a worker finds it idle or
+ *          stopping, so it is in the ready queue or on a worker at most once.
+ */
+static void service_pool_schedule(service_t* svc)
+{
+    uint32_t schedule;
+    uint32_t isrm;
+
+    isrm = service_lock();
+
+    schedule = !svc->scheduled;
+    svc->scheduled = 1;
+
+    service_unlock(isrm);
+
+    if (schedule)
+    {
+        (void)osMessageQueuePut(service_pool.ready_id, &svc, 0, 0);
+    }
+}
+
+/**
+ * @brief   Worker thread of the pool, it runs one batch of a ready service
+ *          then puts the service back to the tail if it is still busy.
+ *
+ * @param   argument None.
+ *
+ * @retval  None.
+ */
+static void service_pool_worker_thread(void* argument)
+{
+    service_t* svc;
+    uint32_t pending;
+    uint32_t isrm;
+    osStatus_t stat;
+
+    (void)argument;
+
+    while (1)
+    {
+        stat = osMessageQueueGet(service_pool.ready_id,
+                                 &svc,
+                                 NULL,
+                                 osWaitForever);
+        if (stat != osOK)
+        {
+            continue;
+        }
+
+        if (!svc->stopping)
+        {
+            (void)service_dispatch(svc->owner);
+        }
+
+        isrm = service_lock();
+
+        /* A stopping service leaves the schedule, see service_deinit() */
+        pending = !svc->stopping && service_has_message(svc);
+        if (!pending)
+        {
+            svc->scheduled = 0;
+        }
+
+        service_unlock(isrm);
+
+        if (pending)
+        {
+            (void)osMessageQueuePut(service_pool.ready_id, &svc, 0, 0);
+        }
+    }
+}
+
+/**
+ * @brief   Create the worker pool on the first pool service, the workers
+ *          and the ready queue are always in static memory.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_pool_init(void)
+{
+    osThreadAttr_t attr = service_pool_worker_attr;
+    uint32_t i;
+
+    if (service_pool.ready_id)
+    {
+        return 0;
+    }
+
+    service_pool.ready_id = osMessageQueueNew(SERVICE_MAX_NUM,
+                                              sizeof(service_t*),
+                                              &service_pool_queue_attr);
+    if (!service_pool.ready_id)
+    {
+        pr_error("Create service pool queue <%s> failed.",
+                 service_pool_queue_attr.name);
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < CONFIG_SERVICE_POOL_WORKER_NUM; i++)
+    {
+        attr.cb_mem = &service_pool_worker_cb[i];
+        attr.stack_mem = service_pool_worker_stack[i];
+
+        service_pool.worker_id[i] =
+            osThreadNew(service_pool_worker_thread, NULL, &attr);
+        if (!service_pool.worker_id[i])
+        {
+            pr_error("Create service pool worker <%s> failed.",
+                     service_pool_worker_attr.name);
+            return -ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Build the subscription bitmap of the service.
+ *
+ * @param   obj Pointer to the service object handle.
+ * @param   config Pointer to the configuration space.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_init_subscription(const object*                  obj,
+                                         const service_config_t* const  config)
+{
+    service_t* svc = (service_t*)obj->object_data;
+    const service_subscription_t* entry;
+    uint32_t id;
+    uint32_t i;
+
+    (void)memset(svc->subscription, 0, sizeof(svc->subscription));
+
+    for (i = 0; i < config->subscription_count; i++)
+    {
+        entry = &config->subscription[i];
+
+        if (entry->first > entry->last)
+        {
+            pr_error("Service <%s> invalid subscription 0x%x - 0x%x.",
+                     obj->name,
+                     entry->first,
+                     entry->last);
+            return -EINVAL;
+        }
+
+        /* A single ID must be valid, a range just skips the holes */
+        if (entry->first == entry->last && !msg_id_is_valid(entry->first))
+        {
+            pr_error("Service <%s> invalid subscription 0x%x.",
+                     obj->name,
+                     entry->first);
+            return -EINVAL;
+        }
+
+        for (id = entry->first; ; id++)
+        {
+            if (msg_id_is_valid(id))
+            {
+                svc->subscription[msg_id_base_index(id)] |=
+                    1UL << msg_id_offset(id);
+            }
+
+            if (id == entry->last)
+            {
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Check if the service subscribes the message.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   id Message ID.
+ *
+ * @retval  Returns 1 if subscribed, 0 otherwise.
+ */
+static inline uint32_t service_is_subscribed(const service_t*   svc,
+                                             uint32_t           id)
+{
+    if (!msg_id_is_valid(id))
+    {
+        return 0;
+    }
+
+    return (svc->subscription[msg_id_base_index(id)] >>
+            msg_id_offset(id)) & 1UL;
+}
+
+/**
+ * @brief   Initialize the service instance.
+ *
+ * @param   obj Pointer to the service object handle.
+ * @param   config Pointer to the configuration space.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The service declared by DECLARE_SERVICE_STATIC creates its thread
+ *          and queues in the static memory, the others use the heap.
+ */
+static int32_t service_init(const object*                   obj,
+                            const service_config_t* const   config)
+{
+    service_t* svc = (service_t*)obj->object_data;
+    const service_static_mem_t* static_mem = svc->static_mem;
+    uint32_t msg_count[SERVICE_LANE_NUM];
+    osMessageQueueAttr_t queue_attr;
+    osThreadAttr_t thread_attr;
+    uint32_t lane;
+    int32_t lock;
+    int32_t ret;
+
+    ret = service_init_subscription(obj, config);
+    if (ret)
+    {
+        return ret;
+    }
+
+    if (config->mailbox_count)
+    {
+        (void)memset(config->mailbox,
+                     0,
+                     config->mailbox_count * sizeof(service_mailbox_slot_t));
+    }
+
+    msg_count[SERVICE_LANE_NORMAL] = config->msg_count;
+    msg_count[SERVICE_LANE_URGENT] = config->urgent_msg_count ?
+                                     config->urgent_msg_count :
+                                     CONFIG_MSG_URGENT_COUNT;
+
+    for (lane = SERVICE_LANE_NORMAL; lane < SERVICE_LANE_NUM; lane++)
+    {
+        queue_attr = config->queue_attr;
+
+        if (static_mem)
+        {
+            if (msg_count[lane] > static_mem->msg_count[lane])
+            {
+                pr_error("Service <%s> static queue %d is too small.",
+                         obj->name,
+                         lane);
+                return -ENOMEM;
+            }
+
+            queue_attr.cb_mem = &static_mem->queue_cb[lane];
+            queue_attr.cb_size = sizeof(StaticQueue_t);
+            queue_attr.mq_mem = static_mem->queue_mem[lane];
+            queue_attr.mq_size = msg_count[lane] * sizeof(message_t);
+        }
+
+        svc->queue_id[lane] = osMessageQueueNew(msg_count[lane],
+                                                sizeof(message_t),
+                                                &queue_attr);
+        if (!svc->queue_id[lane])
+        {
+            pr_error("Service <%s> create message queue <%s> failed.",
+                     obj->name,
+                     config->queue_attr.name);
+            return -EINVAL;
+        }
+    }
+
+    svc->users = 0;
+    svc->stopping = 0;
+
+    if (config->backend == SERVICE_BACKEND_POOL)
+    {
+        svc->scheduled = 0;
+
+        /* The services may be probed concurrently, see object_init() */
+        lock = osKernelLock();
+
+        ret = service_pool_init();
+
+        (void)osKernelRestoreLock(lock);
+
+        if (ret)
+        {
+            return ret;
+        }
+    }
+    else
+    {
+        thread_attr = config->thread_attr;
+
+        if (static_mem)
+        {
+            if (thread_attr.stack_size > static_mem->stack_size)
+            {
+                pr_error("Service <%s> static stack is too small.",
+                         obj->name);
+                return -ENOMEM;
+            }
+
+            thread_attr.cb_mem = static_mem->thread_cb;
+            thread_attr.cb_size = sizeof(StaticTask_t);
+            thread_attr.stack_mem = static_mem->stack;
+            thread_attr.stack_size = static_mem->stack_size;
+        }
+
+        svc->thread_id = osThreadNew(service_routine_thread,
+                                     (void*)obj,
+                                     &thread_attr);
+        if (!svc->thread_id)
+        {
+            pr_error("Service <%s> create thread <%s> failed.",
+                     obj->name,
+                     config->thread_attr.name);
+            return -EINVAL;
+        }
+    }
+
+    if (svc->init)
+    {
+        ret = svc->init(obj);
+        if (ret)
+        {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Deinitialize the service instance.
+ *
+ * @param   obj Pointer to the service object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The queues are deleted only when no sender uses them and no pool
+ *          worker has the service, the senders get -EPERM meanwhile. The
+ *          own thread is terminated only after it left its credit waits on
+ *          the other services. It gives up with -ETIMEDOUT after
+ *          CONFIG_SERVICE_STOP_TIMEOUT_MS, the service is left stopping.
+ */
+static int32_t service_deinit(const object* obj)
+{
+    service_t* svc = (service_t*)obj->object_data;
+    service_credit_waiter_t* waiter;
+    message_t message;
+    uint32_t start_tick;
+    uint32_t waits = 0;
+    uint32_t lane;
+    uint32_t isrm;
+    osStatus_t stat;
+
+    /* No new sender from here, the blocked ones are woken up to leave */
+    isrm = service_lock();
+
+    svc->stopping = 1;
+
+    for (waiter = svc->waiter; waiter; waiter = waiter->next)
+    {
+        (void)osThreadFlagsSet(waiter->thread_id, SERVICE_FLAG_CREDIT);
+    }
+
+    service_unlock(isrm);
+
+    start_tick = osKernelGetTickCount();
+
+    /* The own thread leaves its credit waits on the other services too */
+    while (svc->users || svc->scheduled ||
+           (svc->thread_id && (waits = service_wake_waits(svc->thread_id))))
+    {
+        if (osKernelGetTickCount() - start_tick >=
+            service_ms_to_ticks(CONFIG_SERVICE_STOP_TIMEOUT_MS))
+        {
+            pr_error("Service <%s> stop timeout, %u users, %u waits.",
+                     obj->name,
+                     svc->users,
+                     waits);
+            return -ETIMEDOUT;
+        }
+
+        (void)osDelay(1);
+    }
+
+    if (svc->deinit)
+    {
+        svc->deinit(obj);
+    }
+
+    if (svc->thread_id)
+    {
+        stat = osThreadTerminate(svc->thread_id);
+        if (stat != osOK)
+        {
+            pr_error("Service <%s> terminate thread <%s> failed, stat %d.",
+                     obj->name,
+                     osThreadGetName(svc->thread_id),
+                     stat);
+        }
+
+        /* A warm restart creates the thread again */
+        svc->thread_id = NULL;
+    }
+
+    for (lane = SERVICE_LANE_NORMAL; lane < SERVICE_LANE_NUM; lane++)
+    {
+        if (!svc->queue_id[lane])
+        {
+            continue;
+        }
+
+        /* Release the payloads of the pending messages */
+        while (osMessageQueueGet(svc->queue_id[lane],
+                                 &message,
+                                 NULL,
+                                 0) == osOK)
+        {
+            service_discard_message(svc, &message);
+        }
+
+        stat = osMessageQueueDelete(svc->queue_id[lane]);
+        if (stat != osOK)
+        {
+            pr_error("Service <%s> delete message queue failed, stat %d.",
+                     obj->name,
+                     stat);
+        }
+
+        svc->queue_id[lane] = NULL;
+        svc->reserved[lane] = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Handle service message queue.
+ *
+ * @param   obj Pointer to the service object handle.
+ * @param   message Pointer to the service message structure.
+ *
+ * @retval  None.
+ */
+static void service_message_handler(const object*           obj,
+                                    const message_t* const  message)
+{
+    service_t* svc = (service_t*)obj->object_data;
+
+    if (svc->message_handler)
+    {
+        svc->message_handler(obj, message);
+    }
+}
+
+const service_intf_t service_intf =
+{
+    .init               = service_init,
+    .deinit             = service_deinit,
+    .message_handler    = service_message_handler,
+};
+
+/**
+ * @brief   Check the coalescing configuration of the service.
+ *
+ * @param   obj Pointer to the service object handle.
+ * @param   config Pointer to the configuration space.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_check_coalesce(const object*                 obj,
+                                      const service_config_t* const config)
+{
+    uint32_t key_param;
+    uint32_t i;
+
+    if (!config->coalesce_count)
+    {
+        return 0;
+    }
+
+    if (!config->mailbox || !config->mailbox_count)
+    {
+        pr_error("Service <%s> coalesces messages without mailbox.",
+                 obj->name);
+        return -EINVAL;
+    }
+
+    for (i = 0; i < config->coalesce_count; i++)
+    {
+        key_param = config->coalesce[i].key_param;
+
+        if (key_param > 3 && key_param != SERVICE_COALESCE_KEY_NONE)
+        {
+            pr_error("Service <%s> invalid coalescing key %u of 0x%x.",
+                     obj->name,
+                     key_param,
+                     config->coalesce[i].id);
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Probe the service object.
+ *
+ * @param   obj Pointer to the service object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_probe(const object* obj)
+{
+    service_t* svc = (service_t*)obj->object_data;
+    const service_config_t* config =
+        (const service_config_t*)obj->object_config;
+    service_intf_t* intf = (service_intf_t*)obj->object_intf;
+    int32_t ret;
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+    int32_t profile;
+#endif
+
+    if (svc - module_service$$Base >= SERVICE_MAX_NUM)
+    {
+        pr_error("Service <%s> exceeds the limit %d.",
+                 obj->name,
+                 SERVICE_MAX_NUM);
+        return -ENOMEM;
+    }
+
+    if (config->overflow_policy >= SERVICE_OVERFLOW_NUM)
+    {
+        return -EINVAL;
+    }
+
+    if (config->backend >= SERVICE_BACKEND_NUM)
+    {
+        return -EINVAL;
+    }
+
+    ret = service_check_coalesce(obj, config);
+    if (ret)
+    {
+        return ret;
+    }
+
+    svc->owner = obj;
+
+    if (intf->init)
+    {
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+        /* The services are module_service objects, level 3 */
+        profile = boot_profile_enter(obj->name,
+                                     BOOT_PROFILE_KIND_SERVICE,
+                                     3);
+#endif
+
+        ret = intf->init(obj, config);
+
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+        boot_profile_leave(profile, ret);
+#endif
+
+        if (ret)
+        {
+            return ret;
+        }
+    }
+
+    pr_info("Object <%s> probe succeed.", obj->name);
+
+    return 0;
+}
+
+/**
+ * @brief   Remove the service object.
+ *
+ * @param   obj Pointer to the service object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_shutdown(const object* obj)
+{
+    service_intf_t* intf = (service_intf_t*)obj->object_intf;
+    int32_t ret;
+
+    if (intf->deinit)
+    {
+        ret = intf->deinit(obj);
+        if (ret)
+        {
+            return ret;
+        }
+    }
+
+    pr_info("Object <%s> shutdown succeed.", obj->name);
+
+    return 0;
+}
+
+/**
+ * @brief   Get the thread ID for service.
+ *
+ * @param   obj Pointer to the service object handle.
+ *
+ * @retval  Returns the thread ID.
+ */
+osThreadId_t service_get_thread_id(const object* obj)
+{
+    service_t* svc = (service_t*)obj->object_data;
+
+    return svc->thread_id;
+}
+
+/**
+ * @brief   Get the queue ID for service.
+ *
+ * @param   obj Pointer to the service object handle.
+ * @param   lane Message lane.
+ *
+ * @retval  Returns the queue ID.
+ */
+osMessageQueueId_t service_get_queue_id(const object*   obj,
+                                        service_lane_e  lane)
+{
+    service_t* svc = (service_t*)obj->object_data;
+
+    if (lane >= SERVICE_LANE_NUM)
+    {
+        return NULL;
+    }
+
+    return svc->queue_id[lane];
+}
+
 /**
- * @brief   Service routine thread, processing message loops.
+ * @brief   Get the private data for service.
  *
- * @param   argument Pointer to the service object handle.
+ * @param   obj Pointer to the service object handle.
  *
- * @retval  None.
+ * @retval  Returns the private data.
  */
-static void service_routine_thread(void* argument)
+void* service_get_priv_data(const object* obj)
 {
-    object* obj = (object*)argument;
     service_t* svc = (service_t*)obj->object_data;
-    service_intf_t* intf = (service_intf_t*)obj->object_intf;
-    message_t message;
-    osStatus_t stat;
 
-    while (1)
+    return svc->priv;
+}
+
+/**
+ * @brief   Get the service handle.
+ *
+ * @param   obj Pointer to the service object handle.
+ *
+ * @retval  Returns the service handle.
+ */
+service_t* service_get_svc(const object* obj)
+{
+    service_t* svc = (service_t*)obj->object_data;
+
+    return svc;
+}
+
+/**
+ * @brief   Get the number of services.
+ *
+ * @retval  Returns the number of services.
+ */
+uint32_t service_get_count(void)
+{
+    return module_service$$Limit - module_service$$Base;
+}
+
+/**
+ * @brief   Get the service handle by index.
+ *
+ * @param   index Service index.
+ *
+ * @retval  Service handle for reference or NULL in case of error.
+ */
+service_t* service_get_svc_by_index(uint32_t index)
+{
+    if (index >= service_get_count())
     {
-        stat = osMessageQueueGet(svc->queue_id,
-                                 &message,
-                                 NULL,
-                                 osWaitForever);
-        if (stat != osOK)
+        return NULL;
+    }
+
+    return &module_service$$Base[index];
+}
+
+/**
+ * @brief   Get the broadcast statistics.
+ *
+ * @retval  Returns the broadcast statistics.
+ */
+const service_broadcast_stats_t* service_get_broadcast_stats(void)
+{
+    return &service_broadcast_stats;
+}
+
+/**
+ * @brief   Get the worker thread of the pool.
+ *
+ * @param   index Worker index.
+ *
+ * @retval  Returns the thread ID, NULL if the worker does not exist.
+ */
+osThreadId_t service_get_pool_worker(uint32_t index)
+{
+    if (index >= CONFIG_SERVICE_POOL_WORKER_NUM)
+    {
+        return NULL;
+    }
+
+    return service_pool.worker_id[index];
+}
+
+/**
+ * @brief   Get the blocking budget of the service in kernel ticks.
+ *
+ * @param   svc Pointer to the service handle.
+ *
+ * @retval  Returns the blocking budget.
+ */
+static uint32_t service_get_block_budget(const service_t* svc)
+{
+    const service_config_t* config =
+        (const service_config_t*)svc->owner->object_config;
+
+    if (config->overflow_policy != SERVICE_OVERFLOW_BLOCK)
+    {
+        return 0;
+    }
+
+    if (config->block_budget_ms)
+    {
+        return service_ms_to_ticks(config->block_budget_ms);
+    }
+
+    return service_ms_to_ticks(CONFIG_MSG_SEND_BLOCK_TIMEOUT_MS);
+}
+
+/**
+ * @brief   Put the message into the service queue, the caller is a sender
+ *          of service_enter().
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   message Message structure to send.
+ * @param   lane Message lane.
+ * @param   timeout Ticks to wait if the overflow policy is blocking.
+ * @param   credited Set if the message spends a credit reserved before.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    When the queue is full, the overflow policy of the service decides
+ *          what happens, the dropped new message is accounted by the caller.
+ *          The space reserved by service_reserve_credit() counts as full for
+ *          the senders without credit.
+ *          A coalesced message replaces the pending one with the same key,
+ *          only the first one of a key queues a token.
+ */
+static int32_t service_queue_message(service_t*       svc,
+                                     const message_t* message,
+                                     service_lane_e   lane,
+                                     uint32_t         timeout,
+                                     uint32_t         credited)
+{
+    const service_config_t* config =
+        (const service_config_t*)svc->owner->object_config;
+    const service_coalesce_t* coalesce;
+    const message_t* queued;
+    message_t stamped;
+    message_t token;
+    message_t oldest;
+    uint32_t index;
+    uint32_t seq;
+    int32_t posted = 0;
+    int32_t ret;
+
+    stamped = *message;
+    stamped.timestamp = osKernelGetSysTimerCount();
+
+    queued = &stamped;
+
+    /* The queued copy owns a reference before the consumer can see it */
+    (void)payload_hold(message->payload);
+
+    coalesce = service_find_coalesce(config, message->id);
+    if (coalesce)
+    {
+        ret = service_mailbox_post(svc, coalesce, &stamped, lane, &index, &seq);
+        if (ret <= 0 && credited)
+        {
+            /* No token is queued, so the credit is not spent */
+            service_put_credit(svc, lane, 1);
+        }
+
+        if (ret < 0)
+        {
+            payload_release(message->payload);
+            return -EAGAIN;
+        }
+
+        if (ret == 0)
+        {
+            return 0;
+        }
+
+        posted = ret;
+
+        (void)memset(&token, 0, sizeof(token));
+
+        token.id = MSG_ID_SYS_MAILBOX;
+        token.param0 = index;
+        token.timestamp = stamped.timestamp;
+
+        queued = &token;
+    }
+
+    ret = service_try_credit(svc, lane, 1, queued, credited);
+    if (ret)
+    {
+        switch (config->overflow_policy)
+        {
+        case SERVICE_OVERFLOW_DROP_OLDEST:
+
+            ret = service_drop_credit(svc, lane, queued, &oldest);
+            if (!ret)
+            {
+                service_discard_message(svc, &oldest);
+                svc->stats.drop_count++;
+            }
+
+            break;
+
+        case SERVICE_OVERFLOW_BLOCK:
+
+            ret = service_wait_credit(svc, lane, 1, queued, timeout);
+
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (posted)
+    {
+        /* Without a token a new slot is never seen, so drop the key */
+        service_mailbox_commit(svc, index, seq, posted == 1, !ret);
+    }
+    else if (ret)
+    {
+        service_discard_message(svc, queued);
+    }
+
+    if (ret)
+    {
+        return (ret == -EPERM) ? ret : -EAGAIN;
+    }
+
+    svc->stats.enqueue_count++;
+    svc->stats.lane[lane].enqueue_count++;
+
+    if (config->backend == SERVICE_BACKEND_POOL)
+    {
+        service_pool_schedule(svc);
+    }
+    else
+    {
+        (void)osThreadFlagsSet(svc->thread_id, SERVICE_FLAG_MESSAGE);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Put the message into the service queue, unless it is stopping.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   message Message structure to send.
+ * @param   lane Message lane.
+ * @param   timeout Ticks to wait if the overflow policy is blocking.
+ * @param   credited Set if the message spends a credit reserved before.
+ *
+ * @retval  Returns 0 on success, -EPERM if the service is stopping,
+ *          negative error code otherwise.
+ */
+static int32_t service_put_message(service_t*       svc,
+                                   const message_t* message,
+                                   service_lane_e   lane,
+                                   uint32_t         timeout,
+                                   uint32_t         credited)
+{
+    int32_t ret;
+
+    ret = service_enter(svc);
+    if (ret)
+    {
+        return ret;
+    }
+
+    ret = service_queue_message(svc, message, lane, timeout, credited);
+
+    service_leave(svc);
+
+    return ret;
+}
+
+/**
+ * @brief   Broadcast event messages to the subscribed services.
+ *
+ * @param   message Message structure to send.
+ * @param   lane Message lane.
+ *
+ * @retval  Returns 0 on success, -EINVAL if the message ID is out of the
+ *          MSG_ID_BASE_NUM and MSG_ID_OFFSET_NUM range, negative error code
+ *          otherwise.
+ *
+ * @note    The message is offered to every subscriber first without blocking,
+ *          then the blocking subscribers which were full share the remaining
+ *          CONFIG_MSG_BROADCAST_BUDGET_MS. A failed subscriber never stops the
+ *          delivery to the others.
+ *          From interrupt the message is posted to the event channel and
+ *          fanned out by its dispatcher thread, so the cost does not grow
+ *          with the number of subscribers.
+ */
+int32_t service_broadcast_message_prio(const message_t*   message,
+                                       service_lane_e     lane)
+{
+    service_t* start = module_service$$Base;
+    service_t* end = module_service$$Limit;
+    service_t* svc;
+    uint32_t pending = 0;
+    uint32_t start_tick;
+    uint32_t budget;
+    uint32_t elapsed;
+    uint32_t timeout;
+    uint32_t index;
+    int32_t failed = 0;
+    int32_t ret;
+    BaseType_t is_irq = xPortIsInsideInterrupt();
+
+    if (!message)
+    {
+        return -EINVAL;
+    }
+
+    /* An ID outside the subscription bitmap would reach nobody */
+    if (!msg_id_is_valid(message->id))
+    {
+        return -EINVAL;
+    }
+
+    if (lane >= SERVICE_LANE_NUM)
+    {
+        return -EINVAL;
+    }
+
+    if (is_irq && service_event_is_ready())
+    {
+        return service_event_post(NULL, message, lane);
+    }
+
+#ifdef CONFIG_MSG_CAPTURE_ENABLE
+    /* A posted event is recorded once, when its dispatcher sends it */
+    service_capture_record(NULL, message, lane);
+#endif
+
+    if (is_irq)
+    {
+        budget = 0;
+    }
+    else
+    {
+        budget = service_ms_to_ticks(CONFIG_MSG_BROADCAST_BUDGET_MS);
+    }
+
+    start_tick = osKernelGetTickCount();
+
+    service_broadcast_stats.broadcast_count++;
+
+    for (svc = start, index = 0; svc < end; svc++, index++)
+    {
+        if (!svc->queue_id[lane] ||
+            svc->stopping ||
+            !service_is_subscribed(svc, message->id))
+        {
+            service_broadcast_stats.filter_count++;
+            continue;
+        }
+
+        ret = service_put_message(svc, message, lane, 0, 0);
+        if (ret)
+        {
+            if (budget && service_get_block_budget(svc))
+            {
+                pending |= 1UL << index;
+                continue;
+            }
+
+            svc->stats.drop_count++;
+            failed++;
+
+            pr_error("Broadcast %s(0x%x) to <%s> failed, ret %d.",
+                     msg_id_to_str(message->id),
+                     message->id,
+                     svc->owner->name,
+                     ret);
+            continue;
+        }
+
+        service_broadcast_stats.enqueue_count++;
+    }
+
+    for (svc = start, index = 0; pending; svc++, index++)
+    {
+        if (!(pending & (1UL << index)))
         {
             continue;
         }
 
-        if (intf->message_handler)
+        pending &= ~(1UL << index);
+
+        elapsed = osKernelGetTickCount() - start_tick;
+        timeout = (elapsed < budget) ? (budget - elapsed) : 0;
+        if (timeout > service_get_block_budget(svc))
+        {
+            timeout = service_get_block_budget(svc);
+        }
+
+        ret = service_put_message(svc, message, lane, timeout, 0);
+        if (ret)
         {
-            intf->message_handler(obj, &message);
+            svc->stats.drop_count++;
+            failed++;
+
+            pr_error("Broadcast %s(0x%x) to <%s> failed, ret %d.",
+                     msg_id_to_str(message->id),
+                     message->id,
+                     svc->owner->name,
+                     ret);
+            continue;
         }
+
+        service_broadcast_stats.enqueue_count++;
+    }
+
+    elapsed = osKernelGetTickCount() - start_tick;
+    if (elapsed > service_broadcast_stats.latency_max)
+    {
+        service_broadcast_stats.latency_max = elapsed;
+    }
+
+    if (failed)
+    {
+        service_broadcast_stats.drop_count += failed;
+
+        return -EPIPE;
     }
+
+    pr_info("Broadcast %s(0x%x) succeed, 0x%x, 0x%x, 0x%x, 0x%x.",
+            msg_id_to_str(message->id),
+            message->id,
+            message->param0,
+            message->param1,
+            message->param2,
+            message->param3);
+
+    return 0;
 }
 
 /**
- * @brief   Initialize the service instance.
+ * @brief   Broadcast event messages through the normal lane.
+ *
+ * @param   message Message structure to send.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_broadcast_message(const message_t* message)
+{
+    return service_broadcast_message_prio(message, SERVICE_LANE_NORMAL);
+}
+
+/**
+ * @brief   Unicast event messages to a specified service.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   message Message structure to send.
+ * @param   lane Message lane.
  *
- * @param   obj Pointer to the service object handle.
- * @param   config Pointer to the configuration space.
+ * @retval  Returns 0 on success, -EPERM if the service is stopping, -EINVAL
+ *          if the message ID is out of range, negative error code otherwise.
  *
- * @retval  Returns 0 on success, negative error code otherwise.
+ * @note    From interrupt the message is posted to the event channel and
+ *          delivered by its dispatcher thread.
  */
-static int32_t service_init(const object*                   obj,
-                            const service_config_t* const   config)
+int32_t service_unicast_message_prio(const service_t*   svc,
+                                     const message_t*   message,
+                                     service_lane_e     lane)
 {
-    service_t* svc = (service_t*)obj->object_data;
+    service_t* target = (service_t*)svc;
+    char buf[CONFIG_MSG_FORMAT_BUF_SIZE];
+    uint32_t timeout;
     int32_t ret;
+    BaseType_t is_irq = xPortIsInsideInterrupt();
 
-    svc->queue_id = osMessageQueueNew(config->msg_count,
-                                      sizeof(message_t),
-                                      &config->queue_attr);
-    if (!svc->queue_id)
+    if (!svc)
     {
-        pr_error("Service <%s> create message queue <%s> failed.",
-                 obj->name,
-                 config->queue_attr.name);
         return -EINVAL;
     }
 
-    svc->thread_id = osThreadNew(service_routine_thread,
-                                 (void*)obj,
-                                 &config->thread_attr);
-    if (!svc->thread_id)
+    if (!message)
     {
-        pr_error("Service <%s> create thread <%s> failed.",
-                 obj->name,
-                 config->thread_attr.name);
         return -EINVAL;
     }
 
-    if (svc->init)
+    if (!msg_id_is_valid(message->id))
     {
-        ret = svc->init(obj);
-        if (ret)
-        {
-            return ret;
-        }
+        return -EINVAL;
     }
 
-    return 0;
-}
+    if (lane >= SERVICE_LANE_NUM)
+    {
+        return -EINVAL;
+    }
 
-/**
- * @brief   Deinitialize the service instance.
- *
- * @param   obj Pointer to the service object handle.
- *
- * @retval  Returns 0 on success, negative error code otherwise.
- */
-static int32_t service_deinit(const object* obj)
-{
-    service_t* svc = (service_t*)obj->object_data;
-    osStatus_t stat;
+    if (!svc->queue_id[lane])
+    {
+        return -ENODEV;
+    }
 
-    if (svc->deinit)
+    if (svc->stopping)
     {
-        svc->deinit(obj);
+        return -EPERM;
     }
 
-    if (svc->thread_id)
+    if (is_irq && service_event_is_ready())
     {
-        stat = osThreadTerminate(svc->thread_id);
-        if (stat != osOK)
-        {
-            pr_error("Service <%s> terminate thread <%s> failed, stat %d.",
-                     obj->name,
-                     osThreadGetName(svc->thread_id),
-                     stat);
-        }
+        return service_event_post(svc, message, lane);
     }
 
-    if (svc->queue_id)
+#ifdef CONFIG_MSG_CAPTURE_ENABLE
+    /* A posted event is recorded once, when its dispatcher sends it */
+    service_capture_record(svc, message, lane);
+#endif
+
+    if (is_irq)
     {
-        stat = osMessageQueueDelete(svc->queue_id);
-        if (stat != osOK)
-        {
-            pr_error("Service <%s> delete message queue failed, stat %d.",
-                     obj->name,
-                     stat);
-        }
+        timeout = 0;
+    }
+    else
+    {
+        timeout = service_get_block_budget(svc);
+    }
+
+    ret = service_put_message(target, message, lane, timeout, 0);
+    if (ret == -EPERM)
+    {
+        return ret;
+    }
+
+    if (ret)
+    {
+        target->stats.drop_count++;
+
+        (void)msg_format(buf, sizeof(buf), message);
+
+        pr_error("Unicast %s to <%s> failed, ret %d.",
+                 buf,
+                 svc->owner->name,
+                 ret);
+
+        return -EPIPE;
     }
 
+    pr_info("Unicast %s(0x%x) succeed, 0x%x, 0x%x, 0x%x, 0x%x.",
+            msg_id_to_str(message->id),
+            message->id,
+            message->param0,
+            message->param1,
+            message->param2,
+            message->param3);
+
     return 0;
 }
 
 /**
- * @brief   Handle service message queue.
+ * @brief   Unicast event messages to a specified service through the normal
+ *          lane.
  *
- * @param   obj Pointer to the service object handle.
- * @param   message Pointer to the service message structure.
+ * @param   svc Pointer to the service handle.
+ * @param   message Message structure to send.
  *
- * @retval  None.
+ * @retval  Returns 0 on success, negative error code otherwise.
  */
-static void service_message_handler(const object*           obj,
-                                    const message_t* const  message)
+int32_t service_unicast_message(const service_t* svc, const message_t* message)
 {
-    service_t* svc = (service_t*)obj->object_data;
-
-    if (svc->message_handler)
-    {
-        svc->message_handler(obj, message);
-    }
+    return service_unicast_message_prio(svc, message, SERVICE_LANE_NORMAL);
 }
 
-const service_intf_t service_intf =
-{
-    .init               = service_init,
-    .deinit             = service_deinit,
-    .message_handler    = service_message_handler,
-};
-
 /**
- * @brief   Probe the service object.
+ * @brief   Get the free credits of the service lane.
  *
- * @param   obj Pointer to the service object handle.
+ * @param   svc Pointer to the service handle.
+ * @param   lane Message lane.
  *
- * @retval  Returns 0 on success, negative error code otherwise.
+ * @retval  Returns the number of messages which can be queued into the lane
+ *          without a reserved credit, 0 if the lane is invalid.
  */
-int32_t service_probe(const object* obj)
+uint32_t service_get_credit(const service_t* svc, service_lane_e lane)
 {
-    service_t* svc = (service_t*)obj->object_data;
-    const service_config_t* config =
-        (const service_config_t*)obj->object_config;
-    service_intf_t* intf = (service_intf_t*)obj->object_intf;
-    int32_t ret;
+    uint32_t credit;
 
-    svc->owner = obj;
+    if (!svc || lane >= SERVICE_LANE_NUM || !svc->queue_id[lane])
+    {
+        return 0;
+    }
 
-    if (intf->init)
+    if (service_enter((service_t*)svc))
     {
-        ret = intf->init(obj, config);
-        if (ret)
-        {
-            return ret;
-        }
+        return 0;
     }
 
-    pr_info("Object <%s> probe succeed.", obj->name);
+    credit = service_get_free_credit(svc, lane);
 
-    return 0;
+    service_leave((service_t*)svc);
+
+    return credit;
 }
 
 /**
- * @brief   Remove the service object.
+ * @brief   Reserve credits of the service lane, each credit guarantees the
+ *          space for one message sent by service_unicast_message_credit().
  *
- * @param   obj Pointer to the service object handle.
+ * @param   svc Pointer to the service handle.
+ * @param   lane Message lane.
+ * @param   count Number of credits.
+ * @param   timeout_ms Time to wait for the credits in milliseconds, 0 to
+ *          return at once, osWaitForever to wait without limit.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The credits are not tracked per sender, the senders which share a
+ *          lane share its reserved credits too. A sender which does not need
+ *          its credits any more must give them back by
+ *          service_release_credit(). From interrupt the timeout must be 0.
  */
-int32_t service_shutdown(const object* obj)
+int32_t service_reserve_credit(const service_t*    svc,
+                               service_lane_e      lane,
+                               uint32_t            count,
+                               uint32_t            timeout_ms)
 {
-    service_intf_t* intf = (service_intf_t*)obj->object_intf;
+    uint32_t timeout;
     int32_t ret;
 
-    if (intf->deinit)
+    if (!svc || lane >= SERVICE_LANE_NUM || !count)
     {
-        ret = intf->deinit(obj);
-        if (ret)
-        {
-            return ret;
-        }
+        return -EINVAL;
     }
 
-    pr_info("Object <%s> shutdown succeed.", obj->name);
-
-    return 0;
-}
-
-/**
- * @brief   Get the thread ID for service.
- *
- * @param   obj Pointer to the service object handle.
- *
- * @retval  Returns the thread ID.
- */
-osThreadId_t service_get_thread_id(const object* obj)
-{
-    service_t* svc = (service_t*)obj->object_data;
+    if (!svc->queue_id[lane])
+    {
+        return -ENODEV;
+    }
 
-    return svc->thread_id;
-}
+    if (count > osMessageQueueGetCapacity(svc->queue_id[lane]))
+    {
+        return -EINVAL;
+    }
 
-/**
- * @brief   Get the queue ID for service.
- *
- * @param   obj Pointer to the service object handle.
- *
- * @retval  Returns the queue ID.
- */
-osMessageQueueId_t service_get_queue_id(const object* obj)
-{
-    service_t* svc = (service_t*)obj->object_data;
+    if (timeout_ms && xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
 
-    return svc->queue_id;
-}
+    if (timeout_ms == osWaitForever)
+    {
+        timeout = osWaitForever;
+    }
+    else
+    {
+        timeout = service_ms_to_ticks(timeout_ms);
+    }
 
-/**
- * @brief   Get the private data for service.
- *
- * @param   obj Pointer to the service object handle.
- *
- * @retval  Returns the private data.
- */
-void* service_get_priv_data(const object* obj)
-{
-    service_t* svc = (service_t*)obj->object_data;
+    ret = service_enter((service_t*)svc);
+    if (ret)
+    {
+        return ret;
+    }
 
-    return svc->priv;
-}
+    ret = service_wait_credit((service_t*)svc, lane, count, NULL, timeout);
 
-/**
- * @brief   Get the service handle.
- *
- * @param   obj Pointer to the service object handle.
- *
- * @retval  Returns the service handle.
- */
-service_t* service_get_svc(const object* obj)
-{
-    service_t* svc = (service_t*)obj->object_data;
+    service_leave((service_t*)svc);
 
-    return svc;
+    return ret;
 }
 
 /**
- * @brief   Broadcast event messages to all services.
+ * @brief   Give back the unused credits of the service lane.
  *
- * @param   message Message structure to send.
+ * @param   svc Pointer to the service handle.
+ * @param   lane Message lane.
+ * @param   count Number of credits.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
  */
-int32_t service_broadcast_message(const message_t* message)
+int32_t service_release_credit(const service_t*    svc,
+                               service_lane_e      lane,
+                               uint32_t            count)
 {
-    extern service_t module_service$$Base[];
-    extern service_t module_service$$Limit[];
-
-    const service_t* start = module_service$$Base;
-    const service_t* end = module_service$$Limit;
-    const service_t* svc;
-    osStatus_t stat;
-    uint32_t timeout;
-    BaseType_t is_irq = xPortIsInsideInterrupt();
-
-    if (!message)
+    if (!svc || lane >= SERVICE_LANE_NUM)
     {
         return -EINVAL;
     }
 
-    if (is_irq)
-    {
-        timeout = 0;
-    }
-    else
+    if (count > svc->reserved[lane])
     {
-        timeout = CONFIG_MSG_SEND_BLOCK_TIMEOUT_MS * osKernelGetTickFreq() /
-                  1000;
+        return -EINVAL;
     }
 
-    for (svc = start; svc < end; svc++)
+    /* The reserved credits are dropped with the queues anyway */
+    if (service_enter((service_t*)svc))
     {
-        if (svc)
-        {
-            stat = osMessageQueuePut(svc->queue_id, message, NULL, timeout);
-            if (stat != osOK)
-            {
-                pr_error("Broadcast %s(0x%x) failed, stat %d.",
-                         msg_id_to_str(message->id),
-                         message->id,
-                         stat);
-
-                return -EPIPE;
-            }
-        }
+        return 0;
     }
 
-    pr_info("Broadcast %s(0x%x) succeed, 0x%x, 0x%x, 0x%x, 0x%x.",
-            msg_id_to_str(message->id),
-            message->id,
-            message->param0,
-            message->param1,
-            message->param2,
-            message->param3);
+    service_put_credit((service_t*)svc, lane, count);
+
+    service_leave((service_t*)svc);
 
     return 0;
 }
 
 /**
- * @brief   Unicast event messages to a specified service.
+ * @brief   Unicast event messages to a specified service, spending one credit
+ *          reserved by service_reserve_credit().
  *
  * @param   svc Pointer to the service handle.
  * @param   message Message structure to send.
+ * @param   lane Message lane.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The reserved space can not be taken by the other senders, so the
+ *          message is queued at once and never blocks nor drops, even from
+ *          interrupt where it bypasses the event channel.
  */
-int32_t service_unicast_message(const service_t* svc, const message_t* message)
+int32_t service_unicast_message_credit(const service_t*  svc,
+                                       const message_t*  message,
+                                       service_lane_e    lane)
 {
-    osStatus_t stat;
-    uint32_t timeout;
-    BaseType_t is_irq = xPortIsInsideInterrupt();
+    int32_t ret;
 
-    if (!svc)
+    if (!svc || !message || !msg_id_is_valid(message->id) ||
+        lane >= SERVICE_LANE_NUM)
     {
         return -EINVAL;
     }
 
-    if (!message)
+    if (!svc->queue_id[lane])
     {
-        return -EINVAL;
+        return -ENODEV;
     }
 
-    if (is_irq)
+    if (!svc->reserved[lane])
     {
-        timeout = 0;
+        return -ENOSPC;
     }
-    else
+
+    if (svc->stopping)
+    {
+        return -EPERM;
+    }
+
+#ifdef CONFIG_MSG_CAPTURE_ENABLE
+    service_capture_record(svc, message, lane);
+#endif
+
+    ret = service_put_message((service_t*)svc, message, lane, 0, 1);
+    if (ret == -EPERM)
     {
-        timeout = CONFIG_MSG_SEND_BLOCK_TIMEOUT_MS * osKernelGetTickFreq() /
-                  1000;
+        return ret;
     }
 
-    stat = osMessageQueuePut(svc->queue_id, message, NULL, timeout);
-    if (stat != osOK)
+    if (ret)
     {
-        pr_error("Unicast %s(0x%x) failed, stat %d.",
+        ((service_t*)svc)->stats.drop_count++;
+
+        pr_error("Unicast %s(0x%x) with credit to <%s> failed, ret %d.",
                  msg_id_to_str(message->id),
                  message->id,
-                 stat);
+                 svc->owner->name,
+                 ret);
 
         return -EPIPE;
     }
 
-    pr_info("Unicast %s(0x%x) succeed, 0x%x, 0x%x, 0x%x, 0x%x.",
-            msg_id_to_str(message->id),
-            message->id,
-            message->param0,
-            message->param1,
-            message->param2,
-            message->param3);
-
     return 0;
 }
@@ -0,0 +1,482 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "framework.h"
+
+#ifdef CONFIG_MSG_CAPTURE_ENABLE
+
+/**
+ * The replay waits at most 1s for the targets, and takes them as done when
+ * no message was handled for SERVICE_CAPTURE_QUIET_TICKS.
+ */
+#define SERVICE_CAPTURE_QUIET_TICKS 10
+
+/**
+ * @brief   Capture handle definition.
+ */
+typedef struct
+{
+    service_capture_state_e state;
+    uint32_t                count;
+    uint32_t                lost;       /* Records dropped on a full buffer */
+    uint32_t                start_tick; /* Kernel tick of the start */
+} service_capture_handle_t;
+
+static service_capture_handle_t service_capture_handle;
+
+static service_capture_record_t service_capture_buff
+    [CONFIG_MSG_CAPTURE_RECORD_NUM];
+
+/**
+ * @brief   Enter the critical section from thread or interrupt.
+ *
+ * @retval  Returns the interrupt mask to restore.
+ */
+static inline uint32_t service_capture_lock(void)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        return taskENTER_CRITICAL_FROM_ISR();
+    }
+
+    taskENTER_CRITICAL();
+
+    return 0;
+}
+
+/**
+ * @brief   Exit the critical section from thread or interrupt.
+ *
+ * @param   isrm The interrupt mask returned by service_capture_lock().
+ *
+ * @retval  None.
+ */
+static inline void service_capture_unlock(uint32_t isrm)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        taskEXIT_CRITICAL_FROM_ISR(isrm);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief   Get the source of the message being sent.
+ *
+ * @retval  Returns the index of the service whose handler runs on the
+ *          calling thread, SERVICE_CAPTURE_ISR or SERVICE_CAPTURE_THREAD.
+ */
+static uint8_t service_capture_get_source(void)
+{
+    osThreadId_t thread_id;
+    const service_t* svc;
+    uint32_t i;
+
+    if (xPortIsInsideInterrupt())
+    {
+        return SERVICE_CAPTURE_ISR;
+    }
+
+    thread_id = osThreadGetId();
+
+    for (i = 0; i < service_get_count(); i++)
+    {
+        svc = service_get_svc_by_index(i);
+        if (svc->supervisor.busy_id &&
+            svc->supervisor.busy_thread == thread_id)
+        {
+            return (uint8_t)i;
+        }
+    }
+
+    return SERVICE_CAPTURE_THREAD;
+}
+
+/**
+ * @brief   Record a message sent on the service bus.
+ *
+ * @param   svc Pointer to the target service, NULL for a broadcast.
+ * @param   message Message structure being sent.
+ * @param   lane Message lane.
+ *
+ * @retval  None.
+ *
+ * @note    A message posted from interrupt is recorded once, when the event
+ *          channel dispatcher sends it, with the interrupt as its source.
+ */
+void service_capture_record(const service_t*    svc,
+                            const message_t*    message,
+                            service_lane_e      lane)
+{
+    service_capture_handle_t* handle = &service_capture_handle;
+    service_capture_record_t record;
+    uint32_t isrm;
+
+    if (handle->state != SERVICE_CAPTURE_STATE_RECORD)
+    {
+        return;
+    }
+
+    record.timestamp = (uint32_t)((uint64_t)(osKernelGetTickCount() -
+                                             handle->start_tick) *
+                                  1000 / osKernelGetTickFreq());
+    record.id = message->id;
+    record.source = service_event_is_dispatcher() ?
+                    SERVICE_CAPTURE_ISR : service_capture_get_source();
+    record.target = svc ?
+                    (uint8_t)(svc - service_get_svc_by_index(0)) :
+                    SERVICE_CAPTURE_BROADCAST;
+    record.lane = (uint8_t)lane;
+    record.reserved = 0;
+    record.param[0] = message->param0;
+    record.param[1] = message->param1;
+    record.param[2] = message->param2;
+    record.param[3] = message->param3;
+
+    isrm = service_capture_lock();
+
+    if (handle->state == SERVICE_CAPTURE_STATE_RECORD)
+    {
+        if (handle->count < CONFIG_MSG_CAPTURE_RECORD_NUM)
+        {
+            service_capture_buff[handle->count++] = record;
+        }
+        else
+        {
+            handle->lost++;
+        }
+    }
+
+    service_capture_unlock(isrm);
+}
+
+/**
+ * @brief   Clear the buffer and start recording.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_capture_start(void)
+{
+    service_capture_handle_t* handle = &service_capture_handle;
+    uint32_t isrm;
+
+    isrm = service_capture_lock();
+
+    if (handle->state == SERVICE_CAPTURE_STATE_REPLAY)
+    {
+        service_capture_unlock(isrm);
+
+        return -EBUSY;
+    }
+
+    handle->count = 0;
+    handle->lost = 0;
+    handle->start_tick = osKernelGetTickCount();
+    handle->state = SERVICE_CAPTURE_STATE_RECORD;
+
+    service_capture_unlock(isrm);
+
+    return 0;
+}
+
+/**
+ * @brief   Stop recording, the records are kept until the next start.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_capture_stop(void)
+{
+    service_capture_handle_t* handle = &service_capture_handle;
+    uint32_t isrm;
+
+    isrm = service_capture_lock();
+
+    if (handle->state != SERVICE_CAPTURE_STATE_RECORD)
+    {
+        service_capture_unlock(isrm);
+
+        return -EINVAL;
+    }
+
+    handle->state = SERVICE_CAPTURE_STATE_IDLE;
+
+    service_capture_unlock(isrm);
+
+    return 0;
+}
+
+/**
+ * @brief   Get the capture state.
+ *
+ * @retval  Returns the capture state.
+ */
+service_capture_state_e service_capture_get_state(void)
+{
+    return service_capture_handle.state;
+}
+
+/**
+ * @brief   Get the number of records in the buffer.
+ *
+ * @retval  Returns the number of records.
+ */
+uint32_t service_capture_get_count(void)
+{
+    return service_capture_handle.count;
+}
+
+/**
+ * @brief   Get the number of records dropped on a full buffer.
+ *
+ * @retval  Returns the number of records.
+ */
+uint32_t service_capture_get_lost(void)
+{
+    return service_capture_handle.lost;
+}
+
+/**
+ * @brief   Get the capture record.
+ *
+ * @param   index Record index.
+ *
+ * @retval  Record for reference or NULL in case of error.
+ */
+const service_capture_record_t* service_capture_get(uint32_t index)
+{
+    if (index >= service_capture_handle.count)
+    {
+        return NULL;
+    }
+
+    return &service_capture_buff[index];
+}
+
+/**
+ * @brief   Load a record into the buffer, a trace saved on the host is
+ *          loaded back record by record for replay.
+ *
+ * @param   index Record index, loading the index 0 starts a new trace.
+ * @param   record Pointer to the record.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_capture_load(uint32_t                          index,
+                             const service_capture_record_t*   record)
+{
+    service_capture_handle_t* handle = &service_capture_handle;
+
+    if (!record || index >= CONFIG_MSG_CAPTURE_RECORD_NUM)
+    {
+        return -EINVAL;
+    }
+
+    if (handle->state != SERVICE_CAPTURE_STATE_IDLE)
+    {
+        return -EBUSY;
+    }
+
+    if (index > handle->count)
+    {
+        return -EINVAL;
+    }
+
+    if (index == 0)
+    {
+        handle->lost = 0;
+    }
+
+    service_capture_buff[index] = *record;
+    handle->count = index + 1;
+
+    return 0;
+}
+
+/**
+ * @brief   Get the number of messages handled by all services.
+ *
+ * @retval  Returns the number of messages.
+ */
+static uint32_t service_capture_get_handled(void)
+{
+    uint32_t handled = 0;
+    uint32_t i;
+
+    for (i = 0; i < service_get_count(); i++)
+    {
+        handled += service_get_svc_by_index(i)->stats.handle_count;
+    }
+
+    return handled;
+}
+
+/**
+ * @brief   Wait until the capture time of the record comes.
+ *
+ * @param   offset Capture time of the record from the first one, in
+ *          milliseconds.
+ * @param   start_tick Replay start in kernel ticks.
+ * @param   scale Replay speed in percent of the capture time.
+ *
+ * @retval  None.
+ */
+static void service_capture_wait(uint32_t offset,
+                                 uint32_t start_tick,
+                                 uint32_t scale)
+{
+    uint32_t due = (uint32_t)((uint64_t)offset * osKernelGetTickFreq() *
+                              100 / 1000 / scale);
+    uint32_t elapsed = osKernelGetTickCount() - start_tick;
+
+    if (elapsed < due)
+    {
+        (void)osDelay(due - elapsed);
+    }
+}
+
+/**
+ * @brief   Replay the records in the buffer to the same targets.
+ *
+ * @param   scale Replay speed in percent of the capture time, 100 for real
+ *          time, 0 for as fast as possible.
+ * @param   result Returns the replay result.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    Nothing is recorded during the replay. The records sent to the
+ *          calling service are skipped, it could not handle them before the
+ *          replay returns.
+ */
+int32_t service_capture_replay(uint32_t                    scale,
+                               service_capture_result_t*   result)
+{
+    service_capture_handle_t* handle = &service_capture_handle;
+    const service_capture_record_t* record;
+    const service_t* svc;
+    message_t message;
+    uint8_t self;
+    uint32_t handled;
+    uint32_t last;
+    uint32_t start_tick;
+    uint32_t last_tick;
+    uint32_t i;
+    int32_t ret;
+
+    if (!result)
+    {
+        return -EINVAL;
+    }
+
+    if (handle->state != SERVICE_CAPTURE_STATE_IDLE)
+    {
+        return -EBUSY;
+    }
+
+    if (!handle->count)
+    {
+        return -EEMPTY;
+    }
+
+    (void)memset(result, 0, sizeof(service_capture_result_t));
+    (void)memset(&message, 0, sizeof(message));
+
+    handle->state = SERVICE_CAPTURE_STATE_REPLAY;
+
+    self = service_capture_get_source();
+    handled = service_capture_get_handled();
+    start_tick = osKernelGetTickCount();
+
+    for (i = 0; i < handle->count; i++)
+    {
+        record = &service_capture_buff[i];
+
+        if (record->target == self)
+        {
+            continue;
+        }
+
+        if (scale)
+        {
+            service_capture_wait(record->timestamp -
+                                 service_capture_buff[0].timestamp,
+                                 start_tick,
+                                 scale);
+        }
+
+        message.id = record->id;
+        message.param0 = record->param[0];
+        message.param1 = record->param[1];
+        message.param2 = record->param[2];
+        message.param3 = record->param[3];
+
+        if (record->target == SERVICE_CAPTURE_BROADCAST)
+        {
+            ret = service_broadcast_message_prio(&message,
+                                                 (service_lane_e)record->lane);
+        }
+        else
+        {
+            svc = service_get_svc_by_index(record->target);
+
+            ret = svc ?
+                  service_unicast_message_prio(svc,
+                                               &message,
+                                               (service_lane_e)record->lane) :
+                  -ENODEV;
+        }
+
+        if (ret)
+        {
+            result->failed++;
+        }
+        else
+        {
+            result->sent++;
+        }
+    }
+
+    /* Wait for the targets to go quiet, at most 1s */
+    last = service_capture_get_handled();
+    last_tick = osKernelGetTickCount();
+    while (osKernelGetTickCount() - last_tick < SERVICE_CAPTURE_QUIET_TICKS &&
+           osKernelGetTickCount() - start_tick < osKernelGetTickFreq())
+    {
+        (void)osDelay(1);
+
+        if (service_capture_get_handled() != last)
+        {
+            last = service_capture_get_handled();
+            last_tick = osKernelGetTickCount();
+        }
+    }
+
+    result->handled = last - handled;
+    result->elapsed_ms = (last_tick - start_tick) * 1000 /
+                         osKernelGetTickFreq();
+
+    handle->state = SERVICE_CAPTURE_STATE_IDLE;
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,285 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "framework.h"
+#include "event_ring.h"
+
+#define SERVICE_EVENT_FLAG  0x1
+
+/**
+ * @brief   Event definition, the target is NULL for a broadcast.
+ */
+typedef struct
+{
+    message_t           message;
+    const service_t*    svc;
+    uint32_t            lane;
+} service_event_t;
+
+/**
+ * @brief   Event channel handle definition.
+ */
+typedef struct
+{
+    event_ring_t            ring;
+    osThreadId_t            thread_id;
+    service_event_stats_t   stats;
+} service_event_handle_t;
+
+static service_event_handle_t service_event_handle;
+
+/**
+ * @brief   Static memory of the event ring and the dispatcher thread.
+ */
+static uint32_t service_event_seq[CONFIG_MSG_EVENT_RING_SIZE];
+static service_event_t service_event_item[CONFIG_MSG_EVENT_RING_SIZE];
+static StaticTask_t service_event_thread_cb;
+static uint64_t service_event_thread_stack
+    [CONFIG_MSG_EVENT_THREAD_STACK_SIZE / 8];
+
+/**
+ * @brief   Attributes structure for the dispatcher thread.
+ */
+const osThreadAttr_t service_event_thread_attr =
+{
+    .name       = CONFIG_MSG_EVENT_THREAD_NAME,
+    .attr_bits  = osThreadDetached,
+    .cb_mem     = &service_event_thread_cb,
+    .cb_size    = sizeof(service_event_thread_cb),
+    .stack_mem  = service_event_thread_stack,
+    .stack_size = sizeof(service_event_thread_stack),
+    .priority   = CONFIG_MSG_EVENT_THREAD_PRIORITY,
+};
+
+/**
+ * @brief   Deliver one event to the service bus.
+ *
+ * @param   event Pointer to the event.
+ *
+ * @retval  None.
+ */
+static void service_event_dispatch(const service_event_t* event)
+{
+    int32_t ret;
+
+    if (event->svc)
+    {
+        ret = service_unicast_message_prio(event->svc,
+                                           &event->message,
+                                           (service_lane_e)event->lane);
+    }
+    else
+    {
+        ret = service_broadcast_message_prio(&event->message,
+                                             (service_lane_e)event->lane);
+    }
+
+    if (ret)
+    {
+        service_event_handle.stats.fail_count++;
+    }
+    else
+    {
+        service_event_handle.stats.dispatch_count++;
+    }
+
+    /* Drop the reference taken by service_event_post() */
+    payload_release(event->message.payload);
+}
+
+/**
+ * @brief   Dispatcher thread, drain the ring and fan out to services.
+ *
+ * @param   argument Not used.
+ *
+ * @retval  None.
+ *
+ * @note    The thread runs above the services, so the ring is drained before
+ *          the subscribers get to run. A blocking subscriber delays the
+ *          following events by at most its block budget.
+ */
+static void service_event_thread(void* argument)
+{
+    service_event_handle_t* handle = &service_event_handle;
+    service_event_t event;
+    uint32_t depth;
+
+    (void)argument;
+
+    for (;;)
+    {
+        (void)osThreadFlagsWait(SERVICE_EVENT_FLAG,
+                                osFlagsWaitAny,
+                                osWaitForever);
+
+        depth = event_ring_get_used(&handle->ring);
+        if (depth > handle->stats.depth_max)
+        {
+            handle->stats.depth_max = depth;
+        }
+
+        while (!event_ring_get(&handle->ring, &event))
+        {
+            service_event_dispatch(&event);
+        }
+    }
+}
+
+/**
+ * @brief   Post an event to the service bus with constant cost, the
+ *          delivery is deferred to the dispatcher thread.
+ *
+ * @param   svc Pointer to the service handle, NULL to broadcast.
+ * @param   message Message structure to send.
+ * @param   lane Message lane.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    It never blocks and never walks the services, so it is meant for
+ *          interrupts. The ring holds a payload reference until delivery.
+ */
+int32_t service_event_post(const service_t*    svc,
+                           const message_t*    message,
+                           service_lane_e      lane)
+{
+    service_event_handle_t* handle = &service_event_handle;
+    service_event_t event;
+    int32_t ret;
+
+    if (!message)
+    {
+        return -EINVAL;
+    }
+
+    if (lane >= SERVICE_LANE_NUM)
+    {
+        return -EINVAL;
+    }
+
+    if (!handle->thread_id)
+    {
+        return -ENODEV;
+    }
+
+    event.message = *message;
+    event.svc = svc;
+    event.lane = lane;
+
+    (void)payload_hold(message->payload);
+
+    ret = event_ring_put(&handle->ring, &event);
+    if (ret)
+    {
+        payload_release(message->payload);
+        (void)__sync_fetch_and_add(&handle->stats.full_count, 1);
+
+        return ret;
+    }
+
+    (void)__sync_fetch_and_add(&handle->stats.post_count, 1);
+
+    (void)osThreadFlagsSet(handle->thread_id, SERVICE_EVENT_FLAG);
+
+    return 0;
+}
+
+/**
+ * @brief   Check if the event channel is ready to accept events.
+ *
+ * @retval  Returns 1 if ready, 0 otherwise.
+ */
+uint32_t service_event_is_ready(void)
+{
+    return service_event_handle.thread_id ? 1 : 0;
+}
+
+/**
+ * @brief   Check if the caller is the dispatcher thread.
+ *
+ * @retval  Returns 1 if so, 0 otherwise.
+ */
+uint32_t service_event_is_dispatcher(void)
+{
+    if (xPortIsInsideInterrupt() || !service_event_handle.thread_id)
+    {
+        return 0;
+    }
+
+    return (osThreadGetId() == service_event_handle.thread_id) ? 1 : 0;
+}
+
+/**
+ * @brief   Get the event channel statistics.
+ *
+ * @retval  Statistics for reference.
+ */
+const service_event_stats_t* service_event_get_stats(void)
+{
+    return &service_event_handle.stats;
+}
+
+/**
+ * @brief   Probe the event channel.
+ *
+ * @param   obj Pointer to the event channel object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_event_probe(const object* obj)
+{
+    service_event_handle_t* handle = &service_event_handle;
+    int32_t ret;
+
+    (void)memset(handle, 0, sizeof(service_event_handle_t));
+
+    ret = event_ring_init(&handle->ring,
+                          service_event_seq,
+                          service_event_item,
+                          sizeof(service_event_t),
+                          CONFIG_MSG_EVENT_RING_SIZE);
+    if (ret)
+    {
+        pr_error("Object <%s> ring size %d is not a power of two.",
+                 obj->name,
+                 CONFIG_MSG_EVENT_RING_SIZE);
+        return ret;
+    }
+
+    handle->thread_id = osThreadNew(service_event_thread,
+                                    NULL,
+                                    &service_event_thread_attr);
+    if (!handle->thread_id)
+    {
+        pr_error("Object <%s> create thread <%s> failed.",
+                 obj->name,
+                 service_event_thread_attr.name);
+        return -ENOMEM;
+    }
+
+    pr_info("Object <%s> probe succeed.", obj->name);
+
+    return 0;
+}
+
+module_core(CONFIG_MSG_EVENT_NAME,
+            CONFIG_MSG_EVENT_LABEL,
+            service_event_probe,
+            NULL,
+            NULL, NULL, NULL);
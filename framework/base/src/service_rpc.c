@@ -0,0 +1,535 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "framework.h"
+
+/**
+ * The correlation ID carries the slot index in the low bits and a sequence
+ * number in the high bits, so it is never zero and a late reply never
+ * matches a reused slot.
+ */
+#define SERVICE_RPC_INDEX_BITS  8
+#define SERVICE_RPC_INDEX_MASK  ((1UL << SERVICE_RPC_INDEX_BITS) - 1)
+#define SERVICE_RPC_SEQ_MASK    ((1UL << (32 - SERVICE_RPC_INDEX_BITS)) - 1)
+
+/**
+ * @brief   Reply slot definition.
+ */
+typedef struct
+{
+    uint32_t                correlation;    /* Zero if the slot is free */
+    uint32_t                replied;
+    osThreadId_t            thread_id;
+    service_reply_clbk_t    clbk;
+    const void*             user_ctx;
+    message_t               reply;
+} service_rpc_slot_t;
+
+/**
+ * @brief   Request handle definition.
+ */
+typedef struct
+{
+    service_rpc_slot_t  slot[CONFIG_MSG_RPC_SLOT_NUM];
+    uint32_t            sequence;
+    service_rpc_stats_t stats;
+} service_rpc_handle_t;
+
+static service_rpc_handle_t service_rpc_handle;
+
+/**
+ * @brief   Enter the critical section from thread or interrupt.
+ *
+ * @retval  Returns the interrupt mask to restore.
+ */
+static inline uint32_t service_rpc_lock(void)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        return taskENTER_CRITICAL_FROM_ISR();
+    }
+
+    taskENTER_CRITICAL();
+
+    return 0;
+}
+
+/**
+ * @brief   Exit the critical section from thread or interrupt.
+ *
+ * @param   isrm The interrupt mask returned by service_rpc_lock().
+ *
+ * @retval  None.
+ */
+static inline void service_rpc_unlock(uint32_t isrm)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        taskEXIT_CRITICAL_FROM_ISR(isrm);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief   Get the reply slot by correlation ID.
+ *
+ * @param   correlation Correlation ID.
+ *
+ * @retval  Reply slot for reference or NULL in case of error.
+ */
+static inline service_rpc_slot_t* service_rpc_get_slot(uint32_t correlation)
+{
+    uint32_t index = correlation & SERVICE_RPC_INDEX_MASK;
+
+    if (!correlation || index >= CONFIG_MSG_RPC_SLOT_NUM)
+    {
+        return NULL;
+    }
+
+    return &service_rpc_handle.slot[index];
+}
+
+/**
+ * @brief   Allocate a reply slot.
+ *
+ * @param   thread_id Thread to wake up on reply, NULL if using callback.
+ * @param   clbk Reply callback, NULL if waiting.
+ * @param   user_ctx User context of the callback.
+ *
+ * @retval  Returns the correlation ID, 0 if no free slot.
+ */
+static uint32_t service_rpc_alloc_slot(osThreadId_t          thread_id,
+                                       service_reply_clbk_t  clbk,
+                                       const void*           user_ctx)
+{
+    service_rpc_slot_t* slot;
+    uint32_t correlation = 0;
+    uint32_t isrm;
+    uint32_t i;
+
+    isrm = service_rpc_lock();
+
+    for (i = 0; i < CONFIG_MSG_RPC_SLOT_NUM; i++)
+    {
+        slot = &service_rpc_handle.slot[i];
+
+        if (slot->correlation)
+        {
+            continue;
+        }
+
+        service_rpc_handle.sequence =
+            (service_rpc_handle.sequence + 1) & SERVICE_RPC_SEQ_MASK;
+        if (!service_rpc_handle.sequence)
+        {
+            service_rpc_handle.sequence = 1;
+        }
+
+        correlation =
+            (service_rpc_handle.sequence << SERVICE_RPC_INDEX_BITS) | i;
+
+        slot->correlation = correlation;
+        slot->replied = 0;
+        slot->thread_id = thread_id;
+        slot->clbk = clbk;
+        slot->user_ctx = user_ctx;
+
+        service_rpc_handle.stats.request_count++;
+
+        break;
+    }
+
+    if (!correlation)
+    {
+        service_rpc_handle.stats.busy_count++;
+    }
+
+    service_rpc_unlock(isrm);
+
+    return correlation;
+}
+
+/**
+ * @brief   Free the reply slot.
+ *
+ * @param   correlation Correlation ID of the slot.
+ *
+ * @retval  None.
+ */
+static void service_rpc_free_slot(uint32_t correlation)
+{
+    service_rpc_slot_t* slot = service_rpc_get_slot(correlation);
+    uint32_t isrm;
+
+    isrm = service_rpc_lock();
+
+    if (slot->correlation == correlation)
+    {
+        slot->correlation = 0;
+    }
+
+    service_rpc_unlock(isrm);
+}
+
+/**
+ * @brief   Check if the caller runs the thread which serves the service.
+ *
+ * @param   svc Pointer to the service handle.
+ *
+ * @retval  Returns 1 if waiting would deadlock, 0 otherwise.
+ *
+ * @note    A pool worker never waits for a pool service, the worker it
+ *          needs may be the one which is waiting.
+ */
+static uint32_t service_rpc_is_self(const service_t* svc)
+{
+    const service_config_t* config;
+    osThreadId_t thread_id = osThreadGetId();
+    osThreadId_t worker_id;
+    uint32_t i;
+
+    if (svc->thread_id == thread_id)
+    {
+        return 1;
+    }
+
+    if (!svc->owner)
+    {
+        return 0;
+    }
+
+    config = (const service_config_t*)svc->owner->object_config;
+    if (config->backend != SERVICE_BACKEND_POOL)
+    {
+        return 0;
+    }
+
+    for (i = 0; (worker_id = service_get_pool_worker(i)) != NULL; i++)
+    {
+        if (worker_id == thread_id)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Send a request to the service and wait for the reply.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   request Request message to send.
+ * @param   reply Returns the reply message, the caller owns its payload.
+ * @param   timeout_ms Time to wait for the reply in milliseconds,
+ *          osWaitForever to wait without limit.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The caller sleeps on SERVICE_FLAG_REPLY, the replier wakes it up
+ *          directly, so the request costs exactly one round trip.
+ */
+int32_t service_request_message(const service_t* svc,
+                                const message_t* request,
+                                message_t*       reply,
+                                uint32_t         timeout_ms)
+{
+    service_rpc_slot_t* slot;
+    message_t message;
+    uint32_t correlation;
+    uint32_t start_tick;
+    uint32_t timeout;
+    uint32_t elapsed;
+    uint32_t isrm;
+    int32_t ret;
+
+    if (!svc || !request || !reply)
+    {
+        return -EINVAL;
+    }
+
+    if (xPortIsInsideInterrupt())
+    {
+        return -EPERM;
+    }
+
+    /* The service can not reply while its own thread is waiting */
+    if (service_rpc_is_self(svc))
+    {
+        return -EDEADLK;
+    }
+
+    correlation = service_rpc_alloc_slot(osThreadGetId(), NULL, NULL);
+    if (!correlation)
+    {
+        return -EBUSY;
+    }
+
+    slot = service_rpc_get_slot(correlation);
+
+    message = *request;
+    message.correlation = correlation;
+
+    /* Drop a wakeup left by a late reply to a former request */
+    (void)osThreadFlagsClear(SERVICE_FLAG_REPLY);
+
+    ret = service_unicast_message(svc, &message);
+    if (ret)
+    {
+        service_rpc_free_slot(correlation);
+        return ret;
+    }
+
+    if (timeout_ms == osWaitForever)
+    {
+        timeout = osWaitForever;
+    }
+    else
+    {
+        timeout = timeout_ms * osKernelGetTickFreq() / 1000;
+    }
+
+    start_tick = osKernelGetTickCount();
+
+    while (1)
+    {
+        elapsed = osKernelGetTickCount() - start_tick;
+
+        isrm = service_rpc_lock();
+
+        if (slot->replied)
+        {
+            *reply = slot->reply;
+            slot->correlation = 0;
+
+            service_rpc_unlock(isrm);
+
+            return 0;
+        }
+
+        if (timeout != osWaitForever && elapsed >= timeout)
+        {
+            slot->correlation = 0;
+            service_rpc_handle.stats.timeout_count++;
+
+            service_rpc_unlock(isrm);
+
+            return -ETIMEDOUT;
+        }
+
+        service_rpc_unlock(isrm);
+
+        (void)osThreadFlagsWait(SERVICE_FLAG_REPLY,
+                                osFlagsWaitAny,
+                                (timeout == osWaitForever) ?
+                                osWaitForever : (timeout - elapsed));
+    }
+}
+
+/**
+ * @brief   Send a request to the service, the reply is delivered to the
+ *          callback.
+ *
+ * @param   svc Pointer to the service handle.
+ * @param   request Request message to send.
+ * @param   clbk Reply callback.
+ * @param   user_ctx User context of the callback.
+ * @param   correlation Returns the correlation ID, it can be NULL.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The slot is held until the reply arrives, a request which may
+ *          never be answered must be cancelled by service_cancel_request().
+ */
+int32_t service_request_message_async(const service_t*      svc,
+                                      const message_t*      request,
+                                      service_reply_clbk_t  clbk,
+                                      const void*           user_ctx,
+                                      uint32_t*             correlation)
+{
+    message_t message;
+    uint32_t id;
+    int32_t ret;
+
+    if (!svc || !request || !clbk)
+    {
+        return -EINVAL;
+    }
+
+    id = service_rpc_alloc_slot(NULL, clbk, user_ctx);
+    if (!id)
+    {
+        return -EBUSY;
+    }
+
+    message = *request;
+    message.correlation = id;
+
+    ret = service_unicast_message(svc, &message);
+    if (ret)
+    {
+        service_rpc_free_slot(id);
+        return ret;
+    }
+
+    if (correlation)
+    {
+        *correlation = id;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Cancel a pending request.
+ *
+ * @param   correlation Correlation ID of the request.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_cancel_request(uint32_t correlation)
+{
+    service_rpc_slot_t* slot = service_rpc_get_slot(correlation);
+    payload_t* payload = NULL;
+    uint32_t isrm;
+
+    if (!slot)
+    {
+        return -EINVAL;
+    }
+
+    isrm = service_rpc_lock();
+
+    if (slot->correlation != correlation)
+    {
+        service_rpc_unlock(isrm);
+        return -ESRCH;
+    }
+
+    if (slot->replied)
+    {
+        payload = slot->reply.payload;
+    }
+
+    slot->correlation = 0;
+    service_rpc_handle.stats.timeout_count++;
+
+    service_rpc_unlock(isrm);
+
+    payload_release(payload);
+
+    return 0;
+}
+
+/**
+ * @brief   Reply to a request.
+ *
+ * @param   request Pointer to the received request.
+ * @param   reply Reply message to send.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The reply is copied into the slot of the requester, no allocation
+ *          or queue is involved. A reply to a request which timed out or was
+ *          cancelled returns -ESRCH.
+ */
+int32_t service_reply_message(const message_t* request,
+                              const message_t* reply)
+{
+    service_rpc_slot_t* slot;
+    service_reply_clbk_t clbk;
+    const void* user_ctx;
+    osThreadId_t thread_id;
+    message_t message;
+    uint32_t isrm;
+
+    if (!request || !reply)
+    {
+        return -EINVAL;
+    }
+
+    slot = service_rpc_get_slot(request->correlation);
+    if (!slot)
+    {
+        return -EINVAL;
+    }
+
+    message = *reply;
+    message.correlation = request->correlation;
+
+    (void)payload_hold(message.payload);
+
+    isrm = service_rpc_lock();
+
+    if (slot->correlation != request->correlation || slot->replied)
+    {
+        service_rpc_handle.stats.stale_count++;
+
+        service_rpc_unlock(isrm);
+
+        payload_release(message.payload);
+
+        return -ESRCH;
+    }
+
+    service_rpc_handle.stats.reply_count++;
+
+    thread_id = slot->thread_id;
+    clbk = slot->clbk;
+    user_ctx = slot->user_ctx;
+
+    if (clbk)
+    {
+        /* The callback owns the reply, the slot is free for reuse */
+        slot->correlation = 0;
+    }
+    else
+    {
+        slot->reply = message;
+        slot->replied = 1;
+    }
+
+    service_rpc_unlock(isrm);
+
+    if (clbk)
+    {
+        clbk(&message, user_ctx);
+        payload_release(message.payload);
+    }
+    else
+    {
+        (void)osThreadFlagsSet(thread_id, SERVICE_FLAG_REPLY);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Get the request statistics.
+ *
+ * @retval  Returns the request statistics.
+ */
+const service_rpc_stats_t* service_rpc_get_stats(void)
+{
+    return &service_rpc_handle.stats;
+}
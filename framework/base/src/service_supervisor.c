@@ -0,0 +1,372 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "framework.h"
+
+#define SERVICE_SUPERVISOR_TIMER_KEY SERVICE_TIMER_KEY(MSG_ID_SYS_BASE, 0)
+
+/**
+ * Report state of the running handler.
+ */
+#define SERVICE_SUPERVISOR_IDLE     0
+#define SERVICE_SUPERVISOR_OVERRUN  1   /* Reported over the budget */
+#define SERVICE_SUPERVISOR_STUCK    2   /* Reported stuck */
+
+/**
+ * @brief   Supervisor handle definition.
+ */
+typedef struct
+{
+    service_supervisor_stats_t  stats;
+} service_supervisor_handle_t;
+
+static service_supervisor_handle_t service_supervisor_handle;
+
+/**
+ * @brief   Start the hardware watchdog.
+ *
+ * @retval  None.
+ *
+ * @note    This process is called when the supervisor is probed, only if
+ *          CONFIG_MSG_SUPERVISOR_WATCHDOG_ENABLE is defined.
+ */
+__weak void service_supervisor_watchdog_start(void)
+{
+    /**
+     * This function should not be modified, when the callback is needed,
+     * please override it on product layer.
+     */
+}
+
+/**
+ * @brief   Refresh the hardware watchdog.
+ *
+ * @retval  None.
+ *
+ * @note    This process is called by every supervisor check which finds no
+ *          stuck handler, only if CONFIG_MSG_SUPERVISOR_WATCHDOG_ENABLE is
+ *          defined.
+ */
+__weak void service_supervisor_watchdog_refresh(void)
+{
+    /**
+     * This function should not be modified, when the callback is needed,
+     * please override it on product layer.
+     */
+}
+
+/**
+ * @brief   Convert milliseconds to system timer cycles.
+ *
+ * @param   millisec Time in milliseconds.
+ *
+ * @retval  Returns the cycles.
+ */
+static inline uint32_t service_supervisor_ms_to_cycles(uint32_t millisec)
+{
+    return millisec * (osKernelGetSysTimerFreq() / 1000);
+}
+
+/**
+ * @brief   Convert system timer cycles to milliseconds.
+ *
+ * @param   cycles Time in system timer cycles.
+ *
+ * @retval  Returns the milliseconds.
+ */
+static inline uint32_t service_supervisor_cycles_to_ms(uint32_t cycles)
+{
+    return cycles / (osKernelGetSysTimerFreq() / 1000);
+}
+
+/**
+ * @brief   Get the handler execution budget of the service.
+ *
+ * @param   obj Pointer to the service object handle.
+ *
+ * @retval  Returns the budget in milliseconds.
+ */
+uint32_t service_supervisor_get_budget_ms(const object* obj)
+{
+    const service_config_t* config =
+        (const service_config_t*)obj->object_config;
+
+    if (config->handler_budget_ms)
+    {
+        return config->handler_budget_ms;
+    }
+
+    return CONFIG_MSG_HANDLER_BUDGET_MS;
+}
+
+/**
+ * @brief   Record an overrun of the service.
+ *
+ * @param   sv Pointer to the supervision state.
+ * @param   id Message ID.
+ * @param   elapsed Handler duration in cycles so far.
+ *
+ * @retval  None.
+ */
+static void service_supervisor_overrun(service_supervisor_t*   sv,
+                                       uint32_t                id,
+                                       uint32_t                elapsed)
+{
+    sv->overrun_count++;
+    sv->overrun_id = id;
+    if (elapsed > sv->overrun_max)
+    {
+        sv->overrun_max = elapsed;
+    }
+
+    service_supervisor_handle.stats.overrun_count++;
+}
+
+/**
+ * @brief   Mark the handler of the service busy with the message.
+ *
+ * @param   obj Pointer to the service object handle.
+ * @param   id Message ID.
+ *
+ * @retval  None.
+ */
+void service_supervisor_enter(const object* obj, uint32_t id)
+{
+    service_t* svc = (service_t*)obj->object_data;
+    service_supervisor_t* sv = &svc->supervisor;
+
+    sv->flagged = SERVICE_SUPERVISOR_IDLE;
+    sv->busy_thread = osThreadGetId();
+    sv->busy_since = osKernelGetSysTimerCount();
+    sv->busy_id = id;
+}
+
+/**
+ * @brief   Mark the handler of the service idle, and report it if it ran
+ *          over the budget unnoticed by the periodic check.
+ *
+ * @param   obj Pointer to the service object handle.
+ *
+ * @retval  None.
+ */
+void service_supervisor_leave(const object* obj)
+{
+    service_t* svc = (service_t*)obj->object_data;
+    service_supervisor_t* sv = &svc->supervisor;
+    uint32_t elapsed = osKernelGetSysTimerCount() - sv->busy_since;
+    uint32_t budget_ms = service_supervisor_get_budget_ms(obj);
+    uint32_t id = sv->busy_id;
+
+    sv->busy_id = 0;
+
+    if (elapsed <= service_supervisor_ms_to_cycles(budget_ms))
+    {
+        return;
+    }
+
+    if (sv->flagged != SERVICE_SUPERVISOR_IDLE)
+    {
+        pr_warning("Service <%s> handler %s(0x%x) finished after %u ms.",
+                   obj->name,
+                   msg_id_to_str(id),
+                   id,
+                   service_supervisor_cycles_to_ms(elapsed));
+        return;
+    }
+
+    service_supervisor_overrun(sv, id, elapsed);
+
+    pr_error("Service <%s> handler %s(0x%x) took %u ms, budget %u ms, "
+             "stack free %u.",
+             obj->name,
+             msg_id_to_str(id),
+             id,
+             service_supervisor_cycles_to_ms(elapsed),
+             budget_ms,
+             osThreadGetStackSpace(osThreadGetId()));
+}
+
+/**
+ * @brief   Check the running handlers of all services, it runs in the timer
+ *          thread which preempts the services.
+ *
+ * @param   key Timer key.
+ * @param   user_ctx Not used.
+ *
+ * @retval  None.
+ *
+ * @note    A handler over its budget is reported once while it still runs.
+ *          A handler over CONFIG_MSG_SUPERVISOR_STUCK_FACTOR times its
+ *          budget is stuck, the hardware watchdog is no longer refreshed.
+ */
+static void service_supervisor_check(uint32_t key, const void* user_ctx)
+{
+    service_supervisor_handle_t* handle = &service_supervisor_handle;
+    service_supervisor_t* sv;
+    service_t* svc;
+    uint32_t budget_ms;
+    uint32_t budget;
+    uint32_t elapsed;
+    uint32_t since;
+    uint32_t stuck = 0;
+    uint32_t id;
+    uint32_t i;
+
+    (void)key;
+    (void)user_ctx;
+
+    handle->stats.check_count++;
+
+    for (i = 0; i < service_get_count(); i++)
+    {
+        svc = service_get_svc_by_index(i);
+        sv = &svc->supervisor;
+
+        id = sv->busy_id;
+        since = sv->busy_since;
+        if (!id || !svc->owner)
+        {
+            continue;
+        }
+
+        /* Stay stuck even if the cycle counter wraps around */
+        if (sv->flagged == SERVICE_SUPERVISOR_STUCK)
+        {
+            stuck = 1;
+            continue;
+        }
+
+        elapsed = osKernelGetSysTimerCount() - since;
+        budget_ms = service_supervisor_get_budget_ms(svc->owner);
+        budget = service_supervisor_ms_to_cycles(budget_ms);
+
+        if (elapsed <= budget)
+        {
+            continue;
+        }
+
+        if (sv->flagged == SERVICE_SUPERVISOR_IDLE)
+        {
+            sv->flagged = SERVICE_SUPERVISOR_OVERRUN;
+
+            service_supervisor_overrun(sv, id, elapsed);
+
+            pr_error("Service <%s> handler %s(0x%x) running for %u ms, "
+                     "budget %u ms, stack free %u.",
+                     svc->owner->name,
+                     msg_id_to_str(id),
+                     id,
+                     service_supervisor_cycles_to_ms(elapsed),
+                     budget_ms,
+                     osThreadGetStackSpace(sv->busy_thread));
+        }
+
+        if (elapsed > budget * CONFIG_MSG_SUPERVISOR_STUCK_FACTOR)
+        {
+            sv->flagged = SERVICE_SUPERVISOR_STUCK;
+            stuck = 1;
+
+            pr_error("Service <%s> handler %s(0x%x) is stuck.",
+                     svc->owner->name,
+                     msg_id_to_str(id),
+                     id);
+        }
+    }
+
+    if (stuck)
+    {
+        handle->stats.stuck_count++;
+        return;
+    }
+
+#ifdef CONFIG_MSG_SUPERVISOR_WATCHDOG_ENABLE
+    service_supervisor_watchdog_refresh();
+
+    handle->stats.refresh_count++;
+#endif
+}
+
+/**
+ * @brief   Get the supervisor statistics.
+ *
+ * @retval  Statistics for reference.
+ */
+const service_supervisor_stats_t* service_supervisor_get_stats(void)
+{
+    return &service_supervisor_handle.stats;
+}
+
+/**
+ * @brief   Probe the supervisor.
+ *
+ * @param   obj Pointer to the supervisor object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_supervisor_probe(const object* obj)
+{
+    int32_t ret;
+
+    (void)memset(&service_supervisor_handle,
+                 0,
+                 sizeof(service_supervisor_handle_t));
+
+    ret = service_timer_start(SERVICE_SUPERVISOR_TIMER_KEY,
+                              CONFIG_MSG_SUPERVISOR_PERIOD_MS,
+                              CONFIG_MSG_SUPERVISOR_PERIOD_MS,
+                              service_supervisor_check,
+                              NULL);
+    if (ret)
+    {
+        pr_error("Object <%s> start timer failed, ret %d.", obj->name, ret);
+        return ret;
+    }
+
+#ifdef CONFIG_MSG_SUPERVISOR_WATCHDOG_ENABLE
+    service_supervisor_watchdog_start();
+#endif
+
+    pr_info("Object <%s> probe succeed.", obj->name);
+
+    return 0;
+}
+
+/**
+ * @brief   Remove the supervisor.
+ *
+ * @param   obj Pointer to the supervisor object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_supervisor_shutdown(const object* obj)
+{
+    (void)service_timer_cancel(SERVICE_SUPERVISOR_TIMER_KEY);
+
+    pr_info("Object <%s> shutdown succeed.", obj->name);
+
+    return 0;
+}
+
+/* Probed with the services, after the timer wheel */
+module_service(CONFIG_MSG_SUPERVISOR_NAME,
+               CONFIG_MSG_SUPERVISOR_LABEL,
+               service_supervisor_probe,
+               service_supervisor_shutdown,
+               NULL, NULL, NULL);
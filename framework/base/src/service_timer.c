@@ -0,0 +1,757 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "framework.h"
+
+#define SERVICE_TIMER_FLAG          0x1
+
+/**
+ * Hierarchical timer wheel, every level has 2^BITS slots and each slot of a
+ * level spans a whole turn of the level below. A timer goes to the lowest
+ * level which covers its delay and moves down when its slot comes around,
+ * so arm, cancel and expiry are all O(1).
+ */
+#define SERVICE_TIMER_LEVEL_BITS    CONFIG_MSG_TIMER_WHEEL_BITS
+#define SERVICE_TIMER_LEVEL_SIZE    (1UL << SERVICE_TIMER_LEVEL_BITS)
+#define SERVICE_TIMER_LEVEL_MASK    (SERVICE_TIMER_LEVEL_SIZE - 1)
+#define SERVICE_TIMER_LEVEL_NUM     4
+#define SERVICE_TIMER_MAX_TICKS \
+    ((1UL << (SERVICE_TIMER_LEVEL_BITS * SERVICE_TIMER_LEVEL_NUM)) - 1)
+
+#define service_timer_level_shift(level) \
+    ((level) * SERVICE_TIMER_LEVEL_BITS)
+#define service_timer_level_index(tick, level) \
+    (((tick) >> service_timer_level_shift(level)) & SERVICE_TIMER_LEVEL_MASK)
+
+/**
+ * @brief   Timer definition.
+ */
+typedef struct service_timer
+{
+    struct service_timer*   next;
+    struct service_timer**  pprev;      /* Link which points to this timer */
+    struct service_timer*   hash_next;
+
+    uint32_t                key;        /* Zero if the timer is free */
+    uint32_t                expires;    /* Wheel tick to expire */
+    uint32_t                period;     /* Wheel ticks, zero if one-shot */
+
+    const service_t*        svc;
+    message_t               message;
+    service_timer_clbk_t    clbk;
+    const void*             user_ctx;
+} service_timer_t;
+
+/**
+ * @brief   Timer wheel handle definition.
+ */
+typedef struct
+{
+    service_timer_t*        wheel[SERVICE_TIMER_LEVEL_NUM]
+                                 [SERVICE_TIMER_LEVEL_SIZE];
+    service_timer_t*        hash[CONFIG_MSG_TIMER_NUM];
+    service_timer_t*        free;
+
+    uint32_t                now;        /* Current wheel tick */
+    uint32_t                last_tick;  /* Kernel tick of the wheel tick */
+    uint32_t                tick_freq;  /* Kernel ticks per wheel tick */
+
+    osThreadId_t            thread_id;
+    service_timer_stats_t   stats;
+} service_timer_handle_t;
+
+static service_timer_handle_t service_timer_handle;
+
+/**
+ * @brief   Static memory of the timers and the timer thread.
+ */
+static service_timer_t service_timer_pool[CONFIG_MSG_TIMER_NUM];
+static StaticTask_t service_timer_thread_cb;
+static uint64_t service_timer_thread_stack
+    [CONFIG_MSG_TIMER_THREAD_STACK_SIZE / 8];
+
+/**
+ * @brief   Attributes structure for the timer thread.
+ */
+const osThreadAttr_t service_timer_thread_attr =
+{
+    .name       = CONFIG_MSG_TIMER_THREAD_NAME,
+    .attr_bits  = osThreadDetached,
+    .cb_mem     = &service_timer_thread_cb,
+    .cb_size    = sizeof(service_timer_thread_cb),
+    .stack_mem  = service_timer_thread_stack,
+    .stack_size = sizeof(service_timer_thread_stack),
+    .priority   = CONFIG_MSG_TIMER_THREAD_PRIORITY,
+};
+
+/**
+ * @brief   Enter the critical section from thread or interrupt.
+ *
+ * @retval  Returns the interrupt mask to restore.
+ */
+static inline uint32_t service_timer_lock(void)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        return taskENTER_CRITICAL_FROM_ISR();
+    }
+
+    taskENTER_CRITICAL();
+
+    return 0;
+}
+
+/**
+ * @brief   Exit the critical section from thread or interrupt.
+ *
+ * @param   isrm The interrupt mask returned by service_timer_lock().
+ *
+ * @retval  None.
+ */
+static inline void service_timer_unlock(uint32_t isrm)
+{
+    if (xPortIsInsideInterrupt())
+    {
+        taskEXIT_CRITICAL_FROM_ISR(isrm);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief   Convert milliseconds to wheel ticks, rounded up.
+ *
+ * @param   millisec Time in milliseconds.
+ *
+ * @retval  Returns the wheel ticks, at least one.
+ */
+static inline uint32_t service_timer_ms_to_ticks(uint32_t millisec)
+{
+    uint32_t ticks = (millisec + CONFIG_MSG_TIMER_TICK_MS - 1) /
+                     CONFIG_MSG_TIMER_TICK_MS;
+
+    if (!ticks)
+    {
+        return 1;
+    }
+
+    if (ticks > SERVICE_TIMER_MAX_TICKS)
+    {
+        return SERVICE_TIMER_MAX_TICKS;
+    }
+
+    return ticks;
+}
+
+/**
+ * @brief   Link the timer into the wheel slot which covers its expiry.
+ *
+ * @param   timer Pointer to the timer.
+ *
+ * @retval  None.
+ */
+static void service_timer_wheel_add(service_timer_t* timer)
+{
+    service_timer_handle_t* handle = &service_timer_handle;
+    service_timer_t** slot;
+    uint32_t delta = timer->expires - handle->now;
+    uint32_t level;
+
+    for (level = 0; level < SERVICE_TIMER_LEVEL_NUM - 1; level++)
+    {
+        if (delta < (1UL << service_timer_level_shift(level + 1)))
+        {
+            break;
+        }
+    }
+
+    slot = &handle->wheel[level][service_timer_level_index(timer->expires,
+                                                           level)];
+
+    timer->next = *slot;
+    timer->pprev = slot;
+    if (*slot)
+    {
+        (*slot)->pprev = &timer->next;
+    }
+    *slot = timer;
+}
+
+/**
+ * @brief   Unlink the timer from its wheel slot.
+ *
+ * @param   timer Pointer to the timer.
+ *
+ * @retval  None.
+ */
+static void service_timer_wheel_del(service_timer_t* timer)
+{
+    if (!timer->pprev)
+    {
+        return;
+    }
+
+    *timer->pprev = timer->next;
+    if (timer->next)
+    {
+        timer->next->pprev = timer->pprev;
+    }
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * @brief   Find the hash link which points to the timer of the key.
+ *
+ * @param   key Timer key.
+ *
+ * @retval  Returns the link, which points to NULL if the key is not armed.
+ */
+static service_timer_t** service_timer_hash_find(uint32_t key)
+{
+    service_timer_t** link;
+
+    link = &service_timer_handle.hash[key % CONFIG_MSG_TIMER_NUM];
+    while (*link && (*link)->key != key)
+    {
+        link = &(*link)->hash_next;
+    }
+
+    return link;
+}
+
+/**
+ * @brief   Return the timer to the free list, it must be unlinked from the
+ *          wheel already.
+ *
+ * @param   timer Pointer to the timer.
+ *
+ * @retval  None.
+ */
+static void service_timer_free(service_timer_t* timer)
+{
+    service_timer_handle_t* handle = &service_timer_handle;
+    service_timer_t** link = service_timer_hash_find(timer->key);
+
+    *link = timer->hash_next;
+
+    timer->key = 0;
+    timer->hash_next = NULL;
+    timer->next = handle->free;
+    handle->free = timer;
+
+    handle->stats.armed--;
+}
+
+/**
+ * @brief   Arm or re-arm the timer of the key.
+ *
+ * @param   key Timer key.
+ * @param   delay_ms Delay to the first expiry in milliseconds.
+ * @param   period_ms Period in milliseconds, zero for one-shot.
+ * @param   svc Target service, NULL to broadcast, not used with callback.
+ * @param   message Message to post, NULL if using callback.
+ * @param   clbk Timer callback, NULL if posting message.
+ * @param   user_ctx User context of the callback.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    Arming an armed key replaces its timer in place, so a pattern of
+ *          timers is switched without cancelling first.
+ */
+static int32_t service_timer_arm(uint32_t                key,
+                                 uint32_t                delay_ms,
+                                 uint32_t                period_ms,
+                                 const service_t*        svc,
+                                 const message_t*        message,
+                                 service_timer_clbk_t    clbk,
+                                 const void*             user_ctx)
+{
+    service_timer_handle_t* handle = &service_timer_handle;
+    service_timer_t** link;
+    service_timer_t* timer;
+    payload_t* drop = NULL;
+    uint32_t wakeup = 0;
+    uint32_t isrm;
+
+    if (!key)
+    {
+        return -EINVAL;
+    }
+
+    if (!handle->thread_id)
+    {
+        return -ENODEV;
+    }
+
+    /* The armed timer owns a reference of the message payload */
+    if (message)
+    {
+        (void)payload_hold(message->payload);
+    }
+
+    isrm = service_timer_lock();
+
+    link = service_timer_hash_find(key);
+    timer = *link;
+    if (timer)
+    {
+        service_timer_wheel_del(timer);
+
+        drop = timer->message.payload;
+    }
+    else
+    {
+        timer = handle->free;
+        if (!timer)
+        {
+            handle->stats.busy_count++;
+
+            service_timer_unlock(isrm);
+
+            if (message)
+            {
+                payload_release(message->payload);
+            }
+
+            return -ENOMEM;
+        }
+
+        handle->free = timer->next;
+
+        timer->key = key;
+        timer->hash_next = NULL;
+        *link = timer;
+
+        if (!handle->stats.armed)
+        {
+            /* The wheel was idle, restart it from now */
+            handle->last_tick = osKernelGetTickCount();
+            wakeup = 1;
+        }
+
+        handle->stats.armed++;
+        if (handle->stats.armed > handle->stats.armed_max)
+        {
+            handle->stats.armed_max = handle->stats.armed;
+        }
+    }
+
+    timer->expires = handle->now + service_timer_ms_to_ticks(delay_ms);
+    timer->period = period_ms ? service_timer_ms_to_ticks(period_ms) : 0;
+    timer->svc = svc;
+    timer->clbk = clbk;
+    timer->user_ctx = user_ctx;
+
+    if (message)
+    {
+        timer->message = *message;
+    }
+    else
+    {
+        (void)memset(&timer->message, 0, sizeof(message_t));
+    }
+
+    service_timer_wheel_add(timer);
+
+    service_timer_unlock(isrm);
+
+    payload_release(drop);
+
+    if (wakeup)
+    {
+        (void)osThreadFlagsSet(handle->thread_id, SERVICE_TIMER_FLAG);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Move the timers of the current slot of a level down the wheel.
+ *
+ * @param   level Wheel level, above zero.
+ *
+ * @retval  None.
+ */
+static void service_timer_cascade(uint32_t level)
+{
+    service_timer_handle_t* handle = &service_timer_handle;
+    service_timer_t** slot;
+    service_timer_t* timer;
+
+    slot = &handle->wheel[level][service_timer_level_index(handle->now,
+                                                           level)];
+
+    while (*slot)
+    {
+        timer = *slot;
+
+        service_timer_wheel_del(timer);
+        service_timer_wheel_add(timer);
+
+        handle->stats.cascade_count++;
+    }
+}
+
+/**
+ * @brief   Advance the wheel by one tick and fire the expired timers.
+ *
+ * @retval  None.
+ *
+ * @note    Every expired timer is taken off the wheel under the lock and
+ *          fired without it, so a callback may arm or cancel any timer,
+ *          its own key included.
+ */
+static void service_timer_advance(void)
+{
+    service_timer_handle_t* handle = &service_timer_handle;
+    service_timer_t** slot;
+    service_timer_t* timer;
+    const service_t* svc;
+    message_t message;
+    service_timer_clbk_t clbk;
+    const void* user_ctx;
+    uint32_t key;
+    uint32_t level;
+    uint32_t isrm;
+
+    isrm = service_timer_lock();
+
+    handle->now++;
+
+    for (level = 1; level < SERVICE_TIMER_LEVEL_NUM; level++)
+    {
+        if (handle->now & ((1UL << service_timer_level_shift(level)) - 1))
+        {
+            break;
+        }
+
+        service_timer_cascade(level);
+    }
+
+    slot = &handle->wheel[0][service_timer_level_index(handle->now, 0)];
+
+    while (*slot)
+    {
+        timer = *slot;
+
+        service_timer_wheel_del(timer);
+
+        key = timer->key;
+        svc = timer->svc;
+        message = timer->message;
+        clbk = timer->clbk;
+        user_ctx = timer->user_ctx;
+
+        if (timer->period)
+        {
+            /* The delivery owns a reference, the timer keeps its own */
+            (void)payload_hold(message.payload);
+
+            timer->expires += timer->period;
+            service_timer_wheel_add(timer);
+        }
+        else
+        {
+            /* The reference of the timer is handed over to the delivery */
+            service_timer_free(timer);
+        }
+
+        handle->stats.fire_count++;
+
+        service_timer_unlock(isrm);
+
+        if (clbk)
+        {
+            clbk(key, user_ctx);
+        }
+        else if (svc)
+        {
+            (void)service_unicast_message(svc, &message);
+        }
+        else
+        {
+            (void)service_broadcast_message(&message);
+        }
+
+        payload_release(message.payload);
+
+        isrm = service_timer_lock();
+    }
+
+    service_timer_unlock(isrm);
+}
+
+/**
+ * @brief   Timer thread, advance the wheel while any timer is armed.
+ *
+ * @param   argument Not used.
+ *
+ * @retval  None.
+ *
+ * @note    The thread sleeps forever while the wheel is empty, so an idle
+ *          system has no periodic wakeup. A late wakeup catches up with all
+ *          of the elapsed wheel ticks.
+ */
+static void service_timer_thread(void* argument)
+{
+    service_timer_handle_t* handle = &service_timer_handle;
+    uint32_t elapsed;
+    uint32_t timeout;
+    uint32_t ticks;
+    uint32_t isrm;
+
+    (void)argument;
+
+    for (;;)
+    {
+        isrm = service_timer_lock();
+
+        if (handle->stats.armed)
+        {
+            elapsed = osKernelGetTickCount() - handle->last_tick;
+            timeout = (elapsed < handle->tick_freq) ?
+                      (handle->tick_freq - elapsed) : 0;
+        }
+        else
+        {
+            timeout = osWaitForever;
+        }
+
+        service_timer_unlock(isrm);
+
+        if (timeout)
+        {
+            (void)osThreadFlagsWait(SERVICE_TIMER_FLAG,
+                                    osFlagsWaitAny,
+                                    timeout);
+        }
+
+        isrm = service_timer_lock();
+
+        ticks = (osKernelGetTickCount() - handle->last_tick) /
+                handle->tick_freq;
+        handle->last_tick += ticks * handle->tick_freq;
+
+        service_timer_unlock(isrm);
+
+        while (ticks--)
+        {
+            service_timer_advance();
+        }
+    }
+}
+
+/**
+ * @brief   Post a message to a service after a delay.
+ *
+ * @param   svc Pointer to the service handle, NULL to broadcast.
+ * @param   message Message structure to send.
+ * @param   delay_ms Delay in milliseconds.
+ * @param   key Timer key, re-posting with an armed key replaces it.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_post_delayed(const service_t*   svc,
+                             const message_t*   message,
+                             uint32_t           delay_ms,
+                             uint32_t           key)
+{
+    if (!message)
+    {
+        return -EINVAL;
+    }
+
+    if (svc && svc->stopping)
+    {
+        return -EPERM;
+    }
+
+    return service_timer_arm(key, delay_ms, 0, svc, message, NULL, NULL);
+}
+
+/**
+ * @brief   Post a message to a service periodically until cancelled.
+ *
+ * @param   svc Pointer to the service handle, NULL to broadcast.
+ * @param   message Message structure to send.
+ * @param   period_ms Period in milliseconds.
+ * @param   key Timer key, re-posting with an armed key replaces it.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_post_periodic(const service_t*  svc,
+                              const message_t*  message,
+                              uint32_t          period_ms,
+                              uint32_t          key)
+{
+    if (!message || !period_ms)
+    {
+        return -EINVAL;
+    }
+
+    if (svc && svc->stopping)
+    {
+        return -EPERM;
+    }
+
+    return service_timer_arm(key,
+                             period_ms,
+                             period_ms,
+                             svc,
+                             message,
+                             NULL,
+                             NULL);
+}
+
+/**
+ * @brief   Start a timer which calls back in the timer thread.
+ *
+ * @param   key Timer key, starting an armed key replaces it.
+ * @param   delay_ms Delay to the first expiry in milliseconds.
+ * @param   period_ms Period in milliseconds, zero for one-shot.
+ * @param   clbk Timer callback.
+ * @param   user_ctx User context of the callback.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    It never blocks, so it can be called from interrupt.
+ */
+int32_t service_timer_start(uint32_t                key,
+                            uint32_t                delay_ms,
+                            uint32_t                period_ms,
+                            service_timer_clbk_t    clbk,
+                            const void*             user_ctx)
+{
+    if (!clbk)
+    {
+        return -EINVAL;
+    }
+
+    return service_timer_arm(key,
+                             delay_ms,
+                             period_ms,
+                             NULL,
+                             NULL,
+                             clbk,
+                             user_ctx);
+}
+
+/**
+ * @brief   Cancel the timer of the key.
+ *
+ * @param   key Timer key.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t service_timer_cancel(uint32_t key)
+{
+    service_timer_t* timer;
+    payload_t* drop;
+    uint32_t isrm;
+
+    if (!key)
+    {
+        return -EINVAL;
+    }
+
+    isrm = service_timer_lock();
+
+    timer = *service_timer_hash_find(key);
+    if (!timer)
+    {
+        service_timer_unlock(isrm);
+
+        return -ENOENT;
+    }
+
+    drop = timer->message.payload;
+
+    service_timer_wheel_del(timer);
+    service_timer_free(timer);
+
+    service_timer_unlock(isrm);
+
+    payload_release(drop);
+
+    return 0;
+}
+
+/**
+ * @brief   Get the timer statistics.
+ *
+ * @retval  Statistics for reference.
+ */
+const service_timer_stats_t* service_timer_get_stats(void)
+{
+    return &service_timer_handle.stats;
+}
+
+/**
+ * @brief   Probe the timer wheel.
+ *
+ * @param   obj Pointer to the timer wheel object handle.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t service_timer_probe(const object* obj)
+{
+    service_timer_handle_t* handle = &service_timer_handle;
+    uint32_t i;
+
+    (void)memset(handle, 0, sizeof(service_timer_handle_t));
+    (void)memset(service_timer_pool, 0, sizeof(service_timer_pool));
+
+    for (i = 0; i < CONFIG_MSG_TIMER_NUM; i++)
+    {
+        service_timer_pool[i].next = handle->free;
+        handle->free = &service_timer_pool[i];
+    }
+
+    handle->tick_freq = CONFIG_MSG_TIMER_TICK_MS * osKernelGetTickFreq() / 1000;
+    if (!handle->tick_freq)
+    {
+        handle->tick_freq = 1;
+    }
+
+    handle->thread_id = osThreadNew(service_timer_thread,
+                                    NULL,
+                                    &service_timer_thread_attr);
+    if (!handle->thread_id)
+    {
+        pr_error("Object <%s> create thread <%s> failed.",
+                 obj->name,
+                 service_timer_thread_attr.name);
+        return -ENOMEM;
+    }
+
+    pr_info("Object <%s> probe succeed.", obj->name);
+
+    return 0;
+}
+
+module_core(CONFIG_MSG_TIMER_NAME,
+            CONFIG_MSG_TIMER_LABEL,
+            service_timer_probe,
+            NULL,
+            NULL, NULL, NULL);
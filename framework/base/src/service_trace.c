@@ -0,0 +1,144 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cmsis_os.h"
+#include "framework.h"
+
+#ifdef CONFIG_MSG_TRACE_ENABLE
+
+/**
+ * @brief   Convert system timer cycles to microseconds.
+ *
+ * @param   cycles System timer cycles.
+ *
+ * @retval  Returns the microseconds.
+ */
+uint32_t service_trace_cycles_to_us(uint32_t cycles)
+{
+    return cycles / (osKernelGetSysTimerFreq() / 1000000);
+}
+
+/**
+ * @brief   Get the histogram bucket of the value.
+ *
+ * @param   cycles Value in system timer cycles.
+ *
+ * @retval  Returns the bucket index.
+ */
+static inline uint32_t service_trace_bucket(uint32_t cycles)
+{
+    uint32_t us = service_trace_cycles_to_us(cycles);
+    uint32_t bucket = 0;
+
+    while (us > 1 && bucket < SERVICE_TRACE_BUCKET_NUM - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/**
+ * @brief   Add a value to the trace metric.
+ *
+ * @param   metric Pointer to the trace metric.
+ * @param   count Number of values already in the metric.
+ * @param   cycles Value in system timer cycles.
+ *
+ * @retval  None.
+ */
+static inline void service_trace_update(service_trace_metric_t*   metric,
+                                        uint32_t                  count,
+                                        uint32_t                  cycles)
+{
+    if (!count || cycles < metric->min)
+    {
+        metric->min = cycles;
+    }
+
+    if (cycles > metric->max)
+    {
+        metric->max = cycles;
+    }
+
+    metric->sum += cycles;
+    metric->histogram[service_trace_bucket(cycles)]++;
+}
+
+/**
+ * @brief   Record a handled message.
+ *
+ * @param   trace Pointer to the trace of the service.
+ * @param   id Message ID.
+ * @param   queue_cycles Cycles from enqueue to dequeue.
+ * @param   handler_cycles Cycles spent in the handler.
+ *
+ * @retval  None.
+ *
+ * @note    It is only called from the service thread.
+ */
+void service_trace_record(service_trace_t*  trace,
+                          uint32_t          id,
+                          uint32_t          queue_cycles,
+                          uint32_t          handler_cycles)
+{
+    service_trace_entry_t* entry;
+    uint32_t i;
+
+    for (i = 0; i < CONFIG_MSG_TRACE_ID_NUM; i++)
+    {
+        entry = &trace->entry[i];
+
+        if (!entry->count)
+        {
+            entry->id = id;
+        }
+
+        if (entry->id == id)
+        {
+            service_trace_update(&entry->queue, entry->count, queue_cycles);
+            service_trace_update(&entry->handler,
+                                 entry->count,
+                                 handler_cycles);
+            entry->count++;
+            return;
+        }
+    }
+
+    trace->overflow_count++;
+}
+
+/**
+ * @brief   Reset the trace of the service.
+ *
+ * @param   trace Pointer to the trace of the service.
+ *
+ * @retval  None.
+ */
+void service_trace_reset(service_trace_t* trace)
+{
+    taskENTER_CRITICAL();
+
+    (void)memset(trace, 0, sizeof(service_trace_t));
+
+    taskEXIT_CRITICAL();
+}
+
+#endif
@@ -90,6 +90,28 @@ static int32_t button_service_deinit(const object* obj)
     return 0;
 }
 
+/**
+ * @brief   Broadcast the button state to the subscribed services.
+ *
+ * @param   id Button ID.
+ * @param   state Button state.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t button_service_state_notify(button_id_e      id,
+                                           button_state_e   state)
+{
+    message_t message;
+
+    (void)memset(&message, 0, sizeof(message));
+
+    message.id = MSG_ID_BTN_STATE_NOTIFY;
+    message.param0 = id;
+    message.param1 = state;
+
+    return service_broadcast_message(&message);
+}
+
 /**
  * @brief   Handle the button service message.
  *
@@ -111,37 +133,67 @@ static void button_service_message_handler(const object*            obj,
                  message->param1,
                  message->param2,
                  message->param3);
-}
 
-int32_t button_service_state_notify(button_id_e id, button_state_e state)
-{
-    message_t message;
-
-    (void)memset(&message, 0, sizeof(message));
+    switch (message->id)
+    {
+    case MSG_ID_BTN_STATE_CHANGE:
 
-    message.id = MSG_ID_BTN_STATE_NOTIFY;
-    message.param0 = id;
-    message.param1 = state;
+        (void)button_service_state_notify((button_id_e)message->param0,
+                                          (button_state_e)message->param1);
+        break;
 
-    return service_broadcast_message(&message);
+    default:
+        break;
+    }
 }
 
+/**
+ * @brief   Button manager user callback.
+ *
+ * @param   id Button ID.
+ * @param   state Button state.
+ * @param   user_ctx Pointer to the private data.
+ *
+ * @retval  None.
+ *
+ * @note    It runs on the timer thread, the broadcast may block up to
+ *          CONFIG_MSG_BROADCAST_BUDGET_MS, so the state is handed to the
+ *          service thread which broadcasts it. The service keeps its own
+ *          thread, the wait would stall the shared pool workers.
+ */
 static void button_service_user_clbk(button_id_e    id,
                                      button_state_e state,
                                      const void*    user_ctx)
 {
-    (void)user_ctx;
+    const button_service_priv_t* priv_data = user_ctx;
+    message_t message;
 
     button_info("Notify button %d state %s(%d).",
                 id,
                 button_manager_state_to_str(state),
                 state);
 
-    (void)button_service_state_notify(id, state);
+    (void)memset(&message, 0, sizeof(message));
+
+    message.id = MSG_ID_BTN_STATE_CHANGE;
+    message.param0 = id;
+    message.param1 = state;
+
+    (void)service_unicast_message(priv_data->owner_svc, &message);
 }
 
+DECLARE_MESSAGE_DESC(MSG_ID_BTN_STATE_NOTIFY,
+                     BTN_STATE_NOTIFY,
+                     "button_id", "button_state", NULL, NULL);
+
+DECLARE_MESSAGE_DESC(MSG_ID_BTN_STATE_CHANGE,
+                     BTN_STATE_CHANGE,
+                     "button_id", "button_state", NULL, NULL);
+
 static const service_config_t button_service_config =
 {
+    .backend        = CONFIG_BUTTON_SERVICE_BACKEND,
+
     .thread_attr    =
     {
         .name       = CONFIG_BUTTON_SERVICE_THREAD_NAME,
@@ -164,12 +216,36 @@ static const service_config_t button_service_config =
     },
 
     .msg_count      = CONFIG_BUTTON_SERVICE_MSG_COUNT,
+    .urgent_msg_count = 0,
+
+    .subscription       = NULL,
+    .subscription_count = 0,
+
+    .overflow_policy    = SERVICE_OVERFLOW_DROP_NEWEST,
+    .block_budget_ms    = 0,
+
+    .batch_count        = CONFIG_BUTTON_SERVICE_BATCH_COUNT,
+    .batch_begin        = NULL,
+    .batch_end          = NULL,
+
+    .coalesce           = NULL,
+    .coalesce_count     = 0,
+    .mailbox            = NULL,
+    .mailbox_count      = 0,
+
+    .handler_budget_ms  = CONFIG_BUTTON_SERVICE_HANDLER_BUDGET_MS,
 };
 
-DECLARE_SERVICE(CONFIG_BUTTON_SERVICE_NAME,
-                CONFIG_BUTTON_SERVICE_LABEL,
-                &button_service_priv,
-                &button_service_config,
-                button_service_init,
-                button_service_deinit,
-                button_service_message_handler);
+DECLARE_SERVICE_STATIC(CONFIG_BUTTON_SERVICE_NAME,
+                       CONFIG_BUTTON_SERVICE_LABEL,
+                       &button_service_priv,
+                       &button_service_config,
+                       button_service_init,
+                       button_service_deinit,
+                       button_service_message_handler,
+                       CONFIG_BUTTON_SERVICE);
+
+DECLARE_OBJECT_DEPENDENCY(CONFIG_BUTTON_SERVICE_NAME,
+                          CONFIG_BUTTON_SERVICE_LABEL,
+                          CONFIG_BUTTON_MANAGER_NAME,
+                          CONFIG_BUTTON_MANAGER_LABEL);
@@ -22,5 +22,6 @@
 #include "led_manager.h"
 
 extern int32_t led_service_setup(led_id_e id, led_type_e type);
+extern int32_t led_service_get_state(led_id_e id, led_type_e* type);
 
 #endif /* __LED_SERVICE_H__ */
@@ -86,6 +86,7 @@ static void led_service_message_handler(const object*           obj,
                                         const message_t* const  message)
 {
     led_service_priv_t* priv_data = service_get_priv_data(obj);
+    message_t reply;
     led_id_e id;
     led_type_e type;
     int32_t ret;
@@ -125,6 +126,31 @@ static void led_service_message_handler(const object*           obj,
                      type);
         }
 
+        break;
+
+    case MSG_ID_LED_GET_STATE:
+
+        id = (led_id_e)message->param0;
+        type = LED_TYPE_BUTT;
+
+        ret = led_manager_get_type(id, &type);
+
+        (void)memset(&reply, 0, sizeof(reply));
+
+        reply.id = MSG_ID_LED_GET_STATE;
+        reply.param0 = id;
+        reply.param1 = type;
+        reply.param2 = (uint32_t)ret;
+
+        ret = service_reply_message(message, &reply);
+        if (ret)
+        {
+            led_error("Service <%s> reply led %d state failed, ret %d.",
+                      obj->name,
+                      id,
+                      ret);
+        }
+
         break;
     }
 }
@@ -142,8 +168,63 @@ int32_t led_service_setup(led_id_e id, led_type_e type)
     return service_unicast_message(led_service_priv.owner_svc, &message);
 }
 
+int32_t led_service_get_state(led_id_e id, led_type_e* type)
+{
+    message_t request;
+    message_t reply;
+    int32_t ret;
+
+    if (!type)
+    {
+        return -EINVAL;
+    }
+
+    (void)memset(&request, 0, sizeof(request));
+
+    request.id = MSG_ID_LED_GET_STATE;
+    request.param0 = id;
+
+    ret = service_request_message(led_service_priv.owner_svc,
+                                  &request,
+                                  &reply,
+                                  CONFIG_MSG_RPC_TIMEOUT_MS);
+    if (ret)
+    {
+        return ret;
+    }
+
+    payload_release(reply.payload);
+
+    if ((int32_t)reply.param2)
+    {
+        return (int32_t)reply.param2;
+    }
+
+    *type = (led_type_e)reply.param1;
+
+    return 0;
+}
+
+DECLARE_MESSAGE_DESC(MSG_ID_LED_SETUP,
+                     LED_SETUP,
+                     "led_id", "led_type", NULL, NULL);
+DECLARE_MESSAGE_DESC(MSG_ID_LED_GET_STATE,
+                     LED_GET_STATE,
+                     "led_id", "led_type", "ret", NULL);
+
+/* Only the latest setup of each led is worth handling */
+static const service_coalesce_t led_service_coalesce[] =
+{
+    SERVICE_COALESCE_BY_PARAM(MSG_ID_LED_SETUP, 0),
+};
+
+static service_mailbox_slot_t led_service_mailbox
+    [CONFIG_LED_SERVICE_MAILBOX_COUNT];
+
 static const service_config_t led_service_config =
 {
+    .backend        = CONFIG_LED_SERVICE_BACKEND,
+
     .thread_attr    =
     {
         .name       = CONFIG_LED_SERVICE_THREAD_NAME,
@@ -166,15 +247,40 @@ static const service_config_t led_service_config =
     },
 
     .msg_count      = CONFIG_LED_SERVICE_MSG_COUNT,
+    .urgent_msg_count = 0,
+
+    .subscription       = NULL,
+    .subscription_count = 0,
+
+    .overflow_policy    = SERVICE_OVERFLOW_DROP_OLDEST,
+    .block_budget_ms    = 0,
+
+    .batch_count        = CONFIG_LED_SERVICE_BATCH_COUNT,
+    .batch_begin        = NULL,
+    .batch_end          = NULL,
+
+    .coalesce           = led_service_coalesce,
+    .coalesce_count     = sizeof(led_service_coalesce) /
+                          sizeof(led_service_coalesce[0]),
+    .mailbox            = led_service_mailbox,
+    .mailbox_count      = CONFIG_LED_SERVICE_MAILBOX_COUNT,
+
+    .handler_budget_ms  = CONFIG_LED_SERVICE_HANDLER_BUDGET_MS,
 };
 
-DECLARE_SERVICE(CONFIG_LED_SERVICE_NAME,
-                CONFIG_LED_SERVICE_LABEL,
-                &led_service_priv,
-                &led_service_config,
-                led_service_init,
-                led_service_deinit,
-                led_service_message_handler);
+DECLARE_SERVICE_STATIC(CONFIG_LED_SERVICE_NAME,
+                       CONFIG_LED_SERVICE_LABEL,
+                       &led_service_priv,
+                       &led_service_config,
+                       led_service_init,
+                       led_service_deinit,
+                       led_service_message_handler,
+                       CONFIG_LED_SERVICE);
+
+DECLARE_OBJECT_DEPENDENCY(CONFIG_LED_SERVICE_NAME,
+                          CONFIG_LED_SERVICE_LABEL,
+                          CONFIG_LED_MANAGER_NAME,
+                          CONFIG_LED_MANAGER_LABEL);
 
 #ifdef CONFIG_MMI_SERVICE_INTERNAL_COMMAND_ENABLE
 static BaseType_t mmi_command_led_setup(char*       output,
@@ -209,4 +315,48 @@ DECLARE_MMI_COMMAND("led_setup",
                     "\r\nled_setup: led_setup <led_id_e> <led_type_e>\r\n Setup the led on client console.\r\n",
                     mmi_command_led_setup,
                     2);
+
+static BaseType_t mmi_command_led_state(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    const char* param1;
+    BaseType_t length1;
+    led_id_e id;
+    led_type_e type;
+    int32_t ret;
+
+    param1 = FreeRTOS_CLIGetParameter(input, 1, &length1);
+
+    id = (led_id_e)atoi(param1);
+
+    ret = led_service_get_state(id, &type);
+    if (ret)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n%s: \r\n Get led %d state failed, ret %d.\r\n",
+                 input,
+                 id,
+                 ret);
+
+        return pdFALSE;
+    }
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n Led %d type %s(%d).\r\n",
+             input,
+             id,
+             led_manager_type_to_str(type),
+             type);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("led_state",
+                    led_state,
+                    "\r\nled_state: led_state <led_id_e>\r\n Get the led state through the led service.\r\n",
+                    mmi_command_led_state,
+                    1);
 #endif
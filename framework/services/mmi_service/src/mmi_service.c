@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include "cmsis_os.h"
@@ -23,6 +24,7 @@
 #include "framework.h"
 #include "mmi_service.h"
 #include "dbg_cli.h"
+#include "ring_buff.h"
 
 #define mmi_error(str, ...)   pr_error(str, ## __VA_ARGS__)
 #define mmi_warning(str, ...) pr_warning(str, ## __VA_ARGS__)
@@ -75,24 +77,31 @@ static void mmi_service_client_user_clbk(const void* user_ctx)
  * @brief   Register the man-machine command.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The CLI can not unregister a command, so the commands registered
+ *          before a warm restart are kept and not registered again.
  */
 static int32_t mmi_service_register_command(void)
 {
     extern CLI_Command_Definition_t mmi_command$$Base[];
     extern CLI_Command_Definition_t mmi_command$$Limit[];
 
+    static const CLI_Command_Definition_t* registered = NULL;
+
     const CLI_Command_Definition_t* start = mmi_command$$Base;
     const CLI_Command_Definition_t* end = mmi_command$$Limit;
     const CLI_Command_Definition_t* command;
     BaseType_t ret;
 
-    for (command = start; command < end; command++)
+    for (command = registered ? registered : start; command < end; command++)
     {
         ret = FreeRTOS_CLIRegisterCommand(command);
         if (ret != pdPASS)
         {
             return -ENOMEM;
         }
+
+        registered = command + 1;
     }
 
     return 0;
@@ -233,8 +242,19 @@ static void mmi_service_message_handler(const object*           obj,
     }
 }
 
+DECLARE_MESSAGE_DESC(MSG_ID_MMI_CLIENT_INPUT_NOTIFY,
+                     MMI_CLIENT_INPUT_NOTIFY,
+                     "cli_type", NULL, NULL, NULL);
+
+static const service_subscription_t mmi_service_subscription[] =
+{
+    SERVICE_SUBSCRIBE(MSG_ID_SYS_STARTUP_COMPLETED),
+};
+
 static const service_config_t mmi_service_config =
 {
+    .backend        = CONFIG_MMI_SERVICE_BACKEND,
+
     .thread_attr    =
     {
         .name       = CONFIG_MMI_SERVICE_THREAD_NAME,
@@ -257,15 +277,35 @@ static const service_config_t mmi_service_config =
     },
 
     .msg_count      = CONFIG_MMI_SERVICE_MSG_COUNT,
+    .urgent_msg_count = 0,
+
+    .subscription       = mmi_service_subscription,
+    .subscription_count = sizeof(mmi_service_subscription) /
+                          sizeof(mmi_service_subscription[0]),
+
+    .overflow_policy    = SERVICE_OVERFLOW_BLOCK,
+    .block_budget_ms    = 0,
+
+    .batch_count        = CONFIG_MMI_SERVICE_BATCH_COUNT,
+    .batch_begin        = NULL,
+    .batch_end          = NULL,
+
+    .coalesce           = NULL,
+    .coalesce_count     = 0,
+    .mailbox            = NULL,
+    .mailbox_count      = 0,
+
+    .handler_budget_ms  = CONFIG_MMI_SERVICE_HANDLER_BUDGET_MS,
 };
 
-DECLARE_SERVICE(CONFIG_MMI_SERVICE_NAME,
-                CONFIG_MMI_SERVICE_LABEL,
-                &mmi_service_priv,
-                &mmi_service_config,
-                mmi_service_init,
-                mmi_service_deinit,
-                mmi_service_message_handler);
+DECLARE_SERVICE_STATIC(CONFIG_MMI_SERVICE_NAME,
+                       CONFIG_MMI_SERVICE_LABEL,
+                       &mmi_service_priv,
+                       &mmi_service_config,
+                       mmi_service_init,
+                       mmi_service_deinit,
+                       mmi_service_message_handler,
+                       CONFIG_MMI_SERVICE);
 
 #ifdef CONFIG_MMI_SERVICE_INTERNAL_COMMAND_ENABLE
 static BaseType_t mmi_command_version(char*         output,
@@ -289,4 +329,1406 @@ DECLARE_MMI_COMMAND("version",
                     "\r\nversion:\r\n Print certain system version.\r\n",
                     mmi_command_version,
                     0);
+
+static BaseType_t mmi_command_svc_stats(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    static uint32_t index = 0;
+    const service_broadcast_stats_t* bc_stats;
+    const service_t* svc;
+
+    if (index == 0)
+    {
+        bc_stats = service_get_broadcast_stats();
+
+        snprintf(output,
+                 output_size,
+                 "\r\n%s:\r\n broadcast %u, enqueue %u, filter %u, drop %u, "
+                 "max latency %u ticks\r\n",
+                 input,
+                 bc_stats->broadcast_count,
+                 bc_stats->enqueue_count,
+                 bc_stats->filter_count,
+                 bc_stats->drop_count,
+                 bc_stats->latency_max);
+
+        index++;
+
+        return pdTRUE;
+    }
+
+    svc = service_get_svc_by_index(index - 1);
+    if (!svc)
+    {
+        index = 0;
+
+        snprintf(output, output_size, "\r\n");
+
+        return pdFALSE;
+    }
+
+    snprintf(output,
+             output_size,
+             " %u: %-16s enqueue %u, wakeup %u, handle %u, drop %u, "
+             "batch max %u, coalesce %u, credit wait %u, fail %u\r\n",
+             index - 1,
+             svc->owner ? svc->owner->name : "unknown",
+             svc->stats.enqueue_count,
+             svc->stats.wakeup_count,
+             svc->stats.handle_count,
+             svc->stats.drop_count,
+             svc->stats.batch_max,
+             svc->stats.coalesce_count,
+             svc->stats.credit_wait_count,
+             svc->stats.credit_fail_count);
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("svc_stats",
+                    svc_stats,
+                    "\r\nsvc_stats:\r\n Print the service message statistics.\r\n",
+                    mmi_command_svc_stats,
+                    0);
+
+static BaseType_t mmi_command_svc_bench(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    const char* param1;
+    const char* param2;
+    const char* param3;
+    BaseType_t length1;
+    BaseType_t length2;
+    BaseType_t length3;
+    service_t* svc;
+    message_t message;
+    service_lane_e lane;
+    uint32_t count;
+    uint32_t sent;
+    uint32_t handled;
+    uint32_t wakeups;
+    uint32_t handle_count;
+    uint32_t wakeup_count;
+    uint32_t start_tick;
+    uint32_t elapsed_ms;
+    uint32_t i;
+
+    param1 = FreeRTOS_CLIGetParameter(input, 1, &length1);
+    param2 = FreeRTOS_CLIGetParameter(input, 2, &length2);
+    param3 = FreeRTOS_CLIGetParameter(input, 3, &length3);
+
+    svc = service_get_svc_by_index((uint32_t)atoi(param1));
+    count = (uint32_t)atoi(param2);
+    lane = (service_lane_e)atoi(param3);
+
+    if (lane >= SERVICE_LANE_NUM)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n%s: \r\n Invalid lane.\r\n",
+                 input);
+
+        return pdFALSE;
+    }
+
+    if (!svc || !svc->queue_id[lane] || svc == mmi_service_priv.owner_svc)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n%s: \r\n Invalid service.\r\n",
+                 input);
+
+        return pdFALSE;
+    }
+
+    (void)memset(&message, 0, sizeof(message));
+
+    message.id = MSG_ID_SYS_BENCHMARK;
+
+    handle_count = svc->stats.handle_count;
+    wakeup_count = svc->stats.wakeup_count;
+    start_tick = osKernelGetTickCount();
+
+    for (i = 0, sent = 0; i < count; i++)
+    {
+        message.param0 = i;
+
+        /* Throttle on the queue credits instead of dropping on overflow */
+        if (service_reserve_credit(svc,
+                                   lane,
+                                   1,
+                                   CONFIG_MSG_SEND_BLOCK_TIMEOUT_MS))
+        {
+            break;
+        }
+
+        if (!service_unicast_message_credit(svc, &message, lane))
+        {
+            sent++;
+        }
+    }
+
+    /* Wait for the service to handle all of the messages, at most 1s */
+    while (svc->stats.handle_count - handle_count < sent &&
+           osKernelGetTickCount() - start_tick < osKernelGetTickFreq())
+    {
+        osDelay(1);
+    }
+
+    elapsed_ms = (osKernelGetTickCount() - start_tick) * 1000 /
+                 osKernelGetTickFreq();
+    if (!elapsed_ms)
+    {
+        elapsed_ms = 1;
+    }
+
+    handled = svc->stats.handle_count - handle_count;
+    wakeups = svc->stats.wakeup_count - wakeup_count;
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n sent %u, handled %u in %u ms, %u msg/s, "
+             "%u wakeups per 100 msg\r\n",
+             input,
+             sent,
+             handled,
+             elapsed_ms,
+             handled * 1000 / elapsed_ms,
+             handled ? wakeups * 100 / handled : 0);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("svc_bench",
+                    svc_bench,
+                    "\r\nsvc_bench: svc_bench <index> <count> <lane>\r\n Benchmark the message dispatch of a service, throttled by its queue credits.\r\n",
+                    mmi_command_svc_bench,
+                    3);
+
+static BaseType_t mmi_command_svc_lanes(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    static uint32_t index = 0;
+    const service_lane_stats_t* stats;
+    const service_t* svc;
+    uint32_t cycles_per_us = osKernelGetSysTimerFreq() / 1000000;
+    uint32_t lane;
+
+    svc = service_get_svc_by_index(index / SERVICE_LANE_NUM);
+    if (!svc)
+    {
+        index = 0;
+
+        snprintf(output, output_size, "\r\n");
+
+        return pdFALSE;
+    }
+
+    lane = index % SERVICE_LANE_NUM;
+    stats = &svc->stats.lane[lane];
+
+    snprintf(output,
+             output_size,
+             "%s %-16s lane %u: enqueue %u, handle %u, "
+             "latency avg %u us, max %u us, credit %u, reserved %u\r\n",
+             index ? "" : "\r\n",
+             svc->owner ? svc->owner->name : "unknown",
+             lane,
+             stats->enqueue_count,
+             stats->handle_count,
+             stats->handle_count ?
+             (uint32_t)(stats->latency_sum / stats->handle_count) /
+             cycles_per_us : 0,
+             stats->latency_max / cycles_per_us,
+             service_get_credit(svc, (service_lane_e)lane),
+             svc->reserved[lane]);
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("svc_lanes",
+                    svc_lanes,
+                    "\r\nsvc_lanes:\r\n Print the queue latency of each service lane.\r\n",
+                    mmi_command_svc_lanes,
+                    0);
+
+#ifdef CONFIG_MSG_TRACE_ENABLE
+static BaseType_t mmi_command_svc_trace(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    static uint32_t index = 0;
+    const service_trace_entry_t* entry;
+    const service_trace_metric_t* metric;
+    const service_t* svc;
+    uint32_t length;
+    uint32_t i;
+
+    /* Two lines per entry, the queue latency then the handler duration */
+    while (1)
+    {
+        svc = service_get_svc_by_index(index / (CONFIG_MSG_TRACE_ID_NUM * 2));
+        if (!svc)
+        {
+            index = 0;
+
+            snprintf(output, output_size, "\r\n");
+
+            return pdFALSE;
+        }
+
+        entry = &svc->trace.entry[(index / 2) % CONFIG_MSG_TRACE_ID_NUM];
+        if (entry->count)
+        {
+            break;
+        }
+
+        index += 2;
+    }
+
+    metric = (index % 2) ? &entry->handler : &entry->queue;
+
+    length = snprintf(output,
+                      output_size,
+                      "%s %-16s %-24s %-7s n %u, min %u, avg %u, max %u us,",
+                      index ? "" : "\r\n",
+                      svc->owner ? svc->owner->name : "unknown",
+                      msg_id_to_str(entry->id),
+                      (index % 2) ? "handler" : "queue",
+                      entry->count,
+                      service_trace_cycles_to_us(metric->min),
+                      service_trace_cycles_to_us((uint32_t)(metric->sum /
+                                                            entry->count)),
+                      service_trace_cycles_to_us(metric->max));
+
+    for (i = 0; i < SERVICE_TRACE_BUCKET_NUM && length < output_size; i++)
+    {
+        length += snprintf(output + length,
+                           output_size - length,
+                           " %u",
+                           metric->histogram[i]);
+    }
+
+    if (length < output_size)
+    {
+        snprintf(output + length, output_size - length, "\r\n");
+    }
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("svc_trace",
+                    svc_trace,
+                    "\r\nsvc_trace:\r\n Print the message trace, min/avg/max and log2 histogram in us.\r\n",
+                    mmi_command_svc_trace,
+                    0);
+
+static BaseType_t mmi_command_svc_trace_reset(char*       output,
+                                              size_t      output_size,
+                                              const char* input)
+{
+    service_t* svc;
+    uint32_t i;
+
+    for (i = 0; i < service_get_count(); i++)
+    {
+        svc = service_get_svc_by_index(i);
+
+        service_trace_reset(&svc->trace);
+    }
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n Command execute done.\r\n",
+             input);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("svc_trace_reset",
+                    svc_trace_reset,
+                    "\r\nsvc_trace_reset:\r\n Reset the message trace.\r\n",
+                    mmi_command_svc_trace_reset,
+                    0);
+#endif
+
+static BaseType_t mmi_command_svc_ram(char*       output,
+                                      size_t      output_size,
+                                      const char* input)
+{
+    static uint32_t index = 0;
+    const service_config_t* config;
+    const service_t* svc;
+    osThreadId_t thread_id;
+
+    /* The services first, then the pool workers */
+    svc = service_get_svc_by_index(index);
+    if (svc)
+    {
+        config = (const service_config_t*)svc->owner->object_config;
+
+        if (config->backend == SERVICE_BACKEND_POOL)
+        {
+            snprintf(output,
+                     output_size,
+                     "%s %-16s pool, stack shared\r\n",
+                     index ? "" : "\r\n",
+                     svc->owner->name);
+        }
+        else
+        {
+            snprintf(output,
+                     output_size,
+                     "%s %-16s thread, stack %u, free %u, %s\r\n",
+                     index ? "" : "\r\n",
+                     svc->owner->name,
+                     config->thread_attr.stack_size,
+                     svc->thread_id ?
+                     osThreadGetStackSpace(svc->thread_id) : 0,
+                     svc->static_mem ? "static" : "heap");
+        }
+
+        index++;
+
+        return pdTRUE;
+    }
+
+    thread_id = service_get_pool_worker(index - service_get_count());
+    if (thread_id)
+    {
+        snprintf(output,
+                 output_size,
+                 " %-16s worker %u, stack %u, free %u\r\n",
+                 osThreadGetName(thread_id),
+                 index - service_get_count(),
+                 CONFIG_SERVICE_POOL_THREAD_STACK_SIZE,
+                 osThreadGetStackSpace(thread_id));
+
+        index++;
+
+        return pdTRUE;
+    }
+
+    index = 0;
+
+    snprintf(output, output_size, "\r\n");
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("svc_ram",
+                    svc_ram,
+                    "\r\nsvc_ram:\r\n Print the stack usage of the services and the pool workers.\r\n",
+                    mmi_command_svc_ram,
+                    0);
+
+static BaseType_t mmi_command_msg_list(char*       output,
+                                       size_t      output_size,
+                                       const char* input)
+{
+    static uint32_t index = 0;
+    const msg_desc_t* desc = NULL;
+    uint32_t id;
+    uint32_t i;
+
+    /* Walk the message ID space, one description per call */
+    while (index < MSG_ID_BASE_NUM * MSG_ID_OFFSET_NUM && !desc)
+    {
+        id = ((index / MSG_ID_OFFSET_NUM) << 8) | (index % MSG_ID_OFFSET_NUM);
+        desc = msg_get_desc(id);
+        index++;
+    }
+
+    if (!desc)
+    {
+        index = 0;
+
+        snprintf(output, output_size, "\r\n");
+
+        return pdFALSE;
+    }
+
+    snprintf(output, output_size, " 0x%04x %-24s", desc->id, desc->name);
+
+    for (i = 0; i < 4; i++)
+    {
+        if (desc->param_name[i])
+        {
+            snprintf(output + strlen(output),
+                     output_size - strlen(output),
+                     " %s",
+                     desc->param_name[i]);
+        }
+    }
+
+    snprintf(output + strlen(output), output_size - strlen(output), "\r\n");
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("msg_list",
+                    msg_list,
+                    "\r\nmsg_list:\r\n List the registered messages.\r\n",
+                    mmi_command_msg_list,
+                    0);
+
+static BaseType_t mmi_command_payload_stats(char*       output,
+                                            size_t      output_size,
+                                            const char* input)
+{
+    const payload_stats_t* stats = payload_get_stats();
+
+    snprintf(output,
+             output_size,
+             "\r\n%s:\r\n block %u bytes, alloc %u, free %u, in use %u, "
+             "peak %u, exhausted %u, oversize %u\r\n",
+             input,
+             payload_get_capacity(),
+             stats->alloc_count,
+             stats->free_count,
+             stats->in_use,
+             stats->in_use_max,
+             stats->fail_count,
+             stats->oversize_count);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("payload_stats",
+                    payload_stats,
+                    "\r\npayload_stats:\r\n Print the message payload pool statistics.\r\n",
+                    mmi_command_payload_stats,
+                    0);
+
+static BaseType_t mmi_command_evt_stats(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    const service_event_stats_t* stats = service_event_get_stats();
+
+    snprintf(output,
+             output_size,
+             "\r\n%s:\r\n ring %u, post %u, full %u, dispatch %u, "
+             "fail %u, depth max %u\r\n",
+             input,
+             CONFIG_MSG_EVENT_RING_SIZE,
+             stats->post_count,
+             stats->full_count,
+             stats->dispatch_count,
+             stats->fail_count,
+             stats->depth_max);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("evt_stats",
+                    evt_stats,
+                    "\r\nevt_stats:\r\n Print the ISR event channel statistics.\r\n",
+                    mmi_command_evt_stats,
+                    0);
+
+static BaseType_t mmi_command_evt_bench(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    const char* param1;
+    BaseType_t length1;
+    message_t message;
+    uint32_t count;
+    uint32_t posted;
+    uint32_t start;
+    uint32_t cycles;
+    uint32_t cycles_sum = 0;
+    uint32_t cycles_max = 0;
+    uint32_t i;
+
+    param1 = FreeRTOS_CLIGetParameter(input, 1, &length1);
+
+    count = (uint32_t)atoi(param1);
+    if (!count || count > CONFIG_MSG_EVENT_RING_SIZE)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n%s: \r\n Count must be 1 to %u.\r\n",
+                 input,
+                 CONFIG_MSG_EVENT_RING_SIZE);
+
+        return pdFALSE;
+    }
+
+    (void)memset(&message, 0, sizeof(message));
+
+    message.id = MSG_ID_SYS_BENCHMARK;
+
+    /**
+     * Keep the dispatcher off the CPU, so only the post cost is measured.
+     * The tick stops while the kernel is locked, so the posts are timed by
+     * the cycle counter of the boot profiler.
+     */
+    (void)osKernelLock();
+
+    for (i = 0, posted = 0; i < count; i++)
+    {
+        message.param0 = i;
+
+        start = boot_profile_get_cycles();
+        if (!service_event_post(NULL, &message, SERVICE_LANE_NORMAL))
+        {
+            posted++;
+        }
+        cycles = boot_profile_get_cycles() - start;
+
+        cycles_sum += cycles;
+        if (cycles > cycles_max)
+        {
+            cycles_max = cycles;
+        }
+    }
+
+    (void)osKernelUnlock();
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n posted %u, %u cycles per post, max %u cycles\r\n",
+             input,
+             posted,
+             cycles_sum / count,
+             cycles_max);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("evt_bench",
+                    evt_bench,
+                    "\r\nevt_bench: evt_bench <count>\r\n Post benchmark messages to the ISR event channel and print the cost.\r\n",
+                    mmi_command_evt_bench,
+                    1);
+
+static BaseType_t mmi_command_svc_timer(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    const service_timer_stats_t* stats = service_timer_get_stats();
+
+    snprintf(output,
+             output_size,
+             "\r\n%s:\r\n tick %u ms, timers %u, armed %u, peak %u, "
+             "fired %u, cascaded %u, exhausted %u\r\n",
+             input,
+             CONFIG_MSG_TIMER_TICK_MS,
+             CONFIG_MSG_TIMER_NUM,
+             stats->armed,
+             stats->armed_max,
+             stats->fire_count,
+             stats->cascade_count,
+             stats->busy_count);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("svc_timer",
+                    svc_timer,
+                    "\r\nsvc_timer:\r\n Print the message timer wheel statistics.\r\n",
+                    mmi_command_svc_timer,
+                    0);
+
+static BaseType_t mmi_command_svc_budget(char*       output,
+                                         size_t      output_size,
+                                         const char* input)
+{
+    static uint32_t index = 0;
+    const service_supervisor_stats_t* sv_stats;
+    const service_t* svc;
+
+    if (index == 0)
+    {
+        sv_stats = service_supervisor_get_stats();
+
+        snprintf(output,
+                 output_size,
+                 "\r\n%s:\r\n check %u, overrun %u, stuck %u, "
+                 "watchdog refresh %u\r\n",
+                 input,
+                 sv_stats->check_count,
+                 sv_stats->overrun_count,
+                 sv_stats->stuck_count,
+                 sv_stats->refresh_count);
+
+        index++;
+
+        return pdTRUE;
+    }
+
+    svc = service_get_svc_by_index(index - 1);
+    if (!svc)
+    {
+        index = 0;
+
+        snprintf(output, output_size, "\r\n");
+
+        return pdFALSE;
+    }
+
+    snprintf(output,
+             output_size,
+             " %u: %-16s budget %u ms, overrun %u, max %u ms, last %s\r\n",
+             index - 1,
+             svc->owner ? svc->owner->name : "unknown",
+             svc->owner ? service_supervisor_get_budget_ms(svc->owner) : 0,
+             svc->supervisor.overrun_count,
+             svc->supervisor.overrun_max / (osKernelGetSysTimerFreq() / 1000),
+             svc->supervisor.overrun_count ?
+             msg_id_to_str(svc->supervisor.overrun_id) : "none");
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("svc_budget",
+                    svc_budget,
+                    "\r\nsvc_budget:\r\n Print the handler budget overruns of the services.\r\n",
+                    mmi_command_svc_budget,
+                    0);
+
+#ifdef CONFIG_MSG_CAPTURE_ENABLE
+static BaseType_t mmi_command_cap_start(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    int32_t ret = service_capture_start();
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n %s, %u records at most.\r\n",
+             input,
+             ret ? "Capture busy" : "Capture started",
+             CONFIG_MSG_CAPTURE_RECORD_NUM);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("cap_start",
+                    cap_start,
+                    "\r\ncap_start:\r\n Clear the message capture and start recording.\r\n",
+                    mmi_command_cap_start,
+                    0);
+
+static BaseType_t mmi_command_cap_stop(char*       output,
+                                       size_t      output_size,
+                                       const char* input)
+{
+    (void)service_capture_stop();
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n %u records, %u lost.\r\n",
+             input,
+             service_capture_get_count(),
+             service_capture_get_lost());
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("cap_stop",
+                    cap_stop,
+                    "\r\ncap_stop:\r\n Stop recording the message capture.\r\n",
+                    mmi_command_cap_stop,
+                    0);
+
+static BaseType_t mmi_command_cap_dump(char*       output,
+                                       size_t      output_size,
+                                       const char* input)
+{
+    static uint32_t index = 0;
+    const service_capture_record_t* record;
+    const uint8_t* data;
+    size_t length;
+    uint32_t i;
+
+    /* The lines are parsed by tools/msg_capture, the timestamps are in ms */
+    if (index == 0)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n@cap-begin %u %u %u\r\n",
+                 1000,
+                 service_capture_get_count(),
+                 service_capture_get_lost());
+
+        index++;
+
+        return pdTRUE;
+    }
+
+    record = service_capture_get(index - 1);
+    if (!record)
+    {
+        index = 0;
+
+        snprintf(output, output_size, "@cap-end\r\n");
+
+        return pdFALSE;
+    }
+
+    data = (const uint8_t*)record;
+    length = snprintf(output, output_size, "@cap %u ", index - 1);
+
+    for (i = 0; i < sizeof(service_capture_record_t); i++)
+    {
+        length += snprintf(output + length,
+                           output_size - length,
+                           "%02x",
+                           data[i]);
+    }
+
+    snprintf(output + length, output_size - length, "\r\n");
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("cap_dump",
+                    cap_dump,
+                    "\r\ncap_dump:\r\n Dump the message capture in hex for tools/msg_capture.\r\n",
+                    mmi_command_cap_dump,
+                    0);
+
+/**
+ * @brief   Convert a hex string to bytes.
+ *
+ * @param   str Pointer to the hex string.
+ * @param   length Length of the hex string.
+ * @param   buf Pointer to the output buffer.
+ * @param   size Size of the output buffer, the string must fill it exactly.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t mmi_parse_hex(const char* str,
+                             size_t      length,
+                             uint8_t*    buf,
+                             size_t      size)
+{
+    char byte[3] = { 0 };
+    char* end;
+    size_t i;
+
+    if (length != size * 2)
+    {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < size; i++)
+    {
+        byte[0] = str[i * 2];
+        byte[1] = str[i * 2 + 1];
+
+        buf[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end)
+        {
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+static BaseType_t mmi_command_cap_load(char*       output,
+                                       size_t      output_size,
+                                       const char* input)
+{
+    const char* param1;
+    const char* param2;
+    BaseType_t length1;
+    BaseType_t length2;
+    service_capture_record_t record;
+    int32_t ret;
+
+    param1 = FreeRTOS_CLIGetParameter(input, 1, &length1);
+    param2 = FreeRTOS_CLIGetParameter(input, 2, &length2);
+
+    ret = mmi_parse_hex(param2,
+                        (size_t)length2,
+                        (uint8_t*)&record,
+                        sizeof(record));
+    if (!ret)
+    {
+        ret = service_capture_load((uint32_t)atoi(param1), &record);
+    }
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n %s, ret %d.\r\n",
+             input,
+             ret ? "Load failed" : "Load done",
+             ret);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("cap_load",
+                    cap_load,
+                    "\r\ncap_load: cap_load <index> <hex>\r\n Load a message capture record, the index 0 starts a new capture.\r\n",
+                    mmi_command_cap_load,
+                    2);
+
+static BaseType_t mmi_command_cap_replay(char*       output,
+                                         size_t      output_size,
+                                         const char* input)
+{
+    const char* param1;
+    BaseType_t length1;
+    service_capture_result_t result;
+    int32_t ret;
+
+    param1 = FreeRTOS_CLIGetParameter(input, 1, &length1);
+
+    ret = service_capture_replay((uint32_t)atoi(param1), &result);
+    if (ret)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n%s: \r\n Replay failed, ret %d.\r\n",
+                 input,
+                 ret);
+
+        return pdFALSE;
+    }
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n sent %u, failed %u, handled %u in %u ms\r\n",
+             input,
+             result.sent,
+             result.failed,
+             result.handled,
+             result.elapsed_ms);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("cap_replay",
+                    cap_replay,
+                    "\r\ncap_replay: cap_replay <scale>\r\n Replay the message capture, the scale is the speed in percent, 0 for as fast as possible.\r\n",
+                    mmi_command_cap_replay,
+                    1);
+#endif
+
+static BaseType_t mmi_command_obj_state(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    static const char* const state_str[OBJECT_STATE_NUM] =
+    {
+        "idle", "probing", "ready", "failed", "skipped",
+    };
+    static uint32_t index = 0;
+    const object_runtime_t* rt;
+    const object* obj;
+    uint32_t cycles_per_us = osKernelGetSysTimerFreq() / 1000000;
+
+    rt = object_get_runtime(index);
+    obj = object_get_by_index(index);
+    if (!rt || !obj)
+    {
+        index = 0;
+
+        snprintf(output, output_size, "\r\n");
+
+        return pdFALSE;
+    }
+
+    snprintf(output,
+             output_size,
+             "%s %2u:%c%-16s level %u, %-7s ret %d, start %u us, "
+             "probe %u us, after <%s>\r\n",
+             index ? "" : "\r\n",
+             index,
+             rt->critical ? '*' : (rt->lazy ? '~' : ' '),
+             obj->name,
+             rt->level,
+             state_str[rt->state],
+             rt->ret,
+             rt->start / cycles_per_us,
+             (rt->end - rt->start) / cycles_per_us,
+             (rt->parent >= 0) ?
+             object_get_by_index((uint32_t)rt->parent)->name : "none");
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("obj_state",
+                    obj_state,
+                    "\r\nobj_state:\r\n Print the probe state of the objects, * marks the boot critical path, ~ marks the lazy objects.\r\n",
+                    mmi_command_obj_state,
+                    0);
+
+#ifdef CONFIG_BOOT_PROFILE_ENABLE
+static BaseType_t mmi_command_boot_prof(char*       output,
+                                        size_t      output_size,
+                                        const char* input)
+{
+    static uint32_t index = 0;
+    const boot_profile_t* profile = boot_profile_get();
+    const boot_profile_entry_t* entry;
+
+    if (index >= profile->count)
+    {
+        snprintf(output,
+                 output_size,
+                 "%s %u entries, %u lost\r\n",
+                 index ? "" : "\r\n",
+                 profile->count,
+                 profile->lost);
+
+        index = 0;
+
+        return pdFALSE;
+    }
+
+    entry = &profile->entry[index];
+
+    snprintf(output,
+             output_size,
+             "%s %-24s %-7s L%u start %u us, %u us, heap %u -> %u, "
+             "stack free %u, ret %d\r\n",
+             index ? "" : "\r\n",
+             entry->name,
+             boot_profile_kind_to_str(entry->kind),
+             entry->level,
+             entry->start_us,
+             entry->us,
+             entry->heap_before,
+             entry->heap_after,
+             entry->stack_free,
+             entry->ret);
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("boot_prof",
+                    boot_prof,
+                    "\r\nboot_prof:\r\n Print the boot record, time, heap and stack of each probe.\r\n",
+                    mmi_command_boot_prof,
+                    0);
+
+static BaseType_t mmi_command_boot_csv(char*       output,
+                                       size_t      output_size,
+                                       const char* input)
+{
+    static uint32_t index = 0;
+    const boot_profile_t* profile = boot_profile_get();
+    const boot_profile_entry_t* entry;
+
+    /* The @boot lines are parsed by tools/boot_profile */
+    if (index == 0)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n@boot-begin %s %u %u\r\n"
+                 "@boot name,kind,level,start_us,us,cycles,"
+                 "heap_before,heap_after,stack_free,ret\r\n",
+                 CONFIG_ISSUE_VERSION,
+                 profile->count,
+                 profile->lost);
+
+        index++;
+
+        return pdTRUE;
+    }
+
+    if (index > profile->count)
+    {
+        snprintf(output, output_size, "@boot-end\r\n");
+
+        index = 0;
+
+        return pdFALSE;
+    }
+
+    entry = &profile->entry[index - 1];
+
+    snprintf(output,
+             output_size,
+             "@boot %s,%s,%u,%u,%u,%u,%u,%u,%u,%d\r\n",
+             entry->name,
+             boot_profile_kind_to_str(entry->kind),
+             entry->level,
+             entry->start_us,
+             entry->us,
+             entry->cycles,
+             entry->heap_before,
+             entry->heap_after,
+             entry->stack_free,
+             entry->ret);
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("boot_csv",
+                    boot_csv,
+                    "\r\nboot_csv:\r\n Dump the boot record as CSV for tools/boot_profile.\r\n",
+                    mmi_command_boot_csv,
+                    0);
+#endif
+
+static BaseType_t mmi_command_obj_pm(char*          output,
+                                     size_t         output_size,
+                                     const char*    input)
+{
+    static uint32_t index = 0;
+    const object_pm_sleep_stats_t* sleep;
+    const object_pm_t* pm;
+    const object* obj;
+    uint32_t cycles_per_us = osKernelGetSysTimerFreq() / 1000000;
+
+    pm = object_pm_get_by_index(index);
+    obj = object_get_by_index(index);
+    if (!pm || !obj)
+    {
+        index = 0;
+
+        sleep = object_pm_get_sleep_stats();
+
+        snprintf(output,
+                 output_size,
+                 " sleep %u, deep %u, slept ticks %u\r\n",
+                 sleep->sleep_count,
+                 sleep->deep_count,
+                 sleep->sleep_ticks);
+
+        return pdFALSE;
+    }
+
+    snprintf(output,
+             output_size,
+             "%s %2u:%c%-16s %-10s usage %u, suspend %u (%u/%u us), "
+             "resume %u (%u/%u us), error %u\r\n",
+             index ? "" : "\r\n",
+             index,
+             pm->runtime ? '*' : ' ',
+             obj->name,
+             object_pm_state_to_str(pm->state),
+             pm->usage,
+             pm->suspend_count,
+             pm->suspend_cycles / cycles_per_us,
+             pm->suspend_max_cycles / cycles_per_us,
+             pm->resume_count,
+             pm->resume_cycles / cycles_per_us,
+             pm->resume_max_cycles / cycles_per_us,
+             pm->error_count);
+
+    index++;
+
+    return pdTRUE;
+}
+
+DECLARE_MMI_COMMAND("obj_pm",
+                    obj_pm,
+                    "\r\nobj_pm:\r\n Print the power state of the objects, * marks the runtime managed ones, the latencies are last/max.\r\n",
+                    mmi_command_obj_pm,
+                    0);
+
+static BaseType_t mmi_command_pm_cycle(char*        output,
+                                       size_t       output_size,
+                                       const char*  input)
+{
+    const char* param1;
+    BaseType_t length1;
+    int32_t level;
+    int32_t ret;
+    uint32_t start;
+    uint32_t suspend_us;
+    uint32_t resume_us;
+    uint32_t cycles_per_us = osKernelGetSysTimerFreq() / 1000000;
+
+    param1 = FreeRTOS_CLIGetParameter(input, 1, &length1);
+
+    level = atoi(param1);
+
+    start = osKernelGetSysTimerCount();
+    ret = object_suspend(level);
+    suspend_us = (osKernelGetSysTimerCount() - start) / cycles_per_us;
+    if (ret)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n%s: \r\n Suspend level %d failed, ret %d.\r\n",
+                 input,
+                 level,
+                 ret);
+
+        return pdFALSE;
+    }
+
+    start = osKernelGetSysTimerCount();
+    ret = object_resume(level);
+    resume_us = (osKernelGetSysTimerCount() - start) / cycles_per_us;
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n Suspend %u us, resume %u us, ret %d.\r\n",
+             input,
+             suspend_us,
+             resume_us,
+             ret);
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("pm_cycle",
+                    pm_cycle,
+                    "\r\npm_cycle: pm_cycle <level>\r\n Suspend and resume the objects at the level, and print the latencies.\r\n",
+                    mmi_command_pm_cycle,
+                    1);
+
+/**
+ * @brief   Attributes structure for the restart thread, it is below the
+ *          man-machine thread so the command completes before the restart.
+ */
+const osThreadAttr_t mmi_restart_thread_attr =
+{
+    .name       = CONFIG_MMI_SERVICE_RESTART_THREAD_NAME,
+    .attr_bits  = osThreadDetached,
+    .cb_mem     = NULL,
+    .cb_size    = 0,
+    .stack_mem  = NULL,
+    .stack_size = CONFIG_MMI_SERVICE_RESTART_THREAD_STACK_SIZE,
+    .priority   = CONFIG_MMI_SERVICE_RESTART_THREAD_PRIORITY,
+};
+
+/**
+ * @brief   Restart thread, the man-machine service may be restarted, so it
+ *          can not restart the objects on its own thread.
+ *
+ * @param   argument Object name, NULL for all.
+ *
+ * @retval  None.
+ */
+static void mmi_restart_thread(void* argument)
+{
+    object_restart_stats_t stats;
+    int32_t ret;
+
+    (void)memset(&stats, 0, sizeof(stats));
+
+    ret = object_restart((const char*)argument, &stats);
+
+    pr_info("Warm restart %u objects in %u us, full boot %u us, ret %d.",
+            stats.count,
+            stats.shutdown_us + stats.probe_us,
+            stats.reset_us,
+            ret);
+
+    (void)osThreadTerminate(osThreadGetId());
+}
+
+static BaseType_t mmi_command_obj_restart(char*         output,
+                                          size_t        output_size,
+                                          const char*   input)
+{
+    const char* param1;
+    char* end;
+    BaseType_t length1;
+    const object* obj = NULL;
+
+    param1 = FreeRTOS_CLIGetParameter(input, 1, &length1);
+
+    /* A typo must not restart everything, so both forms match exactly */
+    if (length1 != strlen("all") || strncmp(param1, "all", length1))
+    {
+        obj = object_get_by_index((uint32_t)strtoul(param1, &end, 10));
+        if (end != param1 + length1 || !obj)
+        {
+            snprintf(output,
+                     output_size,
+                     "\r\n%s: \r\n Invalid object index.\r\n",
+                     input);
+
+            return pdFALSE;
+        }
+    }
+
+    if (!osThreadNew(mmi_restart_thread,
+                     obj ? (void*)obj->name : NULL,
+                     &mmi_restart_thread_attr))
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n%s: \r\n Create thread <%s> failed.\r\n",
+                 input,
+                 mmi_restart_thread_attr.name);
+
+        return pdFALSE;
+    }
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n Restart <%s> started.\r\n",
+             input,
+             obj ? obj->name : "all");
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("obj_restart",
+                    obj_restart,
+                    "\r\nobj_restart: obj_restart <index|all>\r\n Warm restart the object of the obj_state index with the objects depending on it, or all the middleware and services.\r\n",
+                    mmi_command_obj_restart,
+                    1);
+
+#define MMI_RING_BENCH_SIZE 256
+
+/* Not a divisor of the ring size, so the bulk copies wrap around */
+#define MMI_RING_BENCH_BLOCK 48
+
+/**
+ * @brief   Ring buffer bench modes.
+ */
+typedef enum
+{
+    MMI_RING_BENCH_BYTE = 0,
+    MMI_RING_BENCH_SPSC,
+    MMI_RING_BENCH_SPSC_BULK,
+} mmi_ring_bench_e;
+
+/**
+ * @brief   Move the bytes through the ring buffer, chunk by chunk.
+ *
+ * @param   mode Ring and api to bench.
+ * @param   total Number of bytes to move.
+ *
+ * @retval  Returns the cycles spent.
+ */
+static uint32_t mmi_ring_bench_run(mmi_ring_bench_e mode, uint32_t total)
+{
+    static char buffer[MMI_RING_BENCH_SIZE];
+    static char block[MMI_RING_BENCH_BLOCK];
+    ring_buff_t ring;
+    ring_spsc_t ring_spsc;
+    uint32_t start;
+    uint32_t moved;
+    uint32_t len;
+    uint32_t i;
+    char value = 0;
+
+    (void)ring_buffer_init(&ring, buffer, sizeof(buffer));
+    (void)ring_spsc_init(&ring_spsc, buffer, sizeof(buffer));
+
+    start = boot_profile_get_cycles();
+
+    for (moved = 0; moved < total; moved += sizeof(buffer))
+    {
+        if (mode == MMI_RING_BENCH_SPSC_BULK)
+        {
+            for (i = 0; i < sizeof(buffer); i += len)
+            {
+                len = ring_spsc_write_n(&ring_spsc,
+                                        block,
+                                        sizeof(buffer) - i < sizeof(block) ?
+                                        sizeof(buffer) - i : sizeof(block));
+                (void)ring_spsc_read_n(&ring_spsc, block, len);
+            }
+        }
+        else if (mode == MMI_RING_BENCH_SPSC)
+        {
+            for (i = 0; i < sizeof(buffer); i++)
+            {
+                (void)ring_spsc_write(&ring_spsc, (char)i);
+            }
+
+            for (i = 0; i < sizeof(buffer); i++)
+            {
+                (void)ring_spsc_read(&ring_spsc, &value);
+            }
+        }
+        else
+        {
+            for (i = 0; i < sizeof(buffer); i++)
+            {
+                (void)ring_buffer_write(&ring, (char)i);
+            }
+
+            for (i = 0; i < sizeof(buffer); i++)
+            {
+                (void)ring_buffer_read(&ring, &value);
+            }
+        }
+    }
+
+    return boot_profile_get_cycles() - start;
+}
+
+static BaseType_t mmi_command_ring_bench(char*          output,
+                                         size_t         output_size,
+                                         const char*    input)
+{
+    const char* param1;
+    BaseType_t length1;
+    uint32_t freq = boot_profile_get_freq();
+    uint32_t total;
+    uint32_t cycles;
+    uint32_t cycles_spsc;
+    uint32_t cycles_bulk;
+
+    param1 = FreeRTOS_CLIGetParameter(input, 1, &length1);
+
+    total = (uint32_t)atoi(param1) * 1024;
+    if (!total)
+    {
+        snprintf(output,
+                 output_size,
+                 "\r\n%s: \r\n Size must be at least 1 KB.\r\n",
+                 input);
+
+        return pdFALSE;
+    }
+
+    /**
+     * Keep the other threads off the CPU, only the ring cost is measured.
+     * The tick stops while the kernel is locked, so the runs are timed by
+     * the cycle counter of the boot profiler.
+     */
+    (void)osKernelLock();
+
+    cycles = mmi_ring_bench_run(MMI_RING_BENCH_BYTE, total);
+    cycles_spsc = mmi_ring_bench_run(MMI_RING_BENCH_SPSC, total);
+    cycles_bulk = mmi_ring_bench_run(MMI_RING_BENCH_SPSC_BULK, total);
+
+    (void)osKernelUnlock();
+
+    snprintf(output,
+             output_size,
+             "\r\n%s: \r\n ring_buff %u bytes/s, ring_spsc %u bytes/s, ring_spsc bulk %u bytes/s\r\n",
+             input,
+             (uint32_t)((uint64_t)total * freq / (cycles ? cycles : 1)),
+             (uint32_t)((uint64_t)total * freq /
+                        (cycles_spsc ? cycles_spsc : 1)),
+             (uint32_t)((uint64_t)total * freq /
+                        (cycles_bulk ? cycles_bulk : 1)));
+
+    return pdFALSE;
+}
+
+DECLARE_MMI_COMMAND("ring_bench",
+                    ring_bench,
+                    "\r\nring_bench: ring_bench <KB>\r\n Move the data through the ring buffers byte by byte and in blocks, and print the throughput.\r\n",
+                    mmi_command_ring_bench,
+                    1);
 #endif
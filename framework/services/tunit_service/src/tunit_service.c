@@ -133,6 +133,8 @@ int32_t tunit_service_run_tests(void)
 
 static const service_config_t tunit_service_config =
 {
+    .backend        = CONFIG_TUNIT_SERVICE_BACKEND,
+
     .thread_attr    =
     {
         .name       = CONFIG_TUNIT_SERVICE_THREAD_NAME,
@@ -155,15 +157,39 @@ static const service_config_t tunit_service_config =
     },
 
     .msg_count      = CONFIG_TUNIT_SERVICE_MSG_COUNT,
+    .urgent_msg_count = 0,
+
+    .subscription       = NULL,
+    .subscription_count = 0,
+
+    .overflow_policy    = SERVICE_OVERFLOW_BLOCK,
+    .block_budget_ms    = 0,
+
+    .batch_count        = CONFIG_TUNIT_SERVICE_BATCH_COUNT,
+    .batch_begin        = NULL,
+    .batch_end          = NULL,
+
+    .coalesce           = NULL,
+    .coalesce_count     = 0,
+    .mailbox            = NULL,
+    .mailbox_count      = 0,
+
+    .handler_budget_ms  = CONFIG_TUNIT_SERVICE_HANDLER_BUDGET_MS,
 };
 
-DECLARE_SERVICE(CONFIG_TUNIT_SERVICE_NAME,
-                CONFIG_TUNIT_SERVICE_LABEL,
-                &tunit_service_priv,
-                &tunit_service_config,
-                tunit_service_init,
-                tunit_service_deinit,
-                tunit_service_message_handler);
+DECLARE_SERVICE_STATIC(CONFIG_TUNIT_SERVICE_NAME,
+                       CONFIG_TUNIT_SERVICE_LABEL,
+                       &tunit_service_priv,
+                       &tunit_service_config,
+                       tunit_service_init,
+                       tunit_service_deinit,
+                       tunit_service_message_handler,
+                       CONFIG_TUNIT_SERVICE);
+
+DECLARE_OBJECT_DEPENDENCY(CONFIG_TUNIT_SERVICE_NAME,
+                          CONFIG_TUNIT_SERVICE_LABEL,
+                          CONFIG_TUNIT_MANAGER_NAME,
+                          CONFIG_TUNIT_MANAGER_LABEL);
 
 #ifdef CONFIG_MMI_SERVICE_INTERNAL_COMMAND_ENABLE
 static BaseType_t mmi_command_run_tests(char*       output,
@@ -20,7 +20,6 @@
 #include <stdio.h>
 #include <string.h>
 #include "cmsis_os.h"
-#include "timers.h"
 #include "framework.h"
 #include "button_manager.h"
 #include "button_manager_wrappers.h"
@@ -30,12 +29,13 @@
 #define button_info(str, ...)    pr_info(str, ## __VA_ARGS__)
 #define button_debug(str, ...)   pr_debug(str, ## __VA_ARGS__)
 
+#define BUTTON_MANAGER_TIMER_KEY(id) SERVICE_TIMER_KEY(MSG_ID_BTN_BASE, (id))
+
 /**
  * @brief   Button manager handle definition.
  */
 typedef struct
 {
-    TimerHandle_t       timer[BUTTON_ID_BUTT];
     uint32_t            press_down_count[BUTTON_ID_BUTT];
 
     button_user_clbk_t  user_clbk;
@@ -80,87 +80,80 @@ const char* button_manager_state_to_str(button_state_e state)
 }
 
 /**
- * @brief   Button manager timer callback function.
+ * @brief   Button manager timer callback function, the timer is restarted
+ *          while the button is down.
  */
-static void button_manager_timer_callback(TimerHandle_t xTimer)
+static void button_manager_timer_callback(uint32_t key, const void* user_ctx)
 {
-    button_manager_handle_t* handle =
-        (button_manager_handle_t*)pvTimerGetTimerID(xTimer);
-    button_id_e id;
+    button_manager_handle_t* handle = &button_manager_handle;
+    button_id_e id = (button_id_e)(uint32_t)user_ctx;
     button_state_e state;
-    uint32_t i;
+    uint32_t i = (uint32_t)id;
 
-    for (i = 0; i < BUTTON_ID_BUTT; i++)
+    state = button_get_state(id);
+
+    if (state == BUTTON_STATE_DOWN)
     {
-        if (xTimer == handle->timer[i])
+        if (handle->press_down_count[i] < 100000)
         {
-            id = (button_id_e)i;
-            state = button_get_state(id);
+            handle->press_down_count[i]++;
+        }
+        else
+        {
+            button_warning("Button %d was pressed too long.", id);
+        }
 
-            if (state == BUTTON_STATE_DOWN)
-            {
-                if (handle->press_down_count[i] < 100000)
-                {
-                    handle->press_down_count[i]++;
-                }
-                else
-                {
-                    button_warning("Button %d was pressed too long.", id);
-                }
-
-                if (handle->press_down_count[i] == 1)
-                {
-                    if (handle->user_clbk)
-                    {
-                        handle->user_clbk(id,
-                                          BUTTON_STATE_FIRST_DOWN,
-                                          handle->user_ctx);
-                    }
-                }
-
-                if (xTimerStart(handle->timer[i], 0) != pdPASS)
-                {
-                    button_error("Button %d restart failed.", id);
-                }
-            }
-            else if (state == BUTTON_STATE_UP)
+        if (handle->press_down_count[i] == 1)
+        {
+            if (handle->user_clbk)
             {
-                if (handle->user_clbk)
-                {
-                    handle->user_clbk(id, BUTTON_STATE_UP, handle->user_ctx);
-
-                    if (handle->press_down_count[i] >=
-                        (CONFIG_BUTTON_MANAGER_TIMER_LONGLONG_CLICK_MS /
-                         CONFIG_BUTTON_MANAGER_TIMER_INTERVAL_MS))
-                    {
-                        handle->user_clbk(id,
-                                          BUTTON_STATE_LONGLONG_CLICK,
-                                          handle->user_ctx);
-                    }
-                    else if (handle->press_down_count[i] >=
-                             (CONFIG_BUTTON_MANAGER_TIMER_LONG_CLICK_MS /
-                              CONFIG_BUTTON_MANAGER_TIMER_INTERVAL_MS))
-                    {
-                        handle->user_clbk(id,
-                                          BUTTON_STATE_LONG_CLICK,
-                                          handle->user_ctx);
-                    }
-                    else
-                    {
-                        handle->user_clbk(id,
-                                          BUTTON_STATE_CLICK,
-                                          handle->user_ctx);
-                    }
-                }
-
-                handle->press_down_count[i] = 0;
+                handle->user_clbk(id,
+                                  BUTTON_STATE_FIRST_DOWN,
+                                  handle->user_ctx);
             }
+        }
 
-            return;
+        if (service_timer_start(key,
+                                CONFIG_BUTTON_MANAGER_TIMER_INTERVAL_MS,
+                                0,
+                                button_manager_timer_callback,
+                                user_ctx))
+        {
+            button_error("Button %d restart failed.", id);
         }
     }
+    else if (state == BUTTON_STATE_UP)
+    {
+        if (handle->user_clbk)
+        {
+            handle->user_clbk(id, BUTTON_STATE_UP, handle->user_ctx);
+
+            if (handle->press_down_count[i] >=
+                (CONFIG_BUTTON_MANAGER_TIMER_LONGLONG_CLICK_MS /
+                 CONFIG_BUTTON_MANAGER_TIMER_INTERVAL_MS))
+            {
+                handle->user_clbk(id,
+                                  BUTTON_STATE_LONGLONG_CLICK,
+                                  handle->user_ctx);
+            }
+            else if (handle->press_down_count[i] >=
+                     (CONFIG_BUTTON_MANAGER_TIMER_LONG_CLICK_MS /
+                      CONFIG_BUTTON_MANAGER_TIMER_INTERVAL_MS))
+            {
+                handle->user_clbk(id,
+                                  BUTTON_STATE_LONG_CLICK,
+                                  handle->user_ctx);
+            }
+            else
+            {
+                handle->user_clbk(id,
+                                  BUTTON_STATE_CLICK,
+                                  handle->user_ctx);
+            }
+        }
 
-    button_error("Invalid %s handle.", CONFIG_BUTTON_MANAGER_TIMER_NAME);
+        handle->press_down_count[i] = 0;
+    }
 }
 
 /**
@@ -169,35 +162,20 @@ static void button_manager_timer_callback(TimerHandle_t xTimer)
  * @param   id Button ID.
  *
  * @retval  None.
+ *
+ * @note    Starting the armed debounce timer again restarts it, the wheel
+ *          does it in constant time without a timer daemon command.
  */
 void button_manager_driver_clbk(button_id_e id)
 {
-    BaseType_t higher_priority_task_woken = pdFALSE;
-    BaseType_t need_yield = pdFALSE;
-
-    if (xTimerStopFromISR(button_manager_handle.timer[id],
-                          &higher_priority_task_woken) != pdPASS)
-    {
-        button_error("Button %d stop failed.", id);
-    }
-
-    if (higher_priority_task_woken != pdFALSE)
-    {
-        need_yield = pdTRUE;
-    }
-
-    if (xTimerStartFromISR(button_manager_handle.timer[id],
-                           &higher_priority_task_woken) != pdPASS)
+    if (service_timer_start(BUTTON_MANAGER_TIMER_KEY(id),
+                            CONFIG_BUTTON_MANAGER_TIMER_INTERVAL_MS,
+                            0,
+                            button_manager_timer_callback,
+                            (const void*)id))
     {
         button_error("Button %d start failed.", id);
     }
-
-    if (higher_priority_task_woken != pdFALSE)
-    {
-        need_yield = pdTRUE;
-    }
-
-    portYIELD_FROM_ISR(need_yield);
 }
 
 /**
@@ -252,22 +230,6 @@ static int32_t button_manager_probe(const object* obj)
     for (i = 0; i < BUTTON_ID_BUTT; i++)
     {
         handle->press_down_count[i] = 0;
-
-        handle->timer[i] = xTimerCreate(
-            CONFIG_BUTTON_MANAGER_TIMER_NAME,
-            pdMS_TO_TICKS(CONFIG_BUTTON_MANAGER_TIMER_INTERVAL_MS),
-            pdFALSE,
-            (void*)handle,
-            button_manager_timer_callback);
-        if (!handle->timer[i])
-        {
-            button_error(
-                "Manager <%s> create timer %d <%s> failed.",
-                obj->name,
-                i,
-                CONFIG_BUTTON_MANAGER_TIMER_NAME);
-            return -EINVAL;
-        }
     }
 
     ret = button_init();
@@ -293,9 +255,6 @@ static int32_t button_manager_probe(const object* obj)
  */
 static int32_t button_manager_shutdown(const object* obj)
 {
-    button_manager_handle_t* handle =
-        (button_manager_handle_t*)obj->object_data;
-    BaseType_t stat;
     uint32_t i;
     int32_t ret;
 
@@ -310,16 +269,7 @@ static int32_t button_manager_shutdown(const object* obj)
 
     for (i = 0; i < BUTTON_ID_BUTT; i++)
     {
-        stat = xTimerDelete(handle->timer[i], 0);
-        if (stat != pdPASS)
-        {
-            button_error(
-                "Manager <%s> delete timer %d <%s> failed.",
-                obj->name,
-                i,
-                CONFIG_BUTTON_MANAGER_TIMER_NAME);
-            return -EINVAL;
-        }
+        (void)service_timer_cancel(BUTTON_MANAGER_TIMER_KEY(i));
     }
 
     button_info("Manager <%s> shutdown succeed.", obj->name);
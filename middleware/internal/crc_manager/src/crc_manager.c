@@ -54,7 +54,19 @@ int32_t crc_manager_calculate(const void*           buf,
                               uint32_t*             crc,
                               crc_manager_config_t* config)
 {
-    return crc_calculate(buf, len, crc, config);
+    int32_t ret;
+
+    ret = object_get(CONFIG_CRC_MANAGER_NAME);
+    if (ret)
+    {
+        return ret;
+    }
+
+    ret = crc_calculate(buf, len, crc, config);
+
+    (void)object_put(CONFIG_CRC_MANAGER_NAME);
+
+    return ret;
 }
 
 /**
@@ -119,3 +131,8 @@ module_middleware(CONFIG_CRC_MANAGER_NAME,
                   crc_manager_probe,
                   crc_manager_shutdown,
                   NULL, &crc_manager_handle, NULL);
+
+/* The crc unit is seldom used, it is clocked only around the calculations */
+DECLARE_OBJECT_LAZY(CONFIG_CRC_MANAGER_NAME,
+                    CONFIG_CRC_MANAGER_LABEL,
+                    CONFIG_CRC_MANAGER_IDLE_MS);
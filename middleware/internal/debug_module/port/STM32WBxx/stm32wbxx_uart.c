@@ -27,6 +27,10 @@
 #include "stm32wbxx_uart.h"
 #include "middleware_conf.h"
 
+#if (CONFIG_UART1_TX_RING_BUFF_SIZE & (CONFIG_UART1_TX_RING_BUFF_SIZE - 1))
+#error "CONFIG_UART1_TX_RING_BUFF_SIZE must be a power of two."
+#endif
+
 /**
  * @brief   Uart handle definition.
  */
@@ -34,7 +38,7 @@ typedef struct
 {
     UART_HandleTypeDef  uart;
 
-    ring_buff_t         tx;
+    ring_spsc_t         tx;
     char                tx_ring_buff[CONFIG_UART1_TX_RING_BUFF_SIZE];
 } stm32wbxx_uart_handle_t;
 
@@ -69,12 +73,14 @@ int32_t stm32wbxx_uart1_read_clbk_enable(uint32_t enable_disable)
  *
  * @retval  The number of data bytes write to the slave on success,
  *          negative error code otherwise.
+ *
+ * @note    Any thread or interrupt may write, so the writers are serialized
+ *          by the critical section. The TXE interrupt is the only reader of
+ *          the ring, it takes no lock.
  */
 int32_t stm32wbxx_uart1_write(const void* tx_buf, int32_t tx_len)
 {
-    char* buff = (char*)tx_buf;
-    int32_t i;
-    int32_t ret;
+    uint32_t len;
     uint32_t isrm;
     BaseType_t is_irq = xPortIsInsideInterrupt();
 
@@ -97,14 +103,9 @@ int32_t stm32wbxx_uart1_write(const void* tx_buf, int32_t tx_len)
         taskENTER_CRITICAL();
     }
 
-    for (i = 0; i < tx_len; i++)
-    {
-        ret = ring_buffer_write(&stm32wbxx_uart_handle.tx, buff[i]);
-        if (ret)
-        {
-            break;
-        }
-    }
+    len = ring_spsc_write_n(&stm32wbxx_uart_handle.tx,
+                            (const char*)tx_buf,
+                            (uint32_t)tx_len);
 
     if (is_irq)
     {
@@ -118,7 +119,7 @@ int32_t stm32wbxx_uart1_write(const void* tx_buf, int32_t tx_len)
     /* Enable the UART Transmit data register empty Interrupt */
     __HAL_UART_ENABLE_IT(&stm32wbxx_uart_handle.uart, UART_IT_TXE);
 
-    return i;
+    return (int32_t)len;
 }
 
 /**
@@ -130,7 +131,9 @@ int32_t stm32wbxx_uart1_write(const void* tx_buf, int32_t tx_len)
  */
 static void stm32wbxx_uart1_irq_handler(stm32wbxx_uart_handle_t* handle)
 {
-    int32_t ret;
+    const char* span;
+    uint32_t len;
+    uint32_t i;
     char value;
 
     /* UART in mode Transmitter */
@@ -138,16 +141,23 @@ static void stm32wbxx_uart1_irq_handler(stm32wbxx_uart_handle_t* handle)
     {
         if (__HAL_UART_GET_FLAG(&handle->uart, UART_FLAG_TXE))
         {
-            ret = ring_buffer_read(&handle->tx, &value);
-            if (ret)
+            len = ring_spsc_read_span(&handle->tx, &span);
+            if (!len)
             {
                 /* Disable the UART Transmit data register empty Interrupt */
                 __HAL_UART_DISABLE_IT(&handle->uart, UART_IT_TXE);
             }
             else
             {
-                /* Flushes the UART DR register */
-                handle->uart.Instance->TDR = value;
+                /* Fill the tx fifo straight from the ring until it is full */
+                i = 0;
+                do
+                {
+                    handle->uart.Instance->TDR = span[i++];
+                } while (i < len &&
+                         __HAL_UART_GET_FLAG(&handle->uart, UART_FLAG_TXFNF));
+
+                ring_spsc_read_commit(&handle->tx, i);
             }
         }
     }
@@ -255,8 +265,7 @@ int32_t stm32wbxx_uart1_init(void)
         return -EIO;
     }
 
-    ret =
-        ring_buffer_init(&stm32wbxx_uart_handle.tx,
+    ret = ring_spsc_init(&stm32wbxx_uart_handle.tx,
                          stm32wbxx_uart_handle.tx_ring_buff,
                          sizeof(stm32wbxx_uart_handle.tx_ring_buff));
     if (ret)
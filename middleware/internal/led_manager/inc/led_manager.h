@@ -39,6 +39,7 @@ typedef enum
 } led_id_e;
 
 extern int32_t led_manager_setup(led_id_e id, led_type_e type);
+extern int32_t led_manager_get_type(led_id_e id, led_type_e* type);
 extern const char* led_manager_type_to_str(led_type_e type);
 
 #endif /* __LED_MANAGER_H__ */
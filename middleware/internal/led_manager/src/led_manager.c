@@ -29,29 +29,20 @@
 #define led_info(str, ...)    pr_info(str, ## __VA_ARGS__)
 #define led_debug(str, ...)   pr_debug(str, ## __VA_ARGS__)
 
+#define LED_MANAGER_TIMER_KEY(id) SERVICE_TIMER_KEY(MSG_ID_LED_BASE, (id))
+
 /**
  * @brief   Led manager handle definition.
  */
 typedef struct
 {
     led_type_e  type[LED_ID_BUTT];
-    osTimerId_t timer[LED_ID_BUTT];
     uint32_t    interval_millisec[LED_ID_BUTT];
+    uint32_t    active;                 /* Set if any led is not off */
 } led_manager_handle_t;
 
 static led_manager_handle_t led_manager_handle;
 
-/**
- * @brief   Attributes structure for led timer.
- */
-const osTimerAttr_t led_manager_timer_attr =
-{
-    .name       = CONFIG_LED_MANAGER_TIMER_NAME,
-    .attr_bits  = 0,
-    .cb_mem     = NULL,
-    .cb_size    = 0,
-};
-
 typedef struct
 {
     led_type_e  type;
@@ -86,29 +77,35 @@ const char* led_manager_type_to_str(led_type_e type)
 }
 
 /**
- * @brief   Setup led type.
+ * @brief   Led manager timer callback function, the timer is periodic.
+ */
+static void led_manager_timer_callback(uint32_t key, const void* user_ctx)
+{
+    led_id_e id = (led_id_e)(uint32_t)user_ctx;
+    int32_t ret;
+
+    (void)key;
+
+    ret = led_toggle(id);
+    if (ret)
+    {
+        led_error("Led manager toggle failed, ret %d.", ret);
+    }
+}
+
+/**
+ * @brief   Apply the led type to the hardware.
  *
  * @param   id Led id.
  * @param   Type Led type.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
  */
-int32_t led_manager_setup(led_id_e id, led_type_e type)
+static int32_t led_manager_apply(led_id_e id, led_type_e type)
 {
-    osStatus_t stat;
     int32_t ret;
 
-    if (id >= LED_ID_BUTT)
-    {
-        return -EINVAL;
-    }
-
-    if (type >= LED_TYPE_BUTT)
-    {
-        return -EINVAL;
-    }
-
-    (void)osTimerStop(led_manager_handle.timer[id]);
+    (void)service_timer_cancel(LED_MANAGER_TIMER_KEY(id));
 
     switch (type)
     {
@@ -124,12 +121,14 @@ int32_t led_manager_setup(led_id_e id, led_type_e type)
         led_manager_handle.interval_millisec[id] =
             CONFIG_LED_MANAGER_QUICK_FLASH_INTERVAL_MS;
 
-        stat = osTimerStart(led_manager_handle.timer[id],
-                            led_manager_handle.interval_millisec[id] * osKernelGetTickFreq() /
-                            1000);
-        if (stat != osOK)
+        ret = service_timer_start(LED_MANAGER_TIMER_KEY(id),
+                                  led_manager_handle.interval_millisec[id],
+                                  led_manager_handle.interval_millisec[id],
+                                  led_manager_timer_callback,
+                                  (const void*)id);
+        if (ret)
         {
-            led_error("Led manager timer %d start failed, stat %d.", id, stat);
+            led_error("Led manager timer %d start failed, ret %d.", id, ret);
         }
 
         break;
@@ -146,12 +145,14 @@ int32_t led_manager_setup(led_id_e id, led_type_e type)
         led_manager_handle.interval_millisec[id] =
             CONFIG_LED_MANAGER_SLOW_FLASH_INTERVAL_MS;
 
-        stat = osTimerStart(led_manager_handle.timer[id],
-                            led_manager_handle.interval_millisec[id] * osKernelGetTickFreq() /
-                            1000);
-        if (stat != osOK)
+        ret = service_timer_start(LED_MANAGER_TIMER_KEY(id),
+                                  led_manager_handle.interval_millisec[id],
+                                  led_manager_handle.interval_millisec[id],
+                                  led_manager_timer_callback,
+                                  (const void*)id);
+        if (ret)
         {
-            led_error("Led manager timer %d start failed, stat %d.", id, stat);
+            led_error("Led manager timer %d start failed, ret %d.", id, ret);
         }
 
         break;
@@ -190,27 +191,91 @@ int32_t led_manager_setup(led_id_e id, led_type_e type)
 }
 
 /**
- * @brief   Led manager timer callback function.
+ * @brief   Setup led type.
+ *
+ * @param   id Led id.
+ * @param   Type Led type.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The manager holds itself active while any led is not off, so it
+ *          is runtime suspended when all leds are off.
  */
-static void led_manager_timer_callback(void* argument)
+int32_t led_manager_setup(led_id_e id, led_type_e type)
 {
-    int32_t id = (int32_t)argument;
-    osStatus_t stat;
+    led_manager_handle_t* handle = &led_manager_handle;
+    uint32_t active = 0;
+    uint32_t i;
     int32_t ret;
 
-    ret = led_toggle((led_id_e)id);
+    if (id >= LED_ID_BUTT)
+    {
+        return -EINVAL;
+    }
+
+    if (type >= LED_TYPE_BUTT)
+    {
+        return -EINVAL;
+    }
+
+    ret = object_pm_get(CONFIG_LED_MANAGER_NAME);
     if (ret)
     {
-        led_error("Led manager toggle failed, ret %d.", ret);
+        led_error("Led manager resume failed, ret %d.", ret);
+        return ret;
+    }
+
+    ret = led_manager_apply(id, type);
+
+    for (i = 0; i < LED_ID_BUTT; i++)
+    {
+        if (handle->type[i] != LED_TYPE_TURN_OFF)
+        {
+            active = 1;
+        }
     }
 
-    stat = osTimerStart(led_manager_handle.timer[id],
-                        led_manager_handle.interval_millisec[id] * osKernelGetTickFreq() /
-                        1000);
-    if (stat != osOK)
+    if (active != handle->active)
     {
-        led_error("Led manager timer %d restart failed, stat %d.", id, stat);
+        handle->active = active;
+
+        /* Keep the reference taken above while a led is not off */
+        if (active)
+        {
+            return ret;
+        }
+
+        (void)object_pm_put(CONFIG_LED_MANAGER_NAME);
     }
+
+    (void)object_pm_put(CONFIG_LED_MANAGER_NAME);
+
+    return ret;
+}
+
+/**
+ * @brief   Get led type.
+ *
+ * @param   id Led id.
+ * @param   type Returns the led type.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+int32_t led_manager_get_type(led_id_e id, led_type_e* type)
+{
+    if (id >= LED_ID_BUTT)
+    {
+        return -EINVAL;
+    }
+
+    if (!type)
+    {
+        return -EINVAL;
+    }
+
+    *type = led_manager_handle.type[id];
+
+    return 0;
 }
 
 /**
@@ -224,7 +289,6 @@ static int32_t led_manager_probe(const object* obj)
 {
     led_manager_handle_t* handle = (led_manager_handle_t*)obj->object_data;
     int32_t ret;
-    uint32_t i;
 
     (void)memset(handle, 0, sizeof(led_manager_handle_t));
 
@@ -238,24 +302,6 @@ static int32_t led_manager_probe(const object* obj)
         return ret;
     }
 
-    for (i = 0; i < LED_ID_BUTT; i++)
-    {
-        handle->timer[i] = osTimerNew(
-            led_manager_timer_callback,
-            osTimerOnce,
-            (void*)i,
-            &led_manager_timer_attr);
-        if (!handle->timer[i])
-        {
-            led_error(
-                "Manager <%s> create timer %d <%s> failed.",
-                obj->name,
-                i,
-                led_manager_timer_attr.name);
-            return -EINVAL;
-        }
-    }
-
     led_info("Manager <%s> probe succeed.", obj->name);
 
     return 0;
@@ -270,24 +316,12 @@ static int32_t led_manager_probe(const object* obj)
  */
 static int32_t led_manager_shutdown(const object* obj)
 {
-    led_manager_handle_t* handle = (led_manager_handle_t*)obj->object_data;
-    osStatus_t stat;
     int32_t ret;
     uint32_t i;
 
     for (i = 0; i < LED_ID_BUTT; i++)
     {
-        stat = osTimerDelete(handle->timer[i]);
-        if (stat != osOK)
-        {
-            led_error(
-                "Manager <%s> delete timer %d <%s> failed, stat %d",
-                obj->name,
-                i,
-                led_manager_timer_attr.name,
-                stat);
-            return -EINVAL;
-        }
+        (void)service_timer_cancel(LED_MANAGER_TIMER_KEY(i));
     }
 
     ret = led_deinit();
@@ -304,8 +338,81 @@ static int32_t led_manager_shutdown(const object* obj)
     return 0;
 }
 
-module_middleware(CONFIG_LED_MANAGER_NAME,
+/**
+ * @brief   Suspend the led manager, the leds are turned off.
+ *
+ * @param   obj Pointer to the led manager object handle.
+ * @param   level Suspend level.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t led_manager_suspend(const object* obj, int32_t level)
+{
+    int32_t ret;
+    uint32_t i;
+
+    for (i = 0; i < LED_ID_BUTT; i++)
+    {
+        (void)service_timer_cancel(LED_MANAGER_TIMER_KEY(i));
+    }
+
+    ret = led_deinit();
+    if (ret)
+    {
+        led_error("Manager <%s> suspend level %d failed, ret %d.",
+                  obj->name,
+                  level,
+                  ret);
+        return ret;
+    }
+
+    led_debug("Manager <%s> suspend level %d succeed.", obj->name, level);
+
+    return 0;
+}
+
+/**
+ * @brief   Resume the led manager, the leds are restored to their types.
+ *
+ * @param   obj Pointer to the led manager object handle.
+ * @param   level Resume level.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static int32_t led_manager_resume(const object* obj, int32_t level)
+{
+    led_manager_handle_t* handle = (led_manager_handle_t*)obj->object_data;
+    int32_t ret;
+    uint32_t i;
+
+    ret = led_init();
+    if (ret)
+    {
+        led_error("Manager <%s> resume level %d failed, ret %d.",
+                  obj->name,
+                  level,
+                  ret);
+        return ret;
+    }
+
+    for (i = 0; i < LED_ID_BUTT; i++)
+    {
+        (void)led_manager_apply((led_id_e)i, handle->type[i]);
+    }
+
+    led_debug("Manager <%s> resume level %d succeed.", obj->name, level);
+
+    return 0;
+}
+
+module_middleware_pm(CONFIG_LED_MANAGER_NAME,
+                     CONFIG_LED_MANAGER_LABEL,
+                     led_manager_probe,
+                     led_manager_shutdown,
+                     led_manager_suspend,
+                     led_manager_resume,
+                     NULL, &led_manager_handle, NULL);
+
+DECLARE_OBJECT_PM(CONFIG_LED_MANAGER_NAME,
                   CONFIG_LED_MANAGER_LABEL,
-                  led_manager_probe,
-                  led_manager_shutdown,
-                  NULL, &led_manager_handle, NULL);
+                  CONFIG_LED_MANAGER_AUTOSUSPEND_MS);
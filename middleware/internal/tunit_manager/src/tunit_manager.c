@@ -21,6 +21,7 @@
 #include <string.h>
 #include "cmsis_os.h"
 #include "framework.h"
+#include "ring_typed.h"
 #include "tunit_manager.h"
 
 #define tunit_error(str, ...)   pr_error(str, ## __VA_ARGS__)
@@ -116,12 +117,25 @@ static int32_t tunit_manager_register_suite_and_case(void)
  * @param   None.
  *
  * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    The CUnit registry is built by the first run, the manager is held
+ *          during the run so it is not shut down under the tests.
  */
 int32_t tunit_manager_run_tests(void)
 {
     CU_ErrorCode error_code;
+    int32_t ret;
+
+    ret = object_get(CONFIG_TUNIT_MANAGER_NAME);
+    if (ret)
+    {
+        return ret;
+    }
 
     error_code = CU_basic_run_tests();
+
+    (void)object_put(CONFIG_TUNIT_MANAGER_NAME);
+
     if (error_code != CUE_SUCCESS)
     {
         return -EINVAL;
@@ -190,6 +204,11 @@ module_middleware(CONFIG_TUNIT_MANAGER_NAME,
                   tunit_manager_shutdown,
                   NULL, &tunit_manager_handle, NULL);
 
+/* The CUnit registry is only needed to run the tests, it is built then */
+DECLARE_OBJECT_LAZY(CONFIG_TUNIT_MANAGER_NAME,
+                    CONFIG_TUNIT_MANAGER_LABEL,
+                    CONFIG_TUNIT_MANAGER_IDLE_MS);
+
 #ifdef CONFIG_TUNIT_MANAGER_INTERNAL_CASE_ENABLE
 static int tunit_bist_initialize(void)
 {
@@ -229,4 +248,289 @@ DECLARE_TUNIT_CASE("Built-in self-test",
                    "Test case 2",
                    test_case_2,
                    tunit_bist_case_2);
+
+static int32_t tunit_pm_suspend_ret;
+static int32_t tunit_pm_resume_ret;
+static uint32_t tunit_pm_suspend_calls;
+static uint32_t tunit_pm_resume_calls;
+static int32_t tunit_pm_last_level;
+
+static int32_t tunit_pm_suspend(const object* obj, int32_t level)
+{
+    (void)obj;
+
+    tunit_pm_suspend_calls++;
+    tunit_pm_last_level = level;
+
+    return tunit_pm_suspend_ret;
+}
+
+static int32_t tunit_pm_resume(const object* obj, int32_t level)
+{
+    (void)obj;
+
+    tunit_pm_resume_calls++;
+    tunit_pm_last_level = level;
+
+    return tunit_pm_resume_ret;
+}
+
+/* Not in an object section, only the state machine sees it */
+static const object tunit_pm_object =
+{
+    .name       = "tunit pm",
+    .suspend    = tunit_pm_suspend,
+    .resume     = tunit_pm_resume,
+};
+
+static object_pm_t tunit_pm;
+
+static int tunit_pm_initialize(void)
+{
+    return 0;
+}
+
+static int tunit_pm_cleanup(void)
+{
+    return 0;
+}
+
+static void tunit_pm_reset(uint32_t autosuspend_ms)
+{
+    object_pm_reset(&tunit_pm);
+
+    tunit_pm.runtime = 1;
+    tunit_pm.autosuspend_ms = autosuspend_ms;
+
+    tunit_pm_suspend_ret = 0;
+    tunit_pm_resume_ret = 0;
+    tunit_pm_suspend_calls = 0;
+    tunit_pm_resume_calls = 0;
+    tunit_pm_last_level = -1;
+}
+
+static void tunit_pm_case_autosuspend(void)
+{
+    tunit_pm_reset(100);
+
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_get(&tunit_pm_object, &tunit_pm), 0);
+    TUNIT_ASSERT_EQUAL(tunit_pm.usage, 1);
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_idle(&tunit_pm_object, &tunit_pm, 0),
+                       -EBUSY);
+
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_put(&tunit_pm_object, &tunit_pm, 1000),
+                       0);
+    TUNIT_ASSERT_EQUAL(tunit_pm.state, OBJECT_PM_STATE_ACTIVE);
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_idle(&tunit_pm_object,
+                                              &tunit_pm,
+                                              1099),
+                       -EBUSY);
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_idle(&tunit_pm_object,
+                                              &tunit_pm,
+                                              1100),
+                       0);
+    TUNIT_ASSERT_EQUAL(tunit_pm.state, OBJECT_PM_STATE_SUSPENDED);
+    TUNIT_ASSERT_EQUAL(tunit_pm_suspend_calls, 1);
+    TUNIT_ASSERT_EQUAL(tunit_pm_last_level, OBJECT_PM_LEVEL_RUNTIME);
+
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_get(&tunit_pm_object, &tunit_pm), 0);
+    TUNIT_ASSERT_EQUAL(tunit_pm.state, OBJECT_PM_STATE_ACTIVE);
+    TUNIT_ASSERT_EQUAL(tunit_pm_resume_calls, 1);
+    TUNIT_ASSERT_EQUAL(tunit_pm.suspend_count, 1);
+    TUNIT_ASSERT_EQUAL(tunit_pm.resume_count, 1);
+}
+
+static void tunit_pm_case_put_suspend(void)
+{
+    tunit_pm_reset(0);
+
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_put(&tunit_pm_object, &tunit_pm, 0),
+                       -EINVAL);
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_get(&tunit_pm_object, &tunit_pm), 0);
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_get(&tunit_pm_object, &tunit_pm), 0);
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_put(&tunit_pm_object, &tunit_pm, 0),
+                       0);
+    TUNIT_ASSERT_EQUAL(tunit_pm.state, OBJECT_PM_STATE_ACTIVE);
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_put(&tunit_pm_object, &tunit_pm, 0),
+                       0);
+    TUNIT_ASSERT_EQUAL(tunit_pm.state, OBJECT_PM_STATE_SUSPENDED);
+    TUNIT_ASSERT_EQUAL(tunit_pm_suspend_calls, 1);
+}
+
+static void tunit_pm_case_failure(void)
+{
+    tunit_pm_reset(0);
+
+    tunit_pm_suspend_ret = -EIO;
+    TUNIT_ASSERT_EQUAL(object_pm_suspend_one(&tunit_pm_object,
+                                             &tunit_pm,
+                                             OBJECT_PM_LEVEL_SLEEP),
+                       -EIO);
+    TUNIT_ASSERT_EQUAL(tunit_pm.state, OBJECT_PM_STATE_ACTIVE);
+    TUNIT_ASSERT_EQUAL(tunit_pm.error_count, 1);
+
+    tunit_pm_suspend_ret = 0;
+    TUNIT_ASSERT_EQUAL(object_pm_suspend_one(&tunit_pm_object,
+                                             &tunit_pm,
+                                             OBJECT_PM_LEVEL_SLEEP),
+                       0);
+    TUNIT_ASSERT_EQUAL(tunit_pm_last_level, OBJECT_PM_LEVEL_SLEEP);
+
+    /* Suspending twice does not call the hook again */
+    TUNIT_ASSERT_EQUAL(object_pm_suspend_one(&tunit_pm_object,
+                                             &tunit_pm,
+                                             OBJECT_PM_LEVEL_SLEEP),
+                       0);
+    TUNIT_ASSERT_EQUAL(tunit_pm_suspend_calls, 2);
+
+    tunit_pm_resume_ret = -EIO;
+    TUNIT_ASSERT_EQUAL(object_pm_resume_one(&tunit_pm_object,
+                                            &tunit_pm,
+                                            OBJECT_PM_LEVEL_SLEEP),
+                       -EIO);
+    TUNIT_ASSERT_EQUAL(tunit_pm.state, OBJECT_PM_STATE_ERROR);
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_get(&tunit_pm_object, &tunit_pm),
+                       -EIO);
+    TUNIT_ASSERT_EQUAL(tunit_pm.usage, 0);
+}
+
+static void tunit_pm_case_system(void)
+{
+    tunit_pm_reset(0);
+
+    TUNIT_ASSERT_EQUAL(object_pm_suspend_one(&tunit_pm_object,
+                                             &tunit_pm,
+                                             OBJECT_PM_LEVEL_STOP),
+                       0);
+    tunit_pm.system = 1;
+
+    /* No runtime user while the system is suspended */
+    TUNIT_ASSERT_EQUAL(object_pm_runtime_get(&tunit_pm_object, &tunit_pm),
+                       -EBUSY);
+    TUNIT_ASSERT_EQUAL(tunit_pm_resume_calls, 0);
+
+    tunit_pm.system = 0;
+    TUNIT_ASSERT_EQUAL(object_pm_resume_one(&tunit_pm_object,
+                                            &tunit_pm,
+                                            OBJECT_PM_LEVEL_STOP),
+                       0);
+    TUNIT_ASSERT_EQUAL(tunit_pm_last_level, OBJECT_PM_LEVEL_STOP);
+    TUNIT_ASSERT_TRUE(tunit_pm.resume_max_cycles >= tunit_pm.resume_cycles);
+}
+
+DECLARE_TUNIT_SUITE("Object runtime pm",
+                    object_pm,
+                    tunit_pm_initialize,
+                    tunit_pm_cleanup);
+
+DECLARE_TUNIT_CASE("Object runtime pm",
+                   "Autosuspend",
+                   pm_autosuspend,
+                   tunit_pm_case_autosuspend);
+
+DECLARE_TUNIT_CASE("Object runtime pm",
+                   "Suspend on last put",
+                   pm_put_suspend,
+                   tunit_pm_case_put_suspend);
+
+DECLARE_TUNIT_CASE("Object runtime pm",
+                   "Hook failure",
+                   pm_failure,
+                   tunit_pm_case_failure);
+
+DECLARE_TUNIT_CASE("Object runtime pm",
+                   "System suspend",
+                   pm_system,
+                   tunit_pm_case_system);
+
+DECLARE_RING_TYPED(tunit_ring_reject, message_t, 4, RING_TYPED_REJECT_NEWEST);
+DECLARE_RING_TYPED(tunit_ring_overwrite,
+                   message_t,
+                   4,
+                   RING_TYPED_OVERWRITE_OLDEST);
+
+static message_t tunit_ring_in[6];
+static message_t tunit_ring_out[6];
+
+static int tunit_ring_initialize(void)
+{
+    uint32_t i;
+
+    (void)memset(tunit_ring_in, 0, sizeof(tunit_ring_in));
+
+    for (i = 0; i < 6; i++)
+    {
+        tunit_ring_in[i].id = i;
+    }
+
+    return 0;
+}
+
+static int tunit_ring_cleanup(void)
+{
+    return 0;
+}
+
+static void tunit_ring_case_reject(void)
+{
+    static tunit_ring_reject_t ring;
+    message_t message;
+
+    tunit_ring_reject_init(&ring);
+
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_get(&ring, &message), -EEMPTY);
+    TUNIT_ASSERT_PTR_NULL(tunit_ring_reject_peek(&ring));
+
+    /* Wrap the head, then fill up */
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_put_n(&ring, tunit_ring_in, 3), 3);
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_get_n(&ring, tunit_ring_out, 2), 2);
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_put_n(&ring, &tunit_ring_in[3], 3), 3);
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_get_free(&ring), 0);
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_put(&ring, tunit_ring_in), -EFULL);
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_put_n(&ring, tunit_ring_in, 1), 0);
+
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_peek(&ring)->id, 2);
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_get_n(&ring, tunit_ring_out, 6), 4);
+    TUNIT_ASSERT_EQUAL(tunit_ring_out[0].id, 2);
+    TUNIT_ASSERT_EQUAL(tunit_ring_out[3].id, 5);
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_get_used(&ring), 0);
+    TUNIT_ASSERT_EQUAL(tunit_ring_reject_get_dropped(&ring), 0);
+}
+
+static void tunit_ring_case_overwrite(void)
+{
+    static tunit_ring_overwrite_t ring;
+    message_t message;
+
+    tunit_ring_overwrite_init(&ring);
+
+    TUNIT_ASSERT_EQUAL(tunit_ring_overwrite_put_n(&ring, tunit_ring_in, 3), 3);
+    TUNIT_ASSERT_EQUAL(tunit_ring_overwrite_put(&ring, &tunit_ring_in[3]), 0);
+    TUNIT_ASSERT_EQUAL(tunit_ring_overwrite_put(&ring, &tunit_ring_in[4]), 0);
+    TUNIT_ASSERT_EQUAL(tunit_ring_overwrite_get_dropped(&ring), 1);
+    TUNIT_ASSERT_EQUAL(tunit_ring_overwrite_get(&ring, &message), 0);
+    TUNIT_ASSERT_EQUAL(message.id, 1);
+
+    /* More than the capacity keeps only the newest items */
+    TUNIT_ASSERT_EQUAL(tunit_ring_overwrite_put_n(&ring, tunit_ring_in, 6), 4);
+    TUNIT_ASSERT_EQUAL(tunit_ring_overwrite_get_dropped(&ring), 6);
+    TUNIT_ASSERT_EQUAL(tunit_ring_overwrite_get_n(&ring, tunit_ring_out, 6), 4);
+    TUNIT_ASSERT_EQUAL(tunit_ring_out[0].id, 2);
+    TUNIT_ASSERT_EQUAL(tunit_ring_out[3].id, 5);
+}
+
+DECLARE_TUNIT_SUITE("Typed ring",
+                    ring_typed,
+                    tunit_ring_initialize,
+                    tunit_ring_cleanup);
+
+DECLARE_TUNIT_CASE("Typed ring",
+                   "Reject newest",
+                   ring_reject,
+                   tunit_ring_case_reject);
+
+DECLARE_TUNIT_CASE("Typed ring",
+                   "Overwrite oldest",
+                   ring_overwrite,
+                   tunit_ring_case_overwrite);
 #endif
@@ -44,8 +44,14 @@
 #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
  #include <stdint.h>
  extern uint32_t SystemCoreClock;
+ extern void object_pm_sleep_enter(uint32_t* idle_ticks);
+ extern void object_pm_sleep_exit(uint32_t idle_ticks);
+ extern void object_pm_sleep_account(uint32_t ticks);
 #endif
 
+/* Only macros, so it is safe for the assembler too. */
+#include "framework_conf.h"
+
 #ifndef CMSIS_device_header
 #define CMSIS_device_header "stm32wbxx.h"
 #endif /* CMSIS_device_header */
@@ -70,6 +76,20 @@
 #define configUSE_COUNTING_SEMAPHORES     1
 #define configGENERATE_RUN_TIME_STATS     0
 
+/* Tickless idle sleeps through the idle ticks, it needs the low power
+ * sleep of the board, refer to object_pm_sleep_enter and
+ * object_pm_sleep_prepare */
+#ifdef CONFIG_OBJECT_PM_TICKLESS_IDLE_ENABLE
+#define configUSE_TICKLESS_IDLE           1
+
+/* Tickless idle hooks of the object power management. */
+#define configPRE_SLEEP_PROCESSING(x)     object_pm_sleep_enter(&(x))
+#define configPOST_SLEEP_PROCESSING(x)    object_pm_sleep_exit(x)
+#define traceINCREASE_TICK_COUNT(x)       object_pm_sleep_account(x)
+#else
+#define configUSE_TICKLESS_IDLE           0
+#endif
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES           0
 #define configMAX_CO_ROUTINE_PRIORITIES (2)
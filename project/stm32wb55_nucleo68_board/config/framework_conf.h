@@ -23,63 +23,139 @@
 #define CONFIG_BOARD_NAME "P-NUCLEO-WB55"
 
 #define CONFIG_MSG_SEND_BLOCK_TIMEOUT_MS 50
+#define CONFIG_MSG_BROADCAST_BUDGET_MS 50
+#define CONFIG_MSG_URGENT_COUNT 4
+#define CONFIG_MSG_RPC_SLOT_NUM 4
+#define CONFIG_MSG_RPC_TIMEOUT_MS 100
+
+#define CONFIG_MSG_REGISTRY_NAME "msg registry"
+#define CONFIG_MSG_REGISTRY_LABEL msg_registry
+#define CONFIG_MSG_FORMAT_BUF_SIZE 96
+
+#define CONFIG_MSG_TRACE_ID_NUM 4
+
+#define CONFIG_MSG_CAPTURE_RECORD_NUM 128
+
+#define CONFIG_MSG_EVENT_NAME "msg event"
+#define CONFIG_MSG_EVENT_LABEL msg_event
+#define CONFIG_MSG_EVENT_THREAD_NAME "msg event thread"
+#define CONFIG_MSG_EVENT_THREAD_STACK_SIZE 1024
+#define CONFIG_MSG_EVENT_THREAD_PRIORITY osPriorityHigh
+#define CONFIG_MSG_EVENT_RING_SIZE 16
+
+#define CONFIG_MSG_TIMER_NAME "msg timer"
+#define CONFIG_MSG_TIMER_LABEL msg_timer
+#define CONFIG_MSG_TIMER_THREAD_NAME "msg timer thread"
+#define CONFIG_MSG_TIMER_THREAD_STACK_SIZE 1024
+#define CONFIG_MSG_TIMER_THREAD_PRIORITY osPriorityAboveNormal
+#define CONFIG_MSG_TIMER_NUM 16
+#define CONFIG_MSG_TIMER_TICK_MS 10
+#define CONFIG_MSG_TIMER_WHEEL_BITS 5
+
+#define CONFIG_MSG_HANDLER_BUDGET_MS 50
+#define CONFIG_MSG_SUPERVISOR_NAME "msg supervisor"
+#define CONFIG_MSG_SUPERVISOR_LABEL msg_supervisor
+#define CONFIG_MSG_SUPERVISOR_PERIOD_MS 100
+#define CONFIG_MSG_SUPERVISOR_STUCK_FACTOR 4
+#define CONFIG_MSG_SUPERVISOR_WATCHDOG_TIMEOUT_MS 4000
+
+#define CONFIG_SERVICE_POOL_THREAD_NAME "svc worker"
+#define CONFIG_SERVICE_POOL_THREAD_STACK_SIZE 2048
+#define CONFIG_SERVICE_POOL_THREAD_PRIORITY osPriorityNormal
+#define CONFIG_SERVICE_POOL_QUEUE_NAME "svc ready queue"
+#define CONFIG_SERVICE_POOL_WORKER_NUM 1
+#define CONFIG_SERVICE_STOP_TIMEOUT_MS 1000
+
+#define CONFIG_MSG_PAYLOAD_NAME "msg payload"
+#define CONFIG_MSG_PAYLOAD_LABEL msg_payload
+#define CONFIG_MSG_PAYLOAD_POOL_NAME "msg payload pool"
+#define CONFIG_MSG_PAYLOAD_BLOCK_SIZE 128
+#define CONFIG_MSG_PAYLOAD_BLOCK_COUNT 8
 
 #define CONFIG_INIT_THREAD_NAME "init thread"
 #define CONFIG_INIT_THREAD_STACK_SIZE 1024
 #define CONFIG_INIT_THREAD_PRIORITY osPriorityRealtime
 
+#define CONFIG_OBJECT_PROBE_THREAD_NAME "probe worker"
+#define CONFIG_OBJECT_PROBE_THREAD_STACK_SIZE 1024
+#define CONFIG_OBJECT_PROBE_THREAD_PRIORITY osPriorityRealtime
+#define CONFIG_OBJECT_PROBE_WORKER_NUM 2
+#define CONFIG_OBJECT_LAZY_MUTEX_NAME "object lazy mutex"
+#define CONFIG_OBJECT_LAZY_CHECK_PERIOD_MS 1000
+#define CONFIG_OBJECT_PM_MUTEX_NAME "object pm mutex"
+#define CONFIG_OBJECT_PM_CHECK_PERIOD_MS 100
+
+#define CONFIG_BOOT_PROFILE_ENTRY_NUM 48
+
 #define CONFIG_MMI_SERVICE_NAME "mmi service"
 #define CONFIG_MMI_SERVICE_LABEL mmi_service
+#define CONFIG_MMI_SERVICE_BACKEND SERVICE_BACKEND_THREAD
 #define CONFIG_MMI_SERVICE_THREAD_NAME "mmi thread"
 #define CONFIG_MMI_SERVICE_THREAD_STACK_SIZE 2048
 #define CONFIG_MMI_SERVICE_THREAD_PRIORITY osPriorityNormal
 #define CONFIG_MMI_SERVICE_QUEUE_NAME "mmi queue"
 #define CONFIG_MMI_SERVICE_MSG_COUNT 10
+#define CONFIG_MMI_SERVICE_BATCH_COUNT 1
+#define CONFIG_MMI_SERVICE_HANDLER_BUDGET_MS 100
+#define CONFIG_MMI_SERVICE_RESTART_THREAD_NAME "restart thread"
+#define CONFIG_MMI_SERVICE_RESTART_THREAD_STACK_SIZE 1024
+#define CONFIG_MMI_SERVICE_RESTART_THREAD_PRIORITY osPriorityBelowNormal
 #define CONFIG_MMI_SERVICE_INTERNAL_COMMAND_ENABLE
 
 #define CONFIG_LED_SERVICE_NAME "led service"
 #define CONFIG_LED_SERVICE_LABEL led_service
+#define CONFIG_LED_SERVICE_BACKEND SERVICE_BACKEND_POOL
 #define CONFIG_LED_SERVICE_THREAD_NAME "led thread"
 #define CONFIG_LED_SERVICE_THREAD_STACK_SIZE 2048
 #define CONFIG_LED_SERVICE_THREAD_PRIORITY osPriorityNormal
 #define CONFIG_LED_SERVICE_QUEUE_NAME "led queue"
 #define CONFIG_LED_SERVICE_MSG_COUNT 10
+#define CONFIG_LED_SERVICE_BATCH_COUNT 4
+#define CONFIG_LED_SERVICE_HANDLER_BUDGET_MS 20
+#define CONFIG_LED_SERVICE_MAILBOX_COUNT 3
 
 #define CONFIG_LED_MANAGER_NAME "led manager"
 #define CONFIG_LED_MANAGER_LABEL led_manager
-#define CONFIG_LED_MANAGER_TIMER_NAME "led manager timer"
 #define CONFIG_LED_MANAGER_QUICK_FLASH_INTERVAL_MS 300
 #define CONFIG_LED_MANAGER_SLOW_FLASH_INTERVAL_MS 1000
+#define CONFIG_LED_MANAGER_AUTOSUSPEND_MS 2000
 
 #define CONFIG_BUTTON_SERVICE_NAME "button service"
 #define CONFIG_BUTTON_SERVICE_LABEL button_service
+#define CONFIG_BUTTON_SERVICE_BACKEND SERVICE_BACKEND_THREAD
 #define CONFIG_BUTTON_SERVICE_THREAD_NAME "button thread"
 #define CONFIG_BUTTON_SERVICE_THREAD_STACK_SIZE 2048
 #define CONFIG_BUTTON_SERVICE_THREAD_PRIORITY osPriorityNormal
 #define CONFIG_BUTTON_SERVICE_QUEUE_NAME "button queue"
 #define CONFIG_BUTTON_SERVICE_MSG_COUNT 10
+#define CONFIG_BUTTON_SERVICE_BATCH_COUNT 4
+#define CONFIG_BUTTON_SERVICE_HANDLER_BUDGET_MS 60
 
 #define CONFIG_BUTTON_MANAGER_NAME "button manager"
 #define CONFIG_BUTTON_MANAGER_LABEL button_manager
-#define CONFIG_BUTTON_MANAGER_TIMER_NAME "button manager timer"
 #define CONFIG_BUTTON_MANAGER_TIMER_INTERVAL_MS 20
 #define CONFIG_BUTTON_MANAGER_TIMER_LONGLONG_CLICK_MS 10000
 #define CONFIG_BUTTON_MANAGER_TIMER_LONG_CLICK_MS 5000
 
 #define CONFIG_TUNIT_SERVICE_NAME "tunit service"
 #define CONFIG_TUNIT_SERVICE_LABEL tunit_service
+#define CONFIG_TUNIT_SERVICE_BACKEND SERVICE_BACKEND_THREAD
 #define CONFIG_TUNIT_SERVICE_THREAD_NAME "tunit thread"
 #define CONFIG_TUNIT_SERVICE_THREAD_STACK_SIZE 2048
 #define CONFIG_TUNIT_SERVICE_THREAD_PRIORITY osPriorityNormal
 #define CONFIG_TUNIT_SERVICE_QUEUE_NAME "tunit queue"
 #define CONFIG_TUNIT_SERVICE_MSG_COUNT 10
+#define CONFIG_TUNIT_SERVICE_BATCH_COUNT 1
+#define CONFIG_TUNIT_SERVICE_HANDLER_BUDGET_MS 1000
 
 #define CONFIG_TUNIT_MANAGER_NAME "tunit manager"
 #define CONFIG_TUNIT_MANAGER_LABEL tunit_manager
+#define CONFIG_TUNIT_MANAGER_IDLE_MS 5000
 #define CONFIG_TUNIT_MANAGER_INTERNAL_CASE_ENABLE
 
 #define CONFIG_CRC_MANAGER_NAME "crc manager"
 #define CONFIG_CRC_MANAGER_LABEL crc_manager
+#define CONFIG_CRC_MANAGER_IDLE_MS 5000
 
 #define CONFIG_CLOCK_MANAGER_NAME "sys manager"
 #define CONFIG_CLOCK_MANAGER_LABEL sys_manager
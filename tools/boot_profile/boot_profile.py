@@ -0,0 +1,99 @@
+#!/usr/bin/python
+
+import argparse
+import csv
+import re
+import sys
+
+# Lines printed by the boot_csv command
+BEGIN_PATTERN = re.compile(r"@boot-begin (\S+) (\d+) (\d+)")
+LINE_PATTERN = re.compile(r"@boot (.+?)\s*$")
+END_PATTERN = re.compile(r"@boot-end")
+
+def parse_log(path):
+	version = None
+	rows = []
+	stream = sys.stdin if path == "-" else open(path)
+	for line in stream:
+		match = BEGIN_PATTERN.search(line)
+		if match:
+			version = match.group(1)
+			rows = []
+			if int(match.group(3)):
+				print("Warning: {} entries were lost on target.".format(match.group(3)))
+			continue
+		if END_PATTERN.search(line):
+			continue
+		match = LINE_PATTERN.search(line)
+		if match and version is not None:
+			rows.append(match.group(1).split(","))
+	if version is None or not rows:
+		sys.exit("No boot record found in {}.".format(path))
+	return version, rows
+
+def load_csv(path):
+	with open(path) as f:
+		return list(csv.DictReader(f))
+
+def entry_key(row):
+	return "{}:{}".format(row["kind"], row["name"])
+
+def summary(rows):
+	for row in rows:
+		if row["kind"] == "phase" and row["name"] == "startup completed":
+			print("Startup completed at {} us.".format(row["start_us"]))
+	print("{:<32} {:>10} {:>10} {:>8} {:>8}".format("entry", "start us", "us", "heap", "stack"))
+	for row in sorted(rows, key=lambda r: -int(r["us"])):
+		print("{:<32} {:>10} {:>10} {:>8} {:>8}".format(entry_key(row), row["start_us"], row["us"],
+		      int(row["heap_before"]) - int(row["heap_after"]), row["stack_free"]))
+
+def compare(base_rows, rows, threshold):
+	base = dict((entry_key(row), row) for row in base_rows)
+	regressions = 0
+	print("{:<32} {:>10} {:>10} {:>8}".format("entry", "base us", "us", "delta"))
+	for row in rows:
+		key = entry_key(row)
+		us = int(row["us"])
+		if key not in base:
+			print("{:<32} {:>10} {:>10} {:>8}".format(key, "-", us, "new"))
+			continue
+		base_us = int(base.pop(key)["us"])
+		delta = us - base_us
+		mark = ""
+		if delta > 0 and delta * 100 > base_us * threshold:
+			mark = " !"
+			regressions += 1
+		print("{:<32} {:>10} {:>10} {:>+8}{}".format(key, base_us, us, delta, mark))
+	for key in base:
+		print("{:<32} {:>10} {:>10} {:>8}".format(key, base[key]["us"], "-", "gone"))
+	print("{} entries slower by more than {}%.".format(regressions, threshold))
+	return regressions
+
+def main():
+	parser = argparse.ArgumentParser(description="Extract, print and compare the boot records dumped by the boot_csv command.")
+	parser.add_argument("--log", metavar="FILE", help="Extract the boot record from the console log FILE, '-' for stdin.")
+	parser.add_argument("-o", "--output", metavar="FILE", help="Write the extracted boot record to the CSV FILE.")
+	parser.add_argument("--show", metavar="FILE", help="Print the CSV FILE, the slowest entry first.")
+	parser.add_argument("--compare", nargs=2, metavar=("BASE", "FILE"), help="Compare the CSV FILE against the CSV BASE.")
+	parser.add_argument("--threshold", type=int, default=10, help="Regression threshold in percent, default 10.")
+	args = parser.parse_args()
+
+	if args.log:
+		version, rows = parse_log(args.log)
+		if args.output:
+			with open(args.output, "w") as f:
+				f.write("\n".join(",".join(row) for row in rows) + "\n")
+			print("Boot record of {} written to {}.".format(version, args.output))
+		else:
+			print("Boot record of {}.".format(version))
+			print("\n".join(",".join(row) for row in rows))
+
+	if args.show:
+		summary(load_csv(args.show))
+
+	if args.compare:
+		if compare(load_csv(args.compare[0]), load_csv(args.compare[1]), args.threshold):
+			sys.exit(1)
+
+if __name__ == "__main__":
+	main()
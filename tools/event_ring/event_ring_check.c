@@ -0,0 +1,215 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Host stress of the event ring, the producer threads stand in for the
+ * interrupts of the target and one consumer thread for the dispatcher. Every
+ * item carries its producer and a sequence number, so the consumer finds the
+ * lost, duplicated and reordered items of every producer.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "event_ring.h"
+
+#define EVENT_CHECK_SLOTS       64
+#define EVENT_CHECK_PRODUCERS   16
+
+/**
+ * @brief   Item of the check, the size of a service event on target.
+ */
+typedef struct
+{
+    uint32_t    producer;
+    uint32_t    seq;
+    uint32_t    check;
+    uint32_t    param[5];
+} event_check_item_t;
+
+static event_ring_t event_check_ring;
+static uint32_t event_check_seq[EVENT_CHECK_SLOTS];
+static event_check_item_t event_check_items[EVENT_CHECK_SLOTS];
+
+static uint32_t event_check_count;
+static volatile uint32_t event_check_done;
+static uint32_t event_check_full[EVENT_CHECK_PRODUCERS];
+
+static double event_check_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* event_check_producer(void* argument)
+{
+    uint32_t producer = (uint32_t)(uintptr_t)argument;
+    event_check_item_t item;
+    uint32_t i;
+
+    item.producer = producer;
+
+    for (i = 0; i < event_check_count; )
+    {
+        item.seq = i;
+        item.check = producer ^ i ^ 0x5a5a5a5a;
+        item.param[0] = item.param[4] = i;
+
+        if (event_ring_put(&event_check_ring, &item))
+        {
+            event_check_full[producer]++;
+            (void)sched_yield();
+            continue;
+        }
+
+        i++;
+    }
+
+    (void)__sync_fetch_and_add(&event_check_done, 1);
+
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    pthread_t producer[EVENT_CHECK_PRODUCERS];
+    uint32_t next[EVENT_CHECK_PRODUCERS] = { 0 };
+    event_check_item_t item;
+    uint32_t producers = 4;
+    uint32_t received = 0;
+    uint32_t lost = 0;
+    uint32_t duplicated = 0;
+    uint32_t corrupted = 0;
+    uint32_t full = 0;
+    uint32_t total;
+    uint32_t i;
+    double start;
+    double elapsed;
+
+    event_check_count = 1000000;
+
+    if (argc > 1)
+    {
+        producers = (uint32_t)atoi(argv[1]);
+    }
+
+    if (argc > 2)
+    {
+        event_check_count = (uint32_t)atoi(argv[2]);
+    }
+
+    if (!producers || producers > EVENT_CHECK_PRODUCERS || !event_check_count)
+    {
+        printf("Producers must be 1 to %d, items at least 1.\n",
+               EVENT_CHECK_PRODUCERS);
+        return 1;
+    }
+
+    (void)event_ring_init(&event_check_ring,
+                          event_check_seq,
+                          event_check_items,
+                          sizeof(event_check_item_t),
+                          EVENT_CHECK_SLOTS);
+
+    total = producers * event_check_count;
+    start = event_check_now();
+
+    for (i = 0; i < producers; i++)
+    {
+        if (pthread_create(&producer[i],
+                           NULL,
+                           event_check_producer,
+                           (void*)(uintptr_t)i))
+        {
+            printf("Create producer %u failed.\n", i);
+            return 1;
+        }
+    }
+
+    while (received < total)
+    {
+        if (event_ring_get(&event_check_ring, &item))
+        {
+            /* The producers are done and a lost item never shows up */
+            if (event_check_done == producers &&
+                event_ring_get_used(&event_check_ring) == 0)
+            {
+                break;
+            }
+
+            (void)sched_yield();
+            continue;
+        }
+
+        received++;
+
+        if (item.producer >= producers ||
+            item.check != (item.producer ^ item.seq ^ 0x5a5a5a5a) ||
+            item.param[0] != item.seq || item.param[4] != item.seq)
+        {
+            corrupted++;
+            continue;
+        }
+
+        /* A producer claims its slots in order, so they must come in order */
+        if (item.seq < next[item.producer])
+        {
+            duplicated++;
+            continue;
+        }
+
+        lost += item.seq - next[item.producer];
+        next[item.producer] = item.seq + 1;
+    }
+
+    elapsed = event_check_now() - start;
+
+    for (i = 0; i < producers; i++)
+    {
+        (void)pthread_join(producer[i], NULL);
+
+        lost += event_check_count - next[i];
+        full += event_check_full[i];
+    }
+
+    if (event_ring_get(&event_check_ring, &item) != -EEMPTY)
+    {
+        duplicated++;
+    }
+
+    printf("event_ring %u producers, %u items through %u slots, "
+           "%.0f items/s\n",
+           producers,
+           total,
+           EVENT_CHECK_SLOTS,
+           total / elapsed);
+    printf("%u lost, %u duplicated or reordered, %u corrupted\n",
+           lost,
+           duplicated,
+           corrupted);
+    printf("%u claims lost to another producer, %u puts on a full ring\n",
+           event_check_ring.contention,
+           full);
+
+    return (lost || duplicated || corrupted) ? 1 : 0;
+}
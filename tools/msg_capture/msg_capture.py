@@ -0,0 +1,116 @@
+#!/usr/bin/python
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "../msg_decoder"))
+import msg_decoder
+
+# Trace file, a header followed by the records of service_capture_record_t
+FILE_MAGIC = b"MCAP"
+FILE_VERSION = 2
+FILE_HEADER = struct.Struct("<4sHHII")      # magic, version, record size, timestamp frequency, record count
+RECORD = struct.Struct("<IIBBBB4I")         # timestamp in ms, id, source, target, lane, reserved, param0..3
+
+SOURCE_THREAD = 0xfd
+SOURCE_ISR = 0xfe
+TARGET_BROADCAST = 0xff
+
+# Lines printed by the cap_dump command
+BEGIN_PATTERN = re.compile(r"@cap-begin (\d+) (\d+) (\d+)")
+RECORD_PATTERN = re.compile(r"@cap (\d+) ([0-9a-fA-F]+)")
+
+def parse_log(path):
+	freq = 0
+	records = {}
+	stream = sys.stdin if path == "-" else open(path)
+	for line in stream:
+		match = BEGIN_PATTERN.search(line)
+		if match:
+			freq, count, lost = [int(v) for v in match.groups()]
+			records = {}
+			if lost:
+				print("Warning: {} records were lost on target.".format(lost))
+			continue
+		match = RECORD_PATTERN.search(line)
+		if match:
+			data = bytearray.fromhex(match.group(2))
+			if len(data) != RECORD.size:
+				print("Skip invalid record {}.".format(match.group(1)))
+				continue
+			records[int(match.group(1))] = bytes(data)
+	if not freq:
+		sys.exit("No capture found in {}.".format(path))
+	return freq, [records[i] for i in sorted(records)]
+
+def write_trace(path, freq, records):
+	with open(path, "wb") as f:
+		f.write(FILE_HEADER.pack(FILE_MAGIC, FILE_VERSION, RECORD.size, freq, len(records)))
+		for record in records:
+			f.write(record)
+
+def read_trace(path):
+	with open(path, "rb") as f:
+		data = f.read()
+	magic, version, size, freq, count = FILE_HEADER.unpack_from(data)
+	if magic != FILE_MAGIC or version != FILE_VERSION or size != RECORD.size:
+		sys.exit("Invalid trace file {}.".format(path))
+	offset = FILE_HEADER.size
+	return freq, [data[offset + i * size:offset + (i + 1) * size] for i in range(count)]
+
+def endpoint(value):
+	if value == SOURCE_THREAD:
+		return "thread"
+	if value == SOURCE_ISR:
+		return "isr"
+	if value == TARGET_BROADCAST:
+		return "all"
+	return "svc{}".format(value)
+
+def decode_trace(registry, freq, records):
+	first = None
+	count = {}
+	for record in records:
+		timestamp, msg_id, source, target, lane, reserved, p0, p1, p2, p3 = RECORD.unpack(record)
+		if first is None:
+			first = timestamp
+		ms = ((timestamp - first) & 0xffffffff) * 1000 // freq
+		print("{:>10} ms {:>6} -> {:<6} {} {}".format(ms, endpoint(source), endpoint(target),
+		      "urgent" if lane else "normal", msg_decoder.decode(registry, msg_id, [p0, p1, p2, p3])))
+		count[msg_id] = count.get(msg_id, 0) + 1
+	print("")
+	for msg_id in sorted(count):
+		name = registry[msg_id][0] if msg_id in registry else "MSG_ID_UNKNOW"
+		print("{:>8} {}(0x{:x})".format(count[msg_id], name, msg_id))
+
+def main():
+	parser = argparse.ArgumentParser(description="Convert, decode and load the message captures of the cap_dump command.")
+	parser.add_argument("--root", default=os.path.join(os.path.dirname(__file__), "../.."), help="Repository root.")
+	parser.add_argument("--log", metavar="FILE", help="Extract the capture from the console log FILE, '-' for stdin.")
+	parser.add_argument("-o", "--output", metavar="FILE", help="Write the extracted capture to the trace FILE.")
+	parser.add_argument("--decode", metavar="FILE", help="Decode the trace FILE.")
+	parser.add_argument("--load", metavar="FILE", help="Print the cap_load commands which load the trace FILE back to target.")
+	args = parser.parse_args()
+
+	if args.log:
+		freq, records = parse_log(args.log)
+		if args.output:
+			write_trace(args.output, freq, records)
+			print("{} records written to {}.".format(len(records), args.output))
+		else:
+			decode_trace(msg_decoder.load_registry(args.root), freq, records)
+
+	if args.decode:
+		freq, records = read_trace(args.decode)
+		decode_trace(msg_decoder.load_registry(args.root), freq, records)
+
+	if args.load:
+		freq, records = read_trace(args.load)
+		for i, record in enumerate(records):
+			print("cap_load {} {}".format(i, "".join("{:02x}".format(b) for b in bytearray(record))))
+
+if __name__ == "__main__":
+	main()
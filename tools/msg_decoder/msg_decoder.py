@@ -0,0 +1,94 @@
+#!/usr/bin/python
+
+import argparse
+import os
+import re
+import sys
+
+# Message IDs and their bases in message.h
+BASE_PATTERN = re.compile(r"#define\s+(MSG_ID_\w+_BASE)\s+(0x[0-9a-fA-F]+)")
+ID_PATTERN = re.compile(r"#define\s+(MSG_ID_\w+)\s+\((MSG_ID_\w+_BASE)\s*\|\s*(0x[0-9a-fA-F]+)\)")
+
+# DECLARE_MESSAGE_DESC(msg_id, msg_name, param0, param1, param2, param3)
+DESC_PATTERN = re.compile(r"DECLARE_MESSAGE_DESC\s*\(([^;]*?)\)\s*;", re.S)
+
+# Service logs print "NAME(0xid) ..., 0xp0, 0xp1, 0xp2, 0xp3."
+LOG_PATTERN = re.compile(r"\w+\((0x[0-9a-fA-F]+)\)\D*?(0x[0-9a-fA-F]+), (0x[0-9a-fA-F]+), (0x[0-9a-fA-F]+), (0x[0-9a-fA-F]+)")
+
+SOURCE_DIRS = ["framework", "middleware/internal"]
+
+def find_sources(root, exts):
+	for d in SOURCE_DIRS:
+		for dirpath, dirnames, filenames in os.walk(os.path.join(root, d)):
+			for f in filenames:
+				if os.path.splitext(f)[1] in exts:
+					yield os.path.join(dirpath, f)
+
+def load_ids(root):
+	bases = {}
+	ids = {}
+	for path in find_sources(root, [".h"]):
+		text = open(path).read()
+		for name, value in BASE_PATTERN.findall(text):
+			bases[name] = int(value, 16)
+		for name, base, offset in ID_PATTERN.findall(text):
+			ids[name] = (base, int(offset, 16))
+	return dict((name, bases[base] | offset) for name, (base, offset) in ids.items() if base in bases)
+
+def parse_param(arg):
+	arg = arg.strip()
+	if arg == "NULL":
+		return None
+	return arg.strip('"')
+
+def load_registry(root):
+	ids = load_ids(root)
+	registry = {}
+	for path in find_sources(root, [".c"]):
+		for args in DESC_PATTERN.findall(open(path).read()):
+			fields = [a.strip() for a in args.split(",")]
+			if len(fields) != 6 or fields[0] not in ids:
+				print("Skip invalid description in {}: {}".format(path, " ".join(fields)))
+				continue
+			registry[ids[fields[0]]] = (fields[1], [parse_param(f) for f in fields[2:]])
+	return registry
+
+def decode(registry, msg_id, params):
+	if msg_id not in registry:
+		return "MSG_ID_UNKNOW(0x{:x}) {}".format(msg_id, ", ".join("0x{:x}".format(p) for p in params))
+	name, param_names = registry[msg_id]
+	fields = ["{}=0x{:x}".format(n, p) for n, p in zip(param_names, params) if n]
+	return " ".join(["{}(0x{:x})".format(name, msg_id)] + fields)
+
+def main():
+	parser = argparse.ArgumentParser(description="Decode the messages with the descriptions declared by DECLARE_MESSAGE_DESC.")
+	parser.add_argument("--root", default=os.path.join(os.path.dirname(__file__), "../.."), help="Repository root.")
+	parser.add_argument("--list", action="store_true", help="List the message registry.")
+	parser.add_argument("--log", metavar="FILE", help="Annotate the message logs of FILE, '-' for stdin.")
+	parser.add_argument("message", nargs="*", help="Message ID followed by up to 4 parameters.")
+	args = parser.parse_args()
+
+	registry = load_registry(args.root)
+
+	if args.list:
+		for msg_id in sorted(registry):
+			name, param_names = registry[msg_id]
+			print("0x{:04x} {:<28} {}".format(msg_id, name, ", ".join(n for n in param_names if n)))
+
+	if args.log:
+		stream = sys.stdin if args.log == "-" else open(args.log)
+		for line in stream:
+			line = line.rstrip("\r\n")
+			match = LOG_PATTERN.search(line)
+			if match:
+				values = [int(v, 16) for v in match.groups()]
+				line = "{}    [{}]".format(line, decode(registry, values[0], values[1:]))
+			print(line)
+
+	if args.message:
+		values = [int(v, 0) for v in args.message]
+		params = (values[1:] + [0, 0, 0, 0])[:4]
+		print(decode(registry, values[0], params))
+
+if __name__ == "__main__":
+	main()
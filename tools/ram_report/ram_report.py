@@ -0,0 +1,73 @@
+#!/usr/bin/python
+
+import argparse
+import re
+import sys
+
+# Keil map "Image Symbol Table" entry: name, address, type, size, object(section)
+SYMBOL_PATTERN = re.compile(r"^\s*(\S+)\s+0x[0-9a-fA-F]+\s+Data\s+(\d+)\s+\S+\((\S+)\)")
+
+# Symbols emitted by DECLARE_SERVICE_STATIC and __define_service
+SERVICE_PREFIXES = [
+	("__service_def_", "handle"),
+	("__service_tcb_", "tcb"),
+	("__service_stack_", "stack"),
+	("__service_qcb_", "queue"),
+	("__service_urgent_mq_", "queue"),
+	("__service_mq_", "queue"),
+]
+
+# Static memory of the worker pool in service.c
+POOL_SYMBOLS = {
+	"service_pool_worker_cb": "tcb",
+	"service_pool_worker_stack": "stack",
+	"service_pool_queue_cb": "queue",
+	"service_pool_queue_mem": "queue",
+}
+
+COLUMNS = ["handle", "tcb", "stack", "queue"]
+
+RAM_SECTIONS = [".bss", ".data", "module_service"]
+
+def parse_map(path):
+	services = {}
+	with open(path) as f:
+		for line in f:
+			match = SYMBOL_PATTERN.match(line)
+			if not match:
+				continue
+			name, size, section = match.group(1), int(match.group(2)), match.group(3)
+			if section not in RAM_SECTIONS:
+				continue
+			if name in POOL_SYMBOLS:
+				entry = services.setdefault("(worker pool)", dict.fromkeys(COLUMNS, 0))
+				entry[POOL_SYMBOLS[name]] += size
+				continue
+			for prefix, column in SERVICE_PREFIXES:
+				if name.startswith(prefix):
+					entry = services.setdefault(name[len(prefix):], dict.fromkeys(COLUMNS, 0))
+					entry[column] += size
+					break
+	return services
+
+def main():
+	parser = argparse.ArgumentParser(description="Report the static RAM of each service from the Keil map file.")
+	parser.add_argument("map", help="Map file generated by the linker.")
+	args = parser.parse_args()
+
+	services = parse_map(args.map)
+	if not services:
+		print("No service symbols found in {}.".format(args.map))
+		sys.exit(-1)
+
+	print("{:<20} {:>8} {:>8} {:>8} {:>8} {:>8}".format("service", *(COLUMNS + ["total"])))
+	totals = dict.fromkeys(COLUMNS, 0)
+	for name in sorted(services):
+		entry = services[name]
+		for c in COLUMNS:
+			totals[c] += entry[c]
+		print("{:<20} {:>8} {:>8} {:>8} {:>8} {:>8}".format(name, *([entry[c] for c in COLUMNS] + [sum(entry.values())])))
+	print("{:<20} {:>8} {:>8} {:>8} {:>8} {:>8}".format("total", *([totals[c] for c in COLUMNS] + [sum(totals.values())])))
+
+if __name__ == "__main__":
+	main()
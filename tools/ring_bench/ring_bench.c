@@ -0,0 +1,197 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Host counterpart of the ring_bench MMI command, it runs the same loops
+ * on the host and checks the single producer single consumer ring with a
+ * producer thread and a consumer thread.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ring_buff.h"
+
+#define RING_BENCH_SIZE     256
+#define RING_BENCH_BLOCK    48
+#define RING_CHECK_SIZE     64
+#define RING_CHECK_BYTES    (2 * 1024 * 1024)
+
+static char ring_bench_buffer[RING_BENCH_SIZE];
+static char ring_bench_block[RING_BENCH_BLOCK];
+
+static ring_spsc_t ring_check;
+static char ring_check_buffer[RING_CHECK_SIZE];
+
+static double ring_bench_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double ring_bench_run(int mode, uint32_t total)
+{
+    ring_buff_t ring;
+    ring_spsc_t ring_spsc;
+    volatile char sink = 0;
+    double start;
+    uint32_t moved;
+    uint32_t len;
+    uint32_t i;
+    char value = 0;
+
+    (void)ring_buffer_init(&ring, ring_bench_buffer, RING_BENCH_SIZE);
+    (void)ring_spsc_init(&ring_spsc, ring_bench_buffer, RING_BENCH_SIZE);
+
+    start = ring_bench_now();
+
+    for (moved = 0; moved < total; moved += RING_BENCH_SIZE)
+    {
+        if (mode == 2)
+        {
+            for (i = 0; i < RING_BENCH_SIZE; i += len)
+            {
+                len = ring_spsc_write_n(&ring_spsc,
+                                        ring_bench_block,
+                                        RING_BENCH_SIZE - i < RING_BENCH_BLOCK ?
+                                        RING_BENCH_SIZE - i : RING_BENCH_BLOCK);
+                (void)ring_spsc_read_n(&ring_spsc, ring_bench_block, len);
+            }
+        }
+        else if (mode == 1)
+        {
+            for (i = 0; i < RING_BENCH_SIZE; i++)
+            {
+                (void)ring_spsc_write(&ring_spsc, (char)i);
+            }
+
+            for (i = 0; i < RING_BENCH_SIZE; i++)
+            {
+                (void)ring_spsc_read(&ring_spsc, &value);
+            }
+        }
+        else
+        {
+            for (i = 0; i < RING_BENCH_SIZE; i++)
+            {
+                (void)ring_buffer_write(&ring, (char)i);
+            }
+
+            for (i = 0; i < RING_BENCH_SIZE; i++)
+            {
+                (void)ring_buffer_read(&ring, &value);
+            }
+        }
+
+        sink = value;
+    }
+
+    (void)sink;
+
+    return total / (ring_bench_now() - start);
+}
+
+static void* ring_check_producer(void* argument)
+{
+    uint32_t i;
+
+    (void)argument;
+
+    for (i = 0; i < RING_CHECK_BYTES; )
+    {
+        if (ring_spsc_write(&ring_check, (char)i))
+        {
+            (void)sched_yield();
+            continue;
+        }
+
+        i++;
+    }
+
+    return NULL;
+}
+
+static uint32_t ring_check_run(void)
+{
+    pthread_t producer;
+    uint32_t bad = 0;
+    uint32_t i;
+    char value;
+
+    (void)ring_spsc_init(&ring_check, ring_check_buffer, RING_CHECK_SIZE);
+
+    if (pthread_create(&producer, NULL, ring_check_producer, NULL))
+    {
+        return RING_CHECK_BYTES;
+    }
+
+    for (i = 0; i < RING_CHECK_BYTES; )
+    {
+        if (ring_spsc_read(&ring_check, &value))
+        {
+            (void)sched_yield();
+            continue;
+        }
+
+        if (value != (char)i)
+        {
+            bad++;
+        }
+
+        i++;
+    }
+
+    (void)pthread_join(producer, NULL);
+
+    return bad;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t total = 64 * 1024 * 1024;
+    uint32_t bad;
+
+    if (argc > 1)
+    {
+        total = (uint32_t)atoi(argv[1]) * 1024;
+    }
+
+    if (!total)
+    {
+        printf("Size must be at least 1 KB.\n");
+        return 1;
+    }
+
+    printf("ring_buff %.0f bytes/s\n", ring_bench_run(0, total));
+    printf("ring_spsc %.0f bytes/s\n", ring_bench_run(1, total));
+    printf("ring_spsc bulk %.0f bytes/s\n", ring_bench_run(2, total));
+
+    bad = ring_check_run();
+
+    printf("spsc check %u bytes through %u bytes ring, %u corrupted\n",
+           RING_CHECK_BYTES,
+           RING_CHECK_SIZE,
+           bad);
+
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "err.h"
+
+#ifndef __EVENT_RING_H__
+#define __EVENT_RING_H__
+
+/**
+ * @brief   Event ring definition, a lock-free multi-producer single-consumer
+ *          queue of fixed-size items.
+ *
+ * @note    Every slot carries a sequence number. A producer claims a slot by
+ *          moving the head with compare-and-swap, copies the item and then
+ *          publishes the slot by advancing its sequence. The single consumer
+ *          only reads published slots, so no lock is needed on either side.
+ *          A producer never waits for the consumer, it retries only when
+ *          another producer wins the same slot, which is bounded by the
+ *          number of producers preempting it.
+ *          It depends on nothing but the compiler atomic builtins, so it
+ *          runs as well on a host with threads standing in for interrupts.
+ */
+typedef struct
+{
+    volatile uint32_t   head;       /* Next position to claim by producers */
+    volatile uint32_t   tail;       /* Next position to read by consumer */
+    volatile uint32_t   contention; /* Claims lost to another producer */
+    uint32_t            mask;       /* Slot count minus one */
+    uint32_t            item_size;
+    volatile uint32_t*  seq;        /* Sequence number of every slot */
+    uint8_t*            item;       /* Item storage of every slot */
+} event_ring_t;
+
+/**
+ * @brief   Initialize the event ring.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   seq Sequence storage, one word per slot.
+ * @param   item Item storage, item_size bytes per slot.
+ * @param   item_size Size of one item in bytes.
+ * @param   count Slot count, must be a power of two.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static inline int event_ring_init(event_ring_t*  ring,
+                                  uint32_t*      seq,
+                                  void*          item,
+                                  uint32_t       item_size,
+                                  uint32_t       count)
+{
+    uint32_t i;
+
+    if (!ring || !seq || !item || !item_size)
+    {
+        return -EINVAL;
+    }
+
+    if (!count || (count & (count - 1)))
+    {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        seq[i] = i;
+    }
+
+    ring->head = 0;
+    ring->tail = 0;
+    ring->contention = 0;
+    ring->mask = count - 1;
+    ring->item_size = item_size;
+    ring->seq = seq;
+    ring->item = (uint8_t*)item;
+
+    __sync_synchronize();
+
+    return 0;
+}
+
+/**
+ * @brief   Put an item into the ring, safe from any number of producers.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   item Pointer to the item to copy in.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static inline int event_ring_put(event_ring_t* ring, const void* item)
+{
+    uint32_t pos = ring->head;
+    uint32_t index;
+    int32_t diff;
+
+    for (;;)
+    {
+        index = pos & ring->mask;
+        diff = (int32_t)(ring->seq[index] - pos);
+
+        if (diff == 0)
+        {
+            if (__sync_bool_compare_and_swap(&ring->head, pos, pos + 1))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* The consumer has not released the slot yet */
+            return -EFULL;
+        }
+
+        /* Another producer claimed the slot first */
+        (void)__sync_fetch_and_add(&ring->contention, 1);
+        pos = ring->head;
+    }
+
+    (void)memcpy(&ring->item[index * ring->item_size], item, ring->item_size);
+
+    /* The item must be visible before the slot is published */
+    __sync_synchronize();
+    ring->seq[index] = pos + 1;
+
+    return 0;
+}
+
+/**
+ * @brief   Get an item from the ring, only one consumer is allowed.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   item Pointer to copy the item out.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ *
+ * @note    A slot claimed but not yet published stops the consumer, the
+ *          producer which publishes it will signal the consumer again.
+ */
+static inline int event_ring_get(event_ring_t* ring, void* item)
+{
+    uint32_t pos = ring->tail;
+    uint32_t index = pos & ring->mask;
+
+    if ((int32_t)(ring->seq[index] - (pos + 1)) < 0)
+    {
+        return -EEMPTY;
+    }
+
+    __sync_synchronize();
+    (void)memcpy(item, &ring->item[index * ring->item_size], ring->item_size);
+
+    /* The copy must be done before the slot is handed back to producers */
+    __sync_synchronize();
+    ring->seq[index] = pos + ring->mask + 1;
+    ring->tail = pos + 1;
+
+    return 0;
+}
+
+/**
+ * @brief   Get the number of claimed slots, an estimate while producers run.
+ *
+ * @param   ring Pointer to the ring handle.
+ *
+ * @retval  Returns the number of slots in use.
+ */
+static inline uint32_t event_ring_get_used(const event_ring_t* ring)
+{
+    return ring->head - ring->tail;
+}
+
+#endif /* __EVENT_RING_H__ */
@@ -16,6 +16,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdint.h>
+#include <string.h>
 #include "err.h"
 
 #ifndef __RING_BUFF_H__
@@ -135,4 +137,304 @@ static inline int ring_buffer_init(ring_buff_t* ring, char* buffer, int size)
     return 0;
 }
 
+/**
+ * Orders the data and the index accesses of the single producer single
+ * consumer ring, a compiler barrier is enough on a TSO host.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define ring_spsc_barrier() __asm__ __volatile__("" ::: "memory")
+#else
+#define ring_spsc_barrier() __sync_synchronize()
+#endif
+
+/**
+ * @brief   Single producer single consumer ring buffer definition.
+ *
+ * @note    The producer only moves the head and the consumer only moves the
+ *          tail, the indices run freely and are masked on access, so the
+ *          used count is head - tail and no count is shared by both sides.
+ *          With one producer and one consumer no lock is needed, even when
+ *          one side is an interrupt. Several producers or consumers still
+ *          have to be serialized among themselves.
+ */
+typedef struct
+{
+    volatile uint32_t   head;       /* Next position to write by producer */
+    volatile uint32_t   tail;       /* Next position to read by consumer */
+    uint32_t            mask;       /* Size minus one */
+    char*               buffer;
+} ring_spsc_t;
+
+/**
+ * @brief   Initialize the single producer single consumer ring buffer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   buffer The buffer space.
+ * @param   size The buffer size, must be a power of two.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static inline int ring_spsc_init(ring_spsc_t* ring, char* buffer, uint32_t size)
+{
+    if (!ring || !buffer)
+    {
+        return -EINVAL;
+    }
+
+    if (!size || (size & (size - 1)))
+    {
+        return -EINVAL;
+    }
+
+    ring->head = 0;
+    ring->tail = 0;
+    ring->mask = size - 1;
+    ring->buffer = buffer;
+
+    ring_spsc_barrier();
+
+    return 0;
+}
+
+/**
+ * @brief   Get the number of bytes to read.
+ *
+ * @param   ring Pointer to the ring handle.
+ *
+ * @retval  Returns the number of bytes.
+ */
+static inline uint32_t ring_spsc_get_used(const ring_spsc_t* ring)
+{
+    return ring->head - ring->tail;
+}
+
+/**
+ * @brief   Get the number of bytes to write.
+ *
+ * @param   ring Pointer to the ring handle.
+ *
+ * @retval  Returns the number of bytes.
+ */
+static inline uint32_t ring_spsc_get_free(const ring_spsc_t* ring)
+{
+    return ring->mask + 1 - (ring->head - ring->tail);
+}
+
+/**
+ * @brief   Write data and increment the head, only from the producer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   value The data to write.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static inline int ring_spsc_write(ring_spsc_t* ring, char value)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail > ring->mask)
+    {
+        return -EFULL;
+    }
+
+    ring->buffer[head & ring->mask] = value;
+
+    /* The data must be visible before the consumer sees the head */
+    ring_spsc_barrier();
+    ring->head = head + 1;
+
+    return 0;
+}
+
+/**
+ * @brief   Read data and increment the tail, only from the consumer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   value Pointer to the data to read.
+ *
+ * @retval  Returns 0 on success, negative error code otherwise.
+ */
+static inline int ring_spsc_read(ring_spsc_t* ring, char* value)
+{
+    uint32_t tail = ring->tail;
+
+    if (ring->head == tail)
+    {
+        return -EEMPTY;
+    }
+
+    /* The data is read only after the head which published it */
+    ring_spsc_barrier();
+    *value = ring->buffer[tail & ring->mask];
+
+    /* The read must be done before the producer reuses the byte */
+    ring_spsc_barrier();
+    ring->tail = tail + 1;
+
+    return 0;
+}
+
+/**
+ * @brief   Get the largest contiguous span to write, only from the producer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   span Returns the start of the span in the ring storage.
+ *
+ * @retval  Returns the number of bytes of the span, 0 if the ring is full.
+ *
+ * @note    The span is filled in place, e.g. by a dma, and published with
+ *          ring_spsc_write_commit(). It ends at the end of the storage, the
+ *          rest of the free space is at the start of the storage.
+ */
+static inline uint32_t ring_spsc_write_span(ring_spsc_t* ring, char** span)
+{
+    uint32_t head = ring->head;
+    uint32_t offset = head & ring->mask;
+    uint32_t free = ring->mask + 1 - (head - ring->tail);
+    uint32_t contig = ring->mask + 1 - offset;
+
+    *span = &ring->buffer[offset];
+
+    return free < contig ? free : contig;
+}
+
+/**
+ * @brief   Publish the bytes filled in the span, only from the producer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   len The number of bytes filled, not more than the span.
+ *
+ * @retval  None.
+ */
+static inline void ring_spsc_write_commit(ring_spsc_t* ring, uint32_t len)
+{
+    /* The data must be visible before the consumer sees the head */
+    ring_spsc_barrier();
+    ring->head += len;
+}
+
+/**
+ * @brief   Get the largest contiguous span to read, only from the consumer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   span Returns the start of the span in the ring storage.
+ *
+ * @retval  Returns the number of bytes of the span, 0 if the ring is empty.
+ *
+ * @note    The span is consumed in place, e.g. by a dma, and released with
+ *          ring_spsc_read_commit(). It ends at the end of the storage, the
+ *          rest of the data is at the start of the storage.
+ */
+static inline uint32_t ring_spsc_read_span(ring_spsc_t* ring, const char** span)
+{
+    uint32_t tail = ring->tail;
+    uint32_t offset = tail & ring->mask;
+    uint32_t used = ring->head - tail;
+    uint32_t contig = ring->mask + 1 - offset;
+
+    /* The data is read only after the head which published it */
+    ring_spsc_barrier();
+
+    *span = &ring->buffer[offset];
+
+    return used < contig ? used : contig;
+}
+
+/**
+ * @brief   Release the bytes consumed in the span, only from the consumer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   len The number of bytes consumed, not more than the span.
+ *
+ * @retval  None.
+ */
+static inline void ring_spsc_read_commit(ring_spsc_t* ring, uint32_t len)
+{
+    /* The read must be done before the producer reuses the bytes */
+    ring_spsc_barrier();
+    ring->tail += len;
+}
+
+/**
+ * @brief   Write as many bytes as fit, only from the producer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   data Pointer to the data to write.
+ * @param   len The number of bytes to write.
+ *
+ * @retval  Returns the number of bytes written, 0 if the ring is full.
+ *
+ * @note    The data is copied in at most two pieces, one up to the end of
+ *          the storage and one from its start, and published at once.
+ */
+static inline uint32_t ring_spsc_write_n(ring_spsc_t*  ring,
+                                         const char*   data,
+                                         uint32_t      len)
+{
+    uint32_t head = ring->head;
+    uint32_t offset = head & ring->mask;
+    uint32_t free = ring->mask + 1 - (head - ring->tail);
+    uint32_t first;
+
+    if (len > free)
+    {
+        len = free;
+    }
+
+    first = ring->mask + 1 - offset;
+    if (first > len)
+    {
+        first = len;
+    }
+
+    (void)memcpy(&ring->buffer[offset], data, first);
+    (void)memcpy(ring->buffer, data + first, len - first);
+
+    ring_spsc_write_commit(ring, len);
+
+    return len;
+}
+
+/**
+ * @brief   Read as many bytes as available, only from the consumer.
+ *
+ * @param   ring Pointer to the ring handle.
+ * @param   data Pointer to the buffer to read into.
+ * @param   len The size of the buffer.
+ *
+ * @retval  Returns the number of bytes read, 0 if the ring is empty.
+ *
+ * @note    The data is copied out in at most two pieces and released at once.
+ */
+static inline uint32_t ring_spsc_read_n(ring_spsc_t*   ring,
+                                        char*          data,
+                                        uint32_t       len)
+{
+    uint32_t tail = ring->tail;
+    uint32_t offset = tail & ring->mask;
+    uint32_t used = ring->head - tail;
+    uint32_t first;
+
+    if (len > used)
+    {
+        len = used;
+    }
+
+    first = ring->mask + 1 - offset;
+    if (first > len)
+    {
+        first = len;
+    }
+
+    /* The data is read only after the head which published it */
+    ring_spsc_barrier();
+
+    (void)memcpy(data, &ring->buffer[offset], first);
+    (void)memcpy(data + first, ring->buffer, len - first);
+
+    ring_spsc_read_commit(ring, len);
+
+    return len;
+}
+
 #endif /* __RING_BUFF_H__ */
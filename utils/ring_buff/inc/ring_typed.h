@@ -0,0 +1,246 @@
+/**
+ * Embedded Device Software
+ * Copyright (C) 2022 Peter.Peng
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "err.h"
+#include "ring_buff.h"
+
+#ifndef __RING_TYPED_H__
+#define __RING_TYPED_H__
+
+/**
+ * @brief   Behavior of a typed ring when an item is put into a full ring.
+ */
+#define RING_TYPED_REJECT_NEWEST    0   /* Fail the put with -EFULL */
+#define RING_TYPED_OVERWRITE_OLDEST 1   /* Drop the oldest items */
+
+/**
+ * @brief   Fail the build when the condition is false, the array size is
+ *          negative then. Usable at file scope on any C compiler.
+ */
+#define RING_TYPED_BUILD_CHECK(name, cond) \
+    typedef char name[(cond) ? 1 : -1]
+
+/**
+ * @brief   Declare a ring of fixed-size items, with the item type, capacity
+ *          and full behavior fixed at compile time.
+ *
+ * @param   name Prefix of the generated type and functions.
+ * @param   type Item type, copied by assignment and memcpy.
+ * @param   capacity Number of items, must be a power of two.
+ * @param   mode RING_TYPED_REJECT_NEWEST or RING_TYPED_OVERWRITE_OLDEST.
+ *
+ * @note    The following are generated, every function is static inline:
+ *          name##_t                    The ring handle, with the storage.
+ *          name##_init(ring)           Empty the ring.
+ *          name##_get_used(ring)       Number of items to get.
+ *          name##_get_free(ring)       Number of items to put.
+ *          name##_get_dropped(ring)    Number of items overwritten.
+ *          name##_put(ring, item)      Put one item.
+ *          name##_get(ring, item)      Get one item.
+ *          name##_peek(ring)           Oldest item in place, NULL if empty.
+ *          name##_put_n(ring, items, count)    Put up to count items.
+ *          name##_get_n(ring, items, count)    Get up to count items.
+ *          The batch functions copy in at most two pieces and move the head
+ *          or the tail once, they return the number of items moved.
+ *          In the reject mode one producer and one consumer need no lock,
+ *          like ring_spsc_t. In the overwrite mode the producer moves the
+ *          tail of a full ring, so the producer and the consumer have to be
+ *          serialized, e.g. by a critical section.
+ */
+#define DECLARE_RING_TYPED(name, type, capacity, mode)                      \
+    RING_TYPED_BUILD_CHECK(name##_capacity_is_power_of_two,                 \
+                           (capacity) > 0 &&                                \
+                           ((capacity) & ((capacity) - 1)) == 0);           \
+    RING_TYPED_BUILD_CHECK(name##_mode_is_valid,                            \
+                           (mode) == RING_TYPED_REJECT_NEWEST ||            \
+                           (mode) == RING_TYPED_OVERWRITE_OLDEST);          \
+                                                                            \
+    typedef struct                                                          \
+    {                                                                       \
+        volatile uint32_t   head;                                           \
+        volatile uint32_t   tail;                                           \
+        uint32_t            dropped;                                        \
+        type                item[capacity];                                 \
+    } name##_t;                                                             \
+                                                                            \
+    static inline void name##_init(name##_t* ring)                          \
+    {                                                                       \
+        ring->head = 0;                                                     \
+        ring->tail = 0;                                                     \
+        ring->dropped = 0;                                                  \
+                                                                            \
+        ring_spsc_barrier();                                                \
+    }                                                                       \
+                                                                            \
+    static inline uint32_t name##_get_used(const name##_t* ring)            \
+    {                                                                       \
+        return ring->head - ring->tail;                                     \
+    }                                                                       \
+                                                                            \
+    static inline uint32_t name##_get_free(const name##_t* ring)            \
+    {                                                                       \
+        return (capacity) - (ring->head - ring->tail);                      \
+    }                                                                       \
+                                                                            \
+    static inline uint32_t name##_get_dropped(const name##_t* ring)         \
+    {                                                                       \
+        return ring->dropped;                                               \
+    }                                                                       \
+                                                                            \
+    static inline int name##_put(name##_t* ring, const type* item)          \
+    {                                                                       \
+        uint32_t head = ring->head;                                         \
+                                                                            \
+        if (head - ring->tail >= (capacity))                                \
+        {                                                                   \
+            if ((mode) == RING_TYPED_REJECT_NEWEST)                         \
+            {                                                               \
+                return -EFULL;                                              \
+            }                                                               \
+                                                                            \
+            ring->tail++;                                                   \
+            ring->dropped++;                                                \
+        }                                                                   \
+                                                                            \
+        ring->item[head & ((capacity) - 1)] = *item;                        \
+                                                                            \
+        ring_spsc_barrier();                                                \
+        ring->head = head + 1;                                              \
+                                                                            \
+        return 0;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline int name##_get(name##_t* ring, type* item)                \
+    {                                                                       \
+        uint32_t tail = ring->tail;                                         \
+                                                                            \
+        if (ring->head == tail)                                             \
+        {                                                                   \
+            return -EEMPTY;                                                 \
+        }                                                                   \
+                                                                            \
+        ring_spsc_barrier();                                                \
+        *item = ring->item[tail & ((capacity) - 1)];                        \
+                                                                            \
+        ring_spsc_barrier();                                                \
+        ring->tail = tail + 1;                                              \
+                                                                            \
+        return 0;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline const type* name##_peek(name##_t* ring)                   \
+    {                                                                       \
+        uint32_t tail = ring->tail;                                         \
+                                                                            \
+        if (ring->head == tail)                                             \
+        {                                                                   \
+            return NULL;                                                    \
+        }                                                                   \
+                                                                            \
+        ring_spsc_barrier();                                                \
+                                                                            \
+        return &ring->item[tail & ((capacity) - 1)];                        \
+    }                                                                       \
+                                                                            \
+    static inline uint32_t name##_put_n(name##_t*      ring,                \
+                                        const type*    items,               \
+                                        uint32_t       count)               \
+    {                                                                       \
+        uint32_t head = ring->head;                                         \
+        uint32_t free = (capacity) - (head - ring->tail);                   \
+        uint32_t offset;                                                    \
+        uint32_t first;                                                     \
+                                                                            \
+        if (count > free)                                                   \
+        {                                                                   \
+            if ((mode) == RING_TYPED_REJECT_NEWEST)                         \
+            {                                                               \
+                count = free;                                               \
+            }                                                               \
+            else                                                            \
+            {                                                               \
+                /* Only the newest capacity items survive */                \
+                if (count > (capacity))                                     \
+                {                                                           \
+                    ring->dropped += count - (capacity);                    \
+                    items += count - (capacity);                            \
+                    count = (capacity);                                     \
+                }                                                           \
+                                                                            \
+                if (count > free)                                           \
+                {                                                           \
+                    ring->dropped += count - free;                          \
+                    ring->tail += count - free;                             \
+                }                                                           \
+            }                                                               \
+        }                                                                   \
+                                                                            \
+        offset = head & ((capacity) - 1);                                   \
+        first = (capacity) - offset;                                        \
+        if (first > count)                                                  \
+        {                                                                   \
+            first = count;                                                  \
+        }                                                                   \
+                                                                            \
+        (void)memcpy(&ring->item[offset], items, first * sizeof(type));     \
+        (void)memcpy(ring->item,                                            \
+                     items + first,                                         \
+                     (count - first) * sizeof(type));                       \
+                                                                            \
+        ring_spsc_barrier();                                                \
+        ring->head = head + count;                                          \
+                                                                            \
+        return count;                                                       \
+    }                                                                       \
+                                                                            \
+    static inline uint32_t name##_get_n(name##_t*  ring,                    \
+                                        type*      items,                   \
+                                        uint32_t   count)                   \
+    {                                                                       \
+        uint32_t tail = ring->tail;                                         \
+        uint32_t used = ring->head - tail;                                  \
+        uint32_t offset = tail & ((capacity) - 1);                          \
+        uint32_t first;                                                     \
+                                                                            \
+        if (count > used)                                                   \
+        {                                                                   \
+            count = used;                                                   \
+        }                                                                   \
+                                                                            \
+        first = (capacity) - offset;                                        \
+        if (first > count)                                                  \
+        {                                                                   \
+            first = count;                                                  \
+        }                                                                   \
+                                                                            \
+        ring_spsc_barrier();                                                \
+                                                                            \
+        (void)memcpy(items, &ring->item[offset], first * sizeof(type));     \
+        (void)memcpy(items + first,                                         \
+                     ring->item,                                            \
+                     (count - first) * sizeof(type));                       \
+                                                                            \
+        ring_spsc_barrier();                                                \
+        ring->tail = tail + count;                                          \
+                                                                            \
+        return count;                                                       \
+    }
+
+#endif /* __RING_TYPED_H__ */